@@ -31,6 +31,7 @@ Game::Game(Window::Ptr & window)
     for (auto & s : scene.children) {
         for (auto & m : s->models) m->material->shader = shader;
     }
+    bvh.build(scene);
 
     // Load models / textures / scenes
     // No fancy render api, just each model can be drawn
@@ -75,18 +76,19 @@ void Game::onKeyPressed(const sf::Event::KeyEvent & event) {
 
 void Game::onUpdate(const sf::Time & delta) {
     float s = delta.asSeconds();
+    bvh.refit(scene);
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, true);
+    gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
@@ -96,7 +98,9 @@ void Game::onDraw() const {
     glPointSize(2.0);
 
     RenderState state(camera);
-    scene.draw(state);
+    queue.clear();
+    bvh.enqueue(queue, state);
+    queue.submit(state, &occlusion);
 
     if (showGrid) {
         grid.draw(state.getVP());
@@ -4,7 +4,11 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/Bvh.hpp>
+#include <singe/Graphics/OcclusionCuller.hpp>
+#include <singe/Graphics/RenderQueue.hpp>
 #include <singe/Graphics/Scene.hpp>
+#include <singe/Graphics/StateCache.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 
@@ -17,12 +21,15 @@ using namespace glm;
 #include <memory>
 
 class Game : public GameBase {
-    ResourceManager       res;
-    singe::MVPShader::Ptr shader;
-    Grid                  grid;
-    Scene                 scene;
-    Scene *               otherScene;
-    bool                  showGrid;
+    ResourceManager         res;
+    singe::MVPShader::Ptr   shader;
+    Grid                    grid;
+    Scene                   scene;
+    Bvh                     bvh;
+    mutable RenderQueue     queue;
+    mutable OcclusionCuller occlusion;
+    Scene *                 otherScene;
+    bool                    showGrid;
 
     enum DisplayMode {
         Point = GL_POINT,
@@ -0,0 +1,123 @@
+#include "Game.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+static constexpr int kMaxLayers = 16;
+
+Game::Game(Window::Ptr & window)
+    : GameBase(window),
+      res("../../../examples/res"),
+      shader(res.getMVPShader("shader/default.vert", "shader/heavy.frag")),
+      current(0),
+      frame(0),
+      timer(0),
+      gpuTime(0),
+      gpuSamples(0) {
+
+    iterations = shader->addExtra<int>("iterations", 0);
+
+    // Planes facing the camera, each a separate model and material
+    for (int i = 0; i < kMaxLayers; i++) {
+        auto layer = layers.emplace_back(std::make_shared<Scene>());
+        layer->models = res.loadModel("model/plane.obj");
+        layer->transform.move({0, 0, -4 - 0.25 * i});
+        layer->transform.rotateEuler({glm::half_pi<float>(), 0, 0});
+        for (auto & m : layer->models) {
+            m->material->shader = shader;
+            layerMaterials.push_back(m->material);
+        }
+    }
+
+    for (int layerCount : {1, 2, 4, 8, 16}) {
+        for (int cost : {0, 64}) {
+            for (bool sorted : {true, false}) {
+                cases.push_back({layerCount, cost, sorted, false});
+                cases.push_back({layerCount, cost, sorted, true});
+            }
+        }
+    }
+    results.resize(cases.size());
+
+    glGenQueries(1, &timer);
+    applyCase(cases[current]);
+
+    Logging::Game->info("Timing {} cases, {} frames each", cases.size(),
+                        Samples);
+}
+
+Game::~Game() {
+    glDeleteQueries(1, &timer);
+}
+
+void Game::applyCase(const Case & benchCase) {
+    // Farthest first, so unsorted materials are drawn back-to-front
+    scene.children.assign(layers.rbegin() + (kMaxLayers - benchCase.layers),
+                          layers.rend());
+    for (size_t i = 0; i < layers.size(); i++) {
+        for (auto & m : layers[i]->models)
+            m->material = benchCase.sorted ? layerMaterials[0]
+                                           : layerMaterials[i];
+    }
+    scene.depthPrepass = benchCase.prepass;
+    iterations->set(benchCase.iterations);
+
+    // Material ids follow the push order of a new queue
+    queue = RenderQueue();
+    frame = 0;
+    gpuTime = 0;
+    gpuSamples = 0;
+}
+
+void Game::logResults() const {
+    Logging::Game->info("layers iterations    order   no prepass      prepass");
+    for (size_t i = 0; i + 1 < cases.size(); i += 2) {
+        const Case & c = cases[i];
+        Logging::Game->info("{:>6} {:>10} {:>8} {:>9.3f} ms {:>9.3f} ms {}",
+                            c.layers, c.iterations,
+                            c.sorted ? "sorted" : "unsorted", results[i],
+                            results[i + 1],
+                            results[i + 1] < results[i] ? "<" : "");
+    }
+}
+
+void Game::onUpdate(const sf::Time & delta) {
+    frame++;
+    if (gpuSamples < Samples)
+        return;
+
+    results[current] = gpuTime / gpuSamples;
+    if (++current == cases.size()) {
+        logResults();
+        Stop();
+        return;
+    }
+    applyCase(cases[current]);
+}
+
+inline void setupGl() {
+    auto & gl = StateCache::current();
+    glClearColor(0.25, 0.25, 0.25, 1.0);
+    gl.setEnabled(GL_CULL_FACE, false);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, false);
+}
+
+void Game::onDraw() const {
+    setupGl();
+
+    RenderState state(camera);
+
+    // Reading the result straight away stalls, which is fine for timing
+    bool timed = frame > Warmup && gpuSamples < Samples;
+    if (timed)
+        glBeginQuery(GL_TIME_ELAPSED, timer);
+    scene.draw(state, queue);
+    if (timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &elapsed);
+        gpuTime += elapsed / 1e6;
+        gpuSamples++;
+    }
+}
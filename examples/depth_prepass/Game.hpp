@@ -0,0 +1,66 @@
+#pragma once
+
+#include <singe/Core/GameBase.hpp>
+#include <singe/Core/ResourceManager.hpp>
+#include <singe/Core/Window.hpp>
+#include <singe/Graphics/RenderQueue.hpp>
+#include <singe/Graphics/Scene.hpp>
+#include <singe/Graphics/StateCache.hpp>
+#include <singe/Support/log.hpp>
+using namespace singe;
+
+#include <memory>
+#include <vector>
+using std::vector;
+
+/**
+ * Benchmark of the RenderQueue depth pre-pass.
+ *
+ * Screen filling planes are stacked in front of the camera and drawn with
+ * a fragment shader of adjustable cost. Each case is timed on the GPU with
+ * and without the pre-pass, then a table is logged and the game stops.
+ *
+ * Sorted cases share one material so the queue draws front-to-back and
+ * early depth testing already hides most overdraw. Unsorted cases give
+ * each plane its own material, pushed back-to-front, which is the worst
+ * case for overdraw.
+ */
+class Game : public GameBase {
+    /// One benchmark configuration
+    struct Case {
+        int  layers;
+        int  iterations;
+        bool sorted;
+        bool prepass;
+    };
+
+    static constexpr int Warmup = 10;
+    static constexpr int Samples = 30;
+
+    ResourceManager              res;
+    singe::MVPShader::Ptr        shader;
+    TypedUniformExtra<int>::Ptr  iterations;
+    singe::Scene                 scene;
+    /// Planes nearest first
+    vector<singe::Scene::Ptr>    layers;
+    vector<singe::Material::Ptr> layerMaterials;
+    vector<Case>                 cases;
+    vector<double>               results;
+    size_t                       current;
+    int                          frame;
+    GLuint                       timer;
+    mutable double               gpuTime;
+    mutable int                  gpuSamples;
+    mutable RenderQueue          queue;
+
+    void applyCase(const Case & benchCase);
+
+    void logResults() const;
+
+public:
+    Game(Window::Ptr & window);
+    virtual ~Game();
+
+    void onUpdate(const sf::Time & delta) override;
+    void onDraw(void) const override;
+};
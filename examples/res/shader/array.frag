@@ -0,0 +1,24 @@
+#version 330 core
+
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
+
+// Material textures packed by TextureArrays
+uniform sampler2DArray gTexture;
+// Layer of each texture unit, -1 if the texture is not packed
+uniform vec3 textureLayers;
+// Region of each layer, uv offset in xy and scale in zw
+uniform vec4 textureRects[3];
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+
+void main() {
+    vec4 rect = textureRects[0];
+    // Full layers repeat in the sampler, atlas regions wrap here
+    vec2 uv = rect.zw == vec2(1.0) ? FragTex : rect.xy + fract(FragTex) * rect.zw;
+    FragColor = texture(gTexture, vec3(uv, textureLayers.x));
+    FragNormal = vec4(normalize(FragNorm), 1.0);
+}
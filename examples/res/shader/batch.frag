@@ -0,0 +1,42 @@
+#version 430 core
+
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
+
+struct MaterialData {
+    vec4 ambient;
+    // Diffuse colour in rgb and alpha in a
+    vec4 diffuse;
+    // Specular colour in rgb and exponent in a
+    vec4 specular;
+};
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialData materials[];
+};
+
+// Material textures packed by TextureArrays, shared by the whole bucket
+uniform sampler2DArray gTexture;
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+flat in uint FragMaterial;
+flat in int FragLayer;
+flat in vec4 FragRect;
+
+void main() {
+    MaterialData material = materials[FragMaterial];
+    vec4 color = vec4(material.diffuse.rgb, 1.0);
+    // Materials without a texture have no layer
+    if (FragLayer >= 0) {
+        // Full layers repeat in the sampler, atlas regions wrap here
+        vec2 uv = FragTex;
+        if (FragRect.zw != vec2(1.0))
+            uv = FragRect.xy + fract(FragTex) * FragRect.zw;
+        color = texture(gTexture, vec3(uv, FragLayer));
+    }
+    FragColor = vec4(color.rgb, color.a * material.diffuse.a);
+    FragNormal = vec4(normalize(FragNorm), 1.0);
+}
@@ -0,0 +1,40 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNorm;
+layout (location = 2) in vec2 aTex;
+layout (location = 7) in uint aDrawId;
+
+struct DrawData {
+    mat4 world;
+    // Region of the texture layer, uv offset in xy and scale in zw
+    vec4 rect;
+    uint material;
+    // Layer of the first texture unit, -1 if it is not packed
+    int layer;
+};
+
+layout (std430, binding = 0) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+
+out vec3 FragPos;
+out vec3 FragNorm;
+out vec2 FragTex;
+flat out uint FragMaterial;
+flat out int FragLayer;
+flat out vec4 FragRect;
+
+uniform mat4 mvp;
+
+void main() {
+    DrawData draw = draws[aDrawId];
+    vec4 world = draw.world * vec4(aPos, 1.0);
+    gl_Position = mvp * world;
+    FragPos = vec3(world);
+    FragNorm = mat3(draw.world) * aNorm;
+    FragTex = aTex;
+    FragMaterial = draw.material;
+    FragLayer = draw.layer;
+    FragRect = draw.rect;
+}
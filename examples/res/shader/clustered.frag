@@ -0,0 +1,79 @@
+#version 330 core
+
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
+
+uniform sampler2D gTexture;
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+
+// Bound once per frame by UniformBuffers
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPos;
+    float time;
+};
+
+// Bound by ClusteredLights
+layout (std140) uniform Clusters {
+    // Tiles across, tiles down, depth slices and directional lights
+    uvec4 clusterCounts;
+    // Tile size in pixels, near plane and slices / log(far / near)
+    vec4 clusterScale;
+    vec4 ambientLight;
+    vec4 directionalDirections[4];
+    vec4 directionalColors[4];
+};
+
+// Two texels per light, world position and radius then colour
+uniform samplerBuffer clusterLights;
+// Offset into clusterIndices and light count of each cluster
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+
+void main() {
+    vec4 albedo = texture(gTexture, FragTex);
+    vec3 n = normalize(FragNorm);
+    vec3 v = normalize(cameraPos.xyz - FragPos);
+
+    vec3 light = ambientLight.rgb;
+    for (uint i = 0u; i < clusterCounts.w; i++)
+        light += directionalColors[i].rgb * max(dot(n, -directionalDirections[i].xyz), 0.0);
+
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    int slice = int(log(max(depth, clusterScale.z) / clusterScale.z) * clusterScale.w);
+    ivec3 cluster = clamp(ivec3(gl_FragCoord.xy / clusterScale.xy, slice),
+                          ivec3(0), ivec3(clusterCounts.xyz) - 1);
+    int index = cluster.x + int(clusterCounts.x) * (cluster.y + int(clusterCounts.y) * cluster.z);
+    uvec2 range = texelFetch(clusterGrid, index).xy;
+
+    vec3 specular = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++) {
+        int lightIndex = int(texelFetch(clusterIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(clusterLights, lightIndex * 2);
+        vec3 color = texelFetch(clusterLights, lightIndex * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float dist = length(toLight);
+        if (dist >= positionRadius.w)
+            continue;
+
+        // Inverse square with a window so the light reaches 0 at the radius
+        float fade = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = fade * fade / (dist * dist + 1.0);
+
+        vec3 l = toLight / dist;
+        float diffuse = max(dot(n, l), 0.0);
+        light += color * diffuse * attenuation;
+        if (diffuse > 0.0)
+            specular += color * attenuation * pow(max(dot(n, normalize(l + v)), 0.0), 32.0) * 0.25;
+    }
+
+    FragColor = vec4(albedo.rgb * light + specular, albedo.a);
+    FragNormal = vec4(n, 1.0);
+}
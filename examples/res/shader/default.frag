@@ -1,6 +1,8 @@
 #version 330 core
 
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
 
 uniform sampler2D gTexture;
 
@@ -10,4 +12,5 @@ in vec2 FragTex;
 
 void main() {
     FragColor = texture(gTexture, FragTex);
+    FragNormal = vec4(normalize(FragNorm), 1.0);
 }
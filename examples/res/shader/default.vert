@@ -8,11 +8,41 @@ out vec3 FragPos;
 out vec3 FragNorm;
 out vec2 FragTex;
 
-uniform mat4 mvp;
+// Matches DepthProgram so a depth pre-pass can be tested with GL_EQUAL
+invariant gl_Position;
+
+// Bound once per frame by UniformBuffers
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPos;
+    float time;
+};
+
+// Bound per draw from the UniformBuffers ring
+layout (std140) uniform Draw {
+    mat4 model;
+    mat4 mvp;
+    // w is 1 for Model::Packed, aPos is unorm16 in the model bounds and
+    // aNorm.xy is an octahedral encoded normal
+    vec4 posOffset;
+    vec4 posScale;
+};
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = mvp * vec4(aPos, 1.0);
-    FragPos = vec3(mvp * vec4(aPos, 1.0));
-    FragNorm = aNorm;
+    bool packedVertex = posOffset.w != 0.0;
+    vec3 pos = packedVertex ? posOffset.xyz + aPos * posScale.xyz : aPos;
+    vec3 norm = packedVertex ? octDecode(aNorm.xy) : aNorm;
+    gl_Position = mvp * vec4(pos, 1.0);
+    FragPos = vec3(model * vec4(pos, 1.0));
+    FragNorm = mat3(model) * norm;
     FragTex = aTex;
 }
@@ -0,0 +1,29 @@
+#version 330 core
+
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
+
+uniform sampler2D gTexture;
+// Loop count standing in for an expensive material
+uniform int iterations;
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+
+void main() {
+    vec4 albedo = texture(gTexture, FragTex);
+    vec3 n = normalize(FragNorm);
+
+    float light = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        float angle = float(i) * 2.39996;
+        vec3 l = normalize(vec3(cos(angle), sin(angle), 1.0 + FragPos.z * 0.01));
+        light += pow(max(dot(n, l), 0.0), 4.0 + float(i % 16));
+    }
+    light = 0.5 + 0.5 * light / float(max(iterations, 1));
+
+    FragColor = vec4(albedo.rgb * light, albedo.a);
+    FragNormal = vec4(n, 1.0);
+}
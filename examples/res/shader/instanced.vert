@@ -0,0 +1,38 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNorm;
+layout (location = 2) in vec2 aTex;
+layout (location = 3) in mat4 aInstance;
+
+out vec3 FragPos;
+out vec3 FragNorm;
+out vec2 FragTex;
+
+// Matches DepthProgram so a depth pre-pass can be tested with GL_EQUAL
+invariant gl_Position;
+
+uniform mat4 mvp;
+uniform mat4 model;
+
+// Set by Model::Packed, aPos is unorm16 in the model bounds and aNorm.xy is
+// an octahedral encoded normal
+uniform bool packedVertex;
+uniform vec3 posOffset;
+uniform vec3 posScale;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+void main() {
+    vec3 pos = packedVertex ? posOffset + aPos * posScale : aPos;
+    vec3 norm = packedVertex ? octDecode(aNorm.xy) : aNorm;
+    gl_Position = mvp * aInstance * vec4(pos, 1.0);
+    FragPos = vec3(model * aInstance * vec4(pos, 1.0));
+    FragNorm = mat3(aInstance) * norm;
+    FragTex = aTex;
+}
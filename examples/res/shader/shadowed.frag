@@ -0,0 +1,59 @@
+#version 330 core
+
+layout (location = 0) out vec4 FragColor;
+// World space normal, only stored when DeferredRenderer binds a G-buffer
+layout (location = 1) out vec4 FragNormal;
+
+uniform sampler2D gTexture;
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+
+// Bound once per frame by UniformBuffers
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPos;
+    float time;
+};
+
+// Bound by ShadowCascades
+layout (std140) uniform Shadows {
+    // World to shadow map uv and depth of each cascade
+    mat4 shadowMatrices[4];
+    // Far view depth of each cascade
+    vec4 cascadeSplits;
+    // Direction the light travels
+    vec4 shadowLight;
+};
+
+uniform sampler2DArrayShadow shadowMap;
+
+float shadow(vec3 n) {
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    int cascade = 0;
+    while (cascade < 4 && depth > cascadeSplits[cascade])
+        cascade++;
+    if (cascade == 4)
+        return 1.0;
+
+    // Push the lookup off the surface, further at grazing angles
+    float slope = 1.0 - max(dot(n, -shadowLight.xyz), 0.0);
+    vec3 offset = n * (0.02 + 0.05 * slope) * float(cascade + 1);
+    vec4 coord = shadowMatrices[cascade] * vec4(FragPos + offset, 1.0);
+    return texture(shadowMap, vec4(coord.xy, float(cascade), coord.z));
+}
+
+void main() {
+    vec4 albedo = texture(gTexture, FragTex);
+    vec3 n = normalize(FragNorm);
+
+    float diffuse = max(dot(n, -shadowLight.xyz), 0.0);
+    if (diffuse > 0.0)
+        diffuse *= shadow(n);
+
+    FragColor = vec4(albedo.rgb * (0.25 + 0.75 * diffuse), albedo.a);
+    FragNormal = vec4(n, 1.0);
+}
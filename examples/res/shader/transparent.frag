@@ -0,0 +1,23 @@
+#version 330 core
+
+// Weighted blended transparency, drawn by TransparencyRenderer
+layout (location = 0) out vec4 Accum;
+layout (location = 1) out vec4 Revealage;
+
+uniform sampler2D gTexture;
+// Material::alpha
+uniform float materialAlpha;
+
+in vec3 FragPos;
+in vec3 FragNorm;
+in vec2 FragTex;
+
+void main() {
+    vec4 color = texture(gTexture, FragTex);
+    color.a *= materialAlpha;
+
+    // Nearer and more opaque surfaces count for more in the average
+    float weight = color.a * max(1e-2, 3e3 * pow(1.0 - gl_FragCoord.z, 3.0));
+    Accum = vec4(color.rgb * color.a, color.a) * weight;
+    Revealage = vec4(color.a);
+}
@@ -11,43 +11,31 @@
 using namespace singe;
 
 #include <glm/glm.hpp>
-#include <glpp/Buffer.hpp>
-#include <glpp/extra/Line.hpp>
-#include <memory>
+#include <singe/Graphics/DebugLines.hpp>
 #include <vector>
-using glpp::BufferArray;
-using glpp::Buffer;
 
 
 class Diamond {
-    glpp::extra::Line::Ptr line;
+    std::vector<glm::vec3> points;
 
     glm::vec2 size;
     glm::vec4 color;
     glm::vec2 pos;
 
     void updateLine() {
-        std::vector<glm::vec3> points;
-
         float x = pos.x;
         float y = pos.y;
 
+        points.clear();
         points.emplace_back(x - size.x, y, 0);
         points.emplace_back(x, y - size.y, 0);
-        points.emplace_back(x, y - size.y, 0);
-        points.emplace_back(x + size.x, y, 0);
         points.emplace_back(x + size.x, y, 0);
         points.emplace_back(x, y + size.y, 0);
-        points.emplace_back(x, y + size.y, 0);
-        points.emplace_back(x - size.x, y, 0);
-
-        line->setPoints(std::move(points));
     }
 
 public:
     Diamond(glm::vec2 size, const glm::vec4 & color)
-        : line(std::make_shared<glpp::extra::Line>(glm::vec4(1.0, 0.0, 0.0, 1.0))),
-          size(size),
+        : size(size),
           color(color),
           pos(0) {
         updateLine();
@@ -71,7 +59,7 @@ public:
         updateLine();
     }
 
-    void draw() const {
-        line->draw(glm::mat4(1.0));
+    void draw(DebugLines & lines) const {
+        lines.addStrip(points, color, true);
     }
 };
@@ -24,9 +24,6 @@ Game::Game(Window::Ptr & window)
 
     scene.grid = make_shared<Grid>(10, vec4(1, 1, 1, 1), true);
 
-    line = make_shared<glpp::extra::Line>(vec3(0, 0, 0), vec3(1, 2, 3),
-                                          vec4(1.0, 0.0, 1.0, 1.0));
-
     scene.models = res.loadModel("model/angle_cube.obj");
     scene.models[0]->material->shader = shader;
 
@@ -49,18 +46,20 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, false);
+    // gl.setEnabled(GL_CULL_FACE, true);
+    // gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
+    auto & gl = StateCache::current();
     setupGl();
 
     RenderState state(camera);
@@ -69,13 +68,15 @@ void Game::onDraw() const {
 
     mat4 mvp = state.getMVP();
 
-    line->draw(mvp);
+    lines.add(vec3(0, 0, 0), vec3(1, 2, 3), vec4(1.0, 0.0, 1.0, 1.0));
+    lines.draw(mvp);
 
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    gl.setEnabled(GL_CULL_FACE, false);
+    gl.setEnabled(GL_DEPTH_TEST, false);
+    gl.setEnabled(GL_BLEND, false);
 
-    circle->draw();
+    circle->draw(lines);
+    lines.draw(mat4(1.0));
 
     glpp::BufferArray::unbind();
 }
@@ -4,13 +4,14 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/DebugLines.hpp>
 #include <singe/Graphics/Model.hpp>
 #include <singe/Graphics/Scene.hpp>
 #include <singe/Graphics/Shader.hpp>
+#include <singe/Graphics/StateCache.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 
-#include <glpp/extra/Line.hpp>
 #include <memory>
 
 #include "Diamond.hpp"
@@ -22,7 +23,7 @@ class Game : public GameBase {
     singe::Shader::Ptr       circle_shader;
     Scene                    scene;
     std::shared_ptr<Diamond> circle;
-    glpp::extra::Line::Ptr   line;
+    mutable DebugLines       lines;
 
 public:
     Game(Window::Ptr & window);
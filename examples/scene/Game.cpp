@@ -1,13 +1,23 @@
 #include "Game.hpp"
 
+#include <cmath>
+#include <glm/gtc/constants.hpp>
 #include <stdexcept>
 
 Game::Game(Window::Ptr & window)
     : GameBase(window),
       res("../../../examples/res"),
       shader(res.getMVPShader("shader/default.vert", "shader/default.frag")),
+      clusteredShader(
+          res.getMVPShader("shader/default.vert", "shader/clustered.frag")),
+      shadowedShader(
+          res.getMVPShader("shader/default.vert", "shader/shadowed.frag")),
+      transparentShader(
+          res.getMVPShader("shader/default.vert", "shader/transparent.frag")),
       grid(10, {1, 1, 1, 1}, true),
       showGrid(true),
+      showGlass(true),
+      lighting(Deferred),
       wireframe(Fill) {
 
     camera.setPosition({5, 2, 5});
@@ -35,9 +45,32 @@ Game::Game(Window::Ptr & window)
     modelScene->models = res.loadModel("model/Human.obj");
     modelScene->transform.move({3, 0, 0});
 
-    for (auto & s : scene.children) {
-        for (auto & ss : s->children) {
-            for (auto & m : ss->models) m->material->shader = shader;
+    setShader(shader);
+
+    // Ring of coloured point lights, the scene spins so they all move
+    scene.lights.push_back(
+        singe::Light::directional({-1, -2, -1}, {1, 0.95, 0.9}, 0.3));
+    lightScene = scene.addChild();
+    const int nLights = 128;
+    for (int i = 0; i < nLights; i++) {
+        float angle = glm::two_pi<float>() * i / nLights;
+        vec3  color(0.5 + 0.5 * std::sin(angle),
+                    0.5 + 0.5 * std::sin(angle + 2.1),
+                    0.5 + 0.5 * std::sin(angle + 4.2));
+        vec3  position(4 * std::cos(angle), 0.5 + i % 3, 4 * std::sin(angle));
+        lightScene->lights.push_back(
+            singe::Light::point(position, color, 4, 3));
+    }
+
+    // Overlapping glass spheres drawn unsorted through TransparencyRenderer
+    for (int i = 0; i < 5; i++) {
+        auto sphereScene = glassScene.addChild();
+        sphereScene->models = res.loadModel("model/sphere.obj");
+        sphereScene->transform.move({-2 + i, 1, -2 - 0.5 * (i % 2)});
+        sphereScene->transform.scale({0.75, 0.75, 0.75});
+        for (auto & m : sphereScene->models) {
+            m->material->shader = transparentShader;
+            m->material->alpha = 0.3 + 0.1 * i;
         }
     }
 
@@ -58,10 +91,22 @@ Game::Game(Window::Ptr & window)
     Logging::Game->info("2 - Line");
     Logging::Game->info("3 - Fill");
     Logging::Game->info("G - Toggle Grid");
+    Logging::Game->info("T - Toggle Glass");
+    Logging::Game->info("R - Toggle Dynamic Resolution");
+    Logging::Game->info("P - Toggle GPU Profiler");
+    Logging::Game->info("L - Cycle Unlit / Deferred / Clustered / Shadowed");
 }
 
 Game::~Game() {}
 
+void Game::setShader(const singe::MVPShader::Ptr & shader) {
+    for (auto & s : scene.children) {
+        for (auto & ss : s->children) {
+            for (auto & m : ss->models) m->material->shader = shader;
+        }
+    }
+}
+
 void Game::onKeyPressed(const sf::Event::KeyEvent & event) {
     switch (event.code) {
         case sf::Keyboard::Num1:
@@ -76,6 +121,37 @@ void Game::onKeyPressed(const sf::Event::KeyEvent & event) {
         case sf::Keyboard::G:
             showGrid = !showGrid;
             break;
+        case sf::Keyboard::R:
+            if (dynamicResolution) {
+                Logging::Game->info("Native resolution");
+                disableDynamicResolution();
+            }
+            else {
+                Logging::Game->info("Dynamic resolution, 8 ms GPU target");
+                enableDynamicResolution(8.0f, 0.5f, 1.0f);
+            }
+            break;
+        case sf::Keyboard::P:
+            if (GpuProfiler::current().isEnabled())
+                hideGpuProfiler();
+            else
+                showGpuProfiler();
+            break;
+        case sf::Keyboard::T:
+            showGlass = !showGlass;
+            break;
+        case sf::Keyboard::L:
+            lighting = LightingMode((lighting + 1) % 4);
+            if (lighting == Clustered)
+                setShader(clusteredShader);
+            else if (lighting == Shadowed) {
+                setShader(shadowedShader);
+                // The static casters kept rotating in the other modes
+                shadows.invalidateStatic();
+            }
+            else
+                setShader(shader);
+            break;
         default:
             break;
     }
@@ -85,19 +161,23 @@ void Game::onKeyPressed(const sf::Event::KeyEvent & event) {
 void Game::onUpdate(const sf::Time & delta) {
     float s = delta.asSeconds();
     scene.children[0]->children[0]->transform.rotateEuler({s, s * 0.2, 0});
-    otherScene->transform.rotateEuler({0, s * 0.1, 0});
+    // The other scene is the static caster set while shadowed, keep it still
+    // so its cascades stay cached
+    if (lighting != Shadowed)
+        otherScene->transform.rotateEuler({0, s * 0.1, 0});
+    lightScene->transform.rotateEuler({0, s * 0.5, 0});
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, true);
+    gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
@@ -107,7 +187,27 @@ void Game::onDraw() const {
     glPointSize(2.0);
 
     RenderState state(camera);
-    scene.draw(state);
+    switch (lighting) {
+        case Deferred:
+            deferred.draw(scene, state, queue);
+            break;
+        case Clustered:
+            clustered.draw(scene, state, queue);
+            break;
+        case Shadowed:
+            shadows.render(state, {-1, -2, -1}, otherScene.get(),
+                           scene.children[0].get());
+            shadows.bind();
+            scene.draw(state, queue);
+            break;
+        default:
+            scene.draw(state, queue);
+            break;
+    }
+
+    if (showGlass) {
+        transparency.draw(glassScene, state, queue);
+    }
 
     if (showGrid) {
         grid.draw(state.getMVP());
@@ -4,7 +4,12 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/ClusteredLights.hpp>
+#include <singe/Graphics/DeferredRenderer.hpp>
 #include <singe/Graphics/Scene.hpp>
+#include <singe/Graphics/ShadowCascades.hpp>
+#include <singe/Graphics/StateCache.hpp>
+#include <singe/Graphics/TransparencyRenderer.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 
@@ -19,10 +24,32 @@ using namespace glm;
 class Game : public GameBase {
     ResourceManager       res;
     singe::MVPShader::Ptr shader;
+    singe::MVPShader::Ptr clusteredShader;
+    singe::MVPShader::Ptr shadowedShader;
+    singe::MVPShader::Ptr transparentShader;
     Grid                  grid;
     singe::Scene          scene;
     singe::Scene::Ptr     otherScene;
+    singe::Scene::Ptr     lightScene;
+    singe::Scene          glassScene;
     bool                  showGrid;
+    bool                  showGlass;
+
+    enum LightingMode {
+        Unlit,
+        Deferred,
+        Clustered,
+        Shadowed,
+    };
+
+    LightingMode                 lighting;
+    mutable DeferredRenderer     deferred;
+    mutable ClusteredLights      clustered;
+    mutable ShadowCascades       shadows;
+    mutable TransparencyRenderer transparency;
+    mutable RenderQueue          queue;
+
+    void setShader(const singe::MVPShader::Ptr & shader);
 
     enum DisplayMode {
         Point = GL_POINT,
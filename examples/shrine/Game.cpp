@@ -12,11 +12,6 @@ Game::Game(Window::Ptr & window)
     camera.setPosition({5, 2, 5});
     camera.setRotation({0.2, -0.75, 0});
 
-    shared_ptr<Scene> modelScene;
-
-    modelScene = scene.addChild();
-    modelScene->models = res.loadModel("model/plane.obj");
-
     pillar = scene.addChild();
     pillar->models = res.loadModel("model/pillar.obj");
 
@@ -24,9 +19,23 @@ Game::Game(Window::Ptr & window)
         for (auto & m : s->models) m->material->shader = shader;
     }
 
-    // Load models / textures / scenes
-    // No fancy render api, just each model can be drawn
-    // Maybe add something like pyglet Batch to group rendering
+    // The ground never moves, so it is copied into one multi draw
+    ground.models = res.loadModel("model/plane.obj");
+    if (Batch::supported()) {
+        auto batchShader =
+            res.getMVPShader("shader/batch.vert", "shader/batch.frag");
+        for (auto & m : ground.models) m->material->shader = batchShader;
+        arrays.add(ground);
+        arrays.build();
+        batch.add(ground);
+        batch.build();
+        Logging::Game->info("Ground batched into {} draws",
+                                batch.bucketCount());
+    }
+    else {
+        for (auto & m : ground.models) m->material->shader = shader;
+        scene.children.push_back(std::make_shared<Scene>(std::move(ground)));
+    }
 
     window->setMouseGrab(false);
 }
@@ -60,15 +69,15 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, true);
+    gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
@@ -76,6 +85,7 @@ void Game::onDraw() const {
 
     RenderState state(camera);
     scene.draw(state);
+    batch.draw(state);
 
     grid.draw(state.getMVP());
 
@@ -4,7 +4,10 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/Batch.hpp>
 #include <singe/Graphics/Scene.hpp>
+#include <singe/Graphics/StateCache.hpp>
+#include <singe/Graphics/TextureArrays.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 
@@ -20,6 +23,10 @@ class Game : public GameBase {
     Grid                   grid;
     Scene                  scene;
     std::shared_ptr<Scene> pillar;
+    /// The static ground is packed and drawn by batch when supported
+    Scene                  ground;
+    TextureArrays          arrays;
+    Batch                  batch;
     float                  tPillar;
 
 public:
@@ -6,7 +6,9 @@ Game::Game(Window::Ptr & window)
     : GameBase(window),
       res("../../../examples/res"),
       shader(res.getMVPShader("shader/default.vert", "shader/default.frag")),
-      grid(10, {1, 1, 1, 1}, true) {
+      grid(10, {1, 1, 1, 1}, true),
+      spin(0),
+      lastSpin(0) {
 
     camera.setPosition({5, 2, 5});
     camera.setRotation({0.2, -0.75, 0});
@@ -27,33 +29,43 @@ Game::Game(Window::Ptr & window)
     // No fancy render api, just each model can be drawn
     // Maybe add something like pyglet Batch to group rendering
 
+    // Simulate slower than the display, onDraw interpolates between steps
+    enableFixedUpdate(20.0f);
+
     window->setMouseGrab(true);
 }
 
 Game::~Game() {}
 
-void Game::onUpdate(const sf::Time & delta) {
-    float s = delta.asSeconds();
-    // TODO: update here
-    scene.transform.rotateEuler({0, s * 0.5, 0});
-    scene.children[0]->transform.rotateEuler({0, -s, 0});
+void Game::onUpdate(const sf::Time & delta) {}
+
+void Game::onFixedUpdate(const sf::Time & step) {
+    lastSpin = spin;
+    spin += step.asSeconds() * 0.5f;
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, false);
+    // gl.setEnabled(GL_CULL_FACE, true);
+    // gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void Game::onDraw() const {
+void Game::onDraw(float alpha) const {
     setupGl();
 
+    float yaw = lastSpin + (spin - lastSpin) * alpha;
+    scene.transform =
+        Transform({0, 0, 0}, glm::quat(glm::vec3(0, yaw, 0)), {1, 1, 1});
+    scene.children[0]->transform =
+        Transform({0, 0, 3}, glm::quat(glm::vec3(0, -2 * yaw, 0)), {1, 1, 1});
+
     RenderState state(camera);
     scene.draw(state);
 
@@ -5,6 +5,7 @@
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
 #include <singe/Graphics/Scene.hpp>
+#include <singe/Graphics/StateCache.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 
@@ -18,12 +19,16 @@ class Game : public GameBase {
     FPSDisplay            fps;
     singe::MVPShader::Ptr shader;
     Grid                  grid;
-    Scene                 scene;
+    // Posed in onDraw() between the last two fixed steps
+    mutable Scene         scene;
+    float                 spin;
+    float                 lastSpin;
 
 public:
     Game(Window::Ptr & window);
     virtual ~Game();
 
     void onUpdate(const sf::Time & delta) override;
-    void onDraw(void) const override;
+    void onFixedUpdate(const sf::Time & step) override;
+    void onDraw(float alpha) const override;
 };
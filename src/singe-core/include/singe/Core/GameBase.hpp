@@ -10,8 +10,10 @@
 #include <vector>
 
 #include "singe/Core/FPSDisplay.hpp"
+#include "singe/Core/GpuProfilerDisplay.hpp"
 #include "singe/Core/Menu.hpp"
 #include "singe/Core/Window.hpp"
+#include "singe/Graphics/DynamicResolution.hpp"
 
 namespace singe::Logging {
     extern Logger::Ptr Game;
@@ -28,6 +30,11 @@ namespace singe {
      * The user must provide the onCreate, onDestroy, onUpdate and onDraw
      * methods.
      *
+     * With GameBase::enableFixedUpdate() the simulation runs in
+     * onFixedUpdate() at a fixed rate, independent of the frame rate.
+     * onDraw(float) is given how far the frame is between the last two
+     * steps, to interpolate the simulation state.
+     *
      * The user may optionally override the onKeyPressed, onKeyReleased,
      * onMouseMove, onMouseDown, onMouseUp, onMouseScroll or onResized.
      */
@@ -35,6 +42,17 @@ namespace singe {
         glm::vec2 mouseSensitivity;
         float     moveSpeed;
         bool      fpsShow;
+        bool      gpuProfilerShow;
+        sf::Time  fixedStep;
+        size_t    maxFixedSteps;
+        sf::Time  fixedTime;
+
+        /**
+         * Run the fixed steps that fit in the time since the last frame.
+         *
+         * @return the fraction of a step left over
+         */
+        float runFixedSteps(const sf::Time & delta);
 
     protected:
         /// Reference to the Window object
@@ -49,6 +67,9 @@ namespace singe {
 
         FPSDisplay fpsDisplay;
 
+        /// Shows the GpuProfiler timings, see GameBase::showGpuProfiler()
+        GpuProfilerDisplay gpuProfilerDisplay;
+
         /**
          * Pointer to the Menu object created by GameBase.
          *
@@ -59,6 +80,14 @@ namespace singe {
         /// A font loaded from memory to act as the default font for GameBase.
         sf::Font uiFont;
 
+        /**
+         * Scales the resolution onDraw() renders at, the overlay stays at
+         * native resolution. Set by GameBase::enableDynamicResolution().
+         *
+         * This pointer is nullptr when onDraw() renders at native resolution.
+         */
+        DynamicResolution::Ptr dynamicResolution;
+
     public:
         /**
          * Construct a new GameBase.
@@ -107,6 +136,61 @@ namespace singe {
 
         void hideFps();
 
+        /**
+         * Enable the GpuProfiler and show its timings below the frame rate.
+         * GameBase times onDraw() as Draw and the overlay as Overlay, passes
+         * add their own scopes inside them.
+         */
+        void showGpuProfiler();
+
+        /**
+         * Hide the GpuProfiler timings and disable the profiler.
+         */
+        void hideGpuProfiler();
+
+        /**
+         * Run onFixedUpdate() at a fixed rate. Time left over is carried to
+         * the next frame. If the simulation falls behind by more than
+         * maxSteps it is dropped, the simulation slows down instead of
+         * taking longer every frame.
+         *
+         * @param rate the steps per second
+         * @param maxSteps the most steps run in one frame
+         */
+        void enableFixedUpdate(float rate = 60.0f, size_t maxSteps = 5);
+
+        /**
+         * Stop calling onFixedUpdate(), onDraw(float) is given 1.
+         */
+        void disableFixedUpdate();
+
+        /**
+         * Capture the CPU profiler zones of the next frames to a Chrome
+         * trace file, see Profiler. F12 captures with the defaults.
+         *
+         * @param frames the number of frames to capture
+         * @param path the trace file to write
+         */
+        void captureProfile(size_t              frames = 120,
+                            const std::string & path = "singe-trace.json");
+
+        /**
+         * Render onDraw() into a scaled target that follows the GPU time,
+         * see DynamicResolution.
+         *
+         * @param targetTime the GPU time per frame to hold in milliseconds
+         * @param minScale the lowest fraction of the window size
+         * @param maxScale the highest fraction of the window size
+         */
+        void enableDynamicResolution(float targetTime = 14.0f,
+                                     float minScale = 0.5f,
+                                     float maxScale = 1.0f);
+
+        /**
+         * Render onDraw() at native resolution again.
+         */
+        void disableDynamicResolution();
+
     protected:
         /**
          * Process any updates before drawing the next frame.
@@ -115,10 +199,28 @@ namespace singe {
          */
         virtual void onUpdate(const sf::Time & delta) = 0;
 
+        /**
+         * Advance the simulation by one fixed step, see
+         * GameBase::enableFixedUpdate(). Called before onUpdate(), zero or
+         * more times per frame.
+         *
+         * @param step the fixed time step
+         */
+        virtual void onFixedUpdate(const sf::Time & step) {}
+
         /**
          * Draw the frame.
          */
-        virtual void onDraw() const = 0;
+        virtual void onDraw() const {}
+
+        /**
+         * Draw the frame between the last two fixed steps. Calls onDraw() by
+         * default.
+         *
+         * @param alpha how far past the last step the frame is, from 0 to 1,
+         *              always 1 without a fixed update
+         */
+        virtual void onDraw(float alpha) const;
 
         /**
          * Event callback for a key press event.
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <memory>
+
+#include "singe/Graphics/GpuProfiler.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * An SFML Text that shows the scope timings of a GpuProfiler, one line
+     * per scope indented by its depth.
+     */
+    class GpuProfilerDisplay : public sf::Text {
+        float time;
+        float rate;
+
+        /**
+         * Update the sf::Text object with the latest timings.
+         */
+        void updateLabel(const GpuProfiler & profiler);
+
+    public:
+        using Ptr = shared_ptr<GpuProfilerDisplay>;
+        using ConstPtr = shared_ptr<const GpuProfilerDisplay>;
+
+        /**
+         * Create a new GpuProfilerDisplay.
+         */
+        GpuProfilerDisplay();
+
+        /**
+         * Destructor for GpuProfilerDisplay.
+         */
+        virtual ~GpuProfilerDisplay();
+
+        /**
+         * Set the update rate for the text display.
+         *
+         * @param delta the time between updates
+         */
+        void setRate(float delta);
+
+        /**
+         * Update and refresh display.
+         *
+         * @param profiler the profiler to show the timings of
+         * @param delta the delta time
+         */
+        void update(const GpuProfiler & profiler, const sf::Time & delta);
+    };
+}
@@ -130,10 +130,12 @@ namespace singe {
          * Load a model.
          *
          * @param path the model path relative to resource root
+         * @param format the vertex buffer layout of the models
          *
          * @return vector of models
          */
-        vector<Model::Ptr> loadModel(const string & path);
+        vector<Model::Ptr> loadModel(const string &      path,
+                                     Model::VertexFormat format = Model::Float);
 
         /**
          * Load a scene.
@@ -131,6 +131,21 @@ namespace singe {
 
         void display();
 
+        /**
+         * Wait for the monitor refresh in Window::display(). On by default.
+         *
+         * @param enabled true to synchronize with the monitor
+         */
+        void setVsync(bool enabled);
+
+        /**
+         * Limit the frame rate by sleeping in Window::display(). The default
+         * limit is 60.
+         *
+         * @param limit the most frames per second, 0 for no limit
+         */
+        void setFramerateLimit(unsigned int limit);
+
         void addEventHandler(EventHandler * handler);
     };
 }
@@ -4,11 +4,17 @@
 #include <GL/glew.h>
 
 #include <SFML/OpenGL.hpp>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glpp/FrameBuffer.hpp>
+#include <singe/Support/Profiler.hpp>
 
 #include "default_font.h"
 #include "singe/Core/GameBase.hpp"
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/StreamBuffer.hpp"
+#include "singe/Graphics/UniformBuffers.hpp"
 
 namespace singe::Logging {
     Logger::Ptr Game = std::make_shared<Logger>("Game");
@@ -21,11 +27,14 @@ namespace singe {
           mouseSensitivity(0.2, 0.2),
           moveSpeed(5),
           fpsShow(true),
+          gpuProfilerShow(false),
+          maxFixedSteps(0),
           camera(window->getSize(), Camera::Perspective, 80.0f),
           menu(nullptr) {
 
         uiFont.loadFromMemory(__default_font_start, __default_font_size);
         fpsDisplay.setFont(uiFont);
+        gpuProfilerDisplay.setFont(uiFont);
 
         menu = std::make_shared<Menu>(uiFont, window->title);
         menu->setPosition(300, 300);
@@ -46,10 +55,15 @@ namespace singe {
 
     void GameBase::Start(void) {
         Logging::Core->info("starting main game loop");
+        Profiler::setThreadName("Main");
 
         sf::Clock clock;
+        sf::Clock gameClock;
 
         while (window->isOpen()) {
+            Profiler::frame();
+            SINGE_PROFILE_SCOPE("GameBase::Start");
+
             window->poll();
 
             sf::Time delta = clock.restart();
@@ -81,13 +95,47 @@ namespace singe {
                                   z * delta.asSeconds() * moveSpeed});
             }
 
+            auto & profiler = GpuProfiler::current();
+            profiler.beginFrame();
+
             fpsDisplay.update(delta);
-            onUpdate(delta);
+            if (gpuProfilerShow)
+                gpuProfilerDisplay.update(profiler, delta);
+            float alpha = 1.0f;
+            if (fixedStep != sf::Time::Zero) {
+                SINGE_PROFILE_SCOPE("GameBase::onFixedUpdate");
+                alpha = runFixedSteps(delta);
+            }
+            {
+                SINGE_PROFILE_SCOPE("GameBase::onUpdate");
+                onUpdate(delta);
+            }
 
             FrameBuffer::unbind(); // Bind default frame buffer
             FrameBuffer::clear();
-            onDraw();
-            if (menu || fpsShow) {
+            // The overlay and any direct glpp draws from the last frame may
+            // have changed bindings without the StateCache
+            StateCache::current().invalidateBindings();
+            UniformBuffers::current().setTime(
+                gameClock.getElapsedTime().asSeconds());
+            profiler.begin("Draw");
+            {
+                SINGE_PROFILE_SCOPE("GameBase::onDraw");
+                if (dynamicResolution) {
+                    auto size = window->getSize();
+                    dynamicResolution->begin(size.x, size.y);
+                    onDraw(alpha);
+                    dynamicResolution->end();
+                }
+                else {
+                    onDraw(alpha);
+                }
+            }
+            profiler.end();
+
+            bool overlay = menu || fpsShow || gpuProfilerShow;
+            profiler.begin("Overlay");
+            if (overlay) {
                 window->window.pushGLStates();
             }
 
@@ -95,12 +143,35 @@ namespace singe {
                 window->window.draw(*menu);
             if (fpsShow)
                 window->window.draw(fpsDisplay);
+            if (gpuProfilerShow)
+                window->window.draw(gpuProfilerDisplay);
 
-            if (menu || fpsShow) {
+            if (overlay) {
                 window->window.popGLStates();
             }
+            profiler.end();
             window->display();
+            StreamBuffer::current().endFrame();
         }
+
+        // Write a capture cut short by closing the window
+        Profiler::stop();
+    }
+
+    float GameBase::runFixedSteps(const sf::Time & delta) {
+        fixedTime += delta;
+
+        size_t steps = 0;
+        for (; fixedTime >= fixedStep && steps < maxFixedSteps; steps++) {
+            onFixedUpdate(fixedStep);
+            fixedTime -= fixedStep;
+        }
+
+        // Too far behind to catch up, drop whole steps
+        if (fixedTime >= fixedStep)
+            fixedTime %= fixedStep;
+
+        return fixedTime / fixedStep;
     }
 
     void GameBase::Stop(void) {
@@ -130,6 +201,51 @@ namespace singe {
         fpsShow = false;
     }
 
+    void GameBase::showGpuProfiler() {
+        gpuProfilerShow = true;
+        GpuProfiler::current().setEnabled(true);
+    }
+
+    void GameBase::hideGpuProfiler() {
+        gpuProfilerShow = false;
+        GpuProfiler::current().setEnabled(false);
+    }
+
+    void GameBase::enableFixedUpdate(float rate, size_t maxSteps) {
+        fixedStep = sf::seconds(1.0f / rate);
+        maxFixedSteps = std::max<size_t>(maxSteps, 1);
+        fixedTime = sf::Time::Zero;
+    }
+
+    void GameBase::disableFixedUpdate() {
+        fixedStep = sf::Time::Zero;
+    }
+
+    void GameBase::captureProfile(size_t frames, const std::string & path) {
+        Profiler::capture(frames, path);
+    }
+
+    void GameBase::enableDynamicResolution(float targetTime,
+                                           float minScale,
+                                           float maxScale) {
+        if (dynamicResolution) {
+            dynamicResolution->setTargetTime(targetTime);
+            dynamicResolution->setScaleBounds(minScale, maxScale);
+        }
+        else {
+            dynamicResolution = std::make_shared<DynamicResolution>(
+                targetTime, minScale, maxScale);
+        }
+    }
+
+    void GameBase::disableDynamicResolution() {
+        dynamicResolution = nullptr;
+    }
+
+    void GameBase::onDraw(float alpha) const {
+        onDraw();
+    }
+
     void GameBase::onKeyPressed(const sf::Event::KeyEvent & event) {
         if (event.code == sf::Keyboard::Escape) {
             window->setMouseGrab(!window->getMouseGrab());
@@ -140,6 +256,9 @@ namespace singe {
                 menu->show();
             }
         }
+        else if (event.code == sf::Keyboard::F12) {
+            captureProfile();
+        }
     }
 
     void GameBase::onResized(const sf::Event::SizeEvent & event) {
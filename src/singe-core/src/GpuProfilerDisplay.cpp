@@ -0,0 +1,47 @@
+#include "singe/Core/GpuProfilerDisplay.hpp"
+
+#include <fmt/format.h>
+
+namespace singe {
+    GpuProfilerDisplay::GpuProfilerDisplay() : time(0.0f), rate(0.5f) {
+        setString("GPU: N/A");
+        setCharacterSize(14);
+        setFillColor(sf::Color(200, 200, 200));
+        setOrigin(getLocalBounds().left, getLocalBounds().top);
+        // Below the FPSDisplay
+        setPosition(10, 30);
+    }
+
+    GpuProfilerDisplay::~GpuProfilerDisplay() {}
+
+    void GpuProfilerDisplay::updateLabel(const GpuProfiler & profiler) {
+        auto & timings = profiler.getTimings();
+        if (timings.empty()) {
+            setString("GPU: N/A");
+            return;
+        }
+
+        std::string label = "GPU:";
+        for (auto & timing : timings) {
+            label += fmt::format("\n{:>{}}{} {:.2f} ms", "", timing.depth * 2,
+                                 timing.name, timing.milliseconds);
+            if (timing.calls > 1)
+                label += fmt::format(" ({}x)", timing.calls);
+        }
+        setString(label);
+    }
+
+    void GpuProfilerDisplay::setRate(float delta) {
+        rate = delta;
+    }
+
+    void GpuProfilerDisplay::update(const GpuProfiler & profiler,
+                                    const sf::Time &    delta) {
+        time += delta.asSeconds();
+
+        if (time > rate) {
+            updateLabel(profiler);
+            time = 0.0f;
+        }
+    }
+}
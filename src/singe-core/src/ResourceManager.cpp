@@ -3,6 +3,9 @@
 #include <Wavefront.hpp>
 #include <filesystem>
 #include <fstream>
+#include <singe/Graphics/InstancedModel.hpp>
+#include <singe/Graphics/MeshOptimizer.hpp>
+#include <singe/Support/Profiler.hpp>
 #include <singe/Support/SceneParser.hpp>
 #include <singe/Support/log.hpp>
 #include <string_view>
@@ -50,6 +53,7 @@ namespace singe {
     }
 
     Texture::Ptr ResourceManager::getTexture(const string & path, bool useCached) {
+        SINGE_PROFILE_SCOPE("ResourceManager::getTexture");
         Logging::Resource->info("ResourceManager::getTexture {} {}", path,
                                 useCached);
 
@@ -74,6 +78,7 @@ namespace singe {
     Shader::Ptr ResourceManager::getShader(const string & vertPath,
                                            const string & fragPath,
                                            bool           useCached) {
+        SINGE_PROFILE_SCOPE("ResourceManager::getShader");
         Logging::Resource->info("ResourceManager::getShader {} {} {}", vertPath,
                                 fragPath, useCached);
 
@@ -102,6 +107,7 @@ namespace singe {
     MVPShader::Ptr ResourceManager::getMVPShader(const string & vertPath,
                                                  const string & fragPath,
                                                  bool           useCached) {
+        SINGE_PROFILE_SCOPE("ResourceManager::getMVPShader");
         Logging::Resource->info("ResourceManager::getMVPShader {} {} {}",
                                 vertPath, fragPath, useCached);
 
@@ -127,7 +133,9 @@ namespace singe {
         return shader;
     }
 
-    vector<Model::Ptr> ResourceManager::loadModel(const string & path) {
+    vector<Model::Ptr> ResourceManager::loadModel(const string &      path,
+                                                  Model::VertexFormat format) {
+        SINGE_PROFILE_SCOPE("ResourceManager::loadModel");
         Logging::Resource->info("ResourceManager::loadModel {}", path);
 
         fs::path fullPath = resourceAt(path);
@@ -176,6 +184,27 @@ namespace singe {
                                            obj->texcoords[i]);
             }
 
+            size_t listBytes = model->points.size() * sizeof(Vertex);
+
+            model->indices = MeshOptimizer::weld(model->points);
+            float weldedAcmr = MeshOptimizer::acmr(model->indices);
+            model->optimize();
+            float optimizedAcmr = MeshOptimizer::acmr(model->indices);
+
+            size_t indexSize = model->points.size() <= 0x10000 ? sizeof(uint16_t)
+                                                               : sizeof(uint32_t);
+            size_t indexedBytes = model->points.size() * sizeof(Vertex)
+                                  + model->indices.size() * indexSize;
+            Logging::Resource->debug(
+                "Object {} welded {} to {} vertices, ACMR {:.3f} unindexed, "
+                "{:.3f} welded, {:.3f} optimized, {} of {} bytes saved",
+                obj->name, obj->size(), model->points.size(),
+                obj->size() > 0 ? 3.0f : 0.0f, weldedAcmr, optimizedAcmr,
+                listBytes > indexedBytes ? listBytes - indexedBytes : 0,
+                listBytes);
+
+            // Choose the format before the first upload
+            model->format = format;
             model->update();
 
             if (0 > obj->matId >= materials.size())
@@ -191,6 +220,18 @@ namespace singe {
         return Transform(transform.pos, glm::quat(transform.rot), transform.scale);
     }
 
+    static Light convertLight(const scene::Light & resLight) {
+        Light light(resLight.type == scene::Light::DIRECTIONAL
+                        ? Light::Directional
+                        : Light::Point);
+        light.position = resLight.position;
+        light.direction = resLight.direction;
+        light.color = resLight.color;
+        light.intensity = resLight.intensity;
+        light.radius = resLight.radius;
+        return light;
+    }
+
     static Scene::Ptr convertScene(ResourceManager *          res,
                                    shared_ptr<scene::Scene> & resScene) {
         auto scene = make_shared<Scene>();
@@ -206,9 +247,28 @@ namespace singe {
         // TODO: Cameras
 
         for (auto & resModel : resScene->models) {
-            auto models = res->loadModel(resModel.mesh.path);
+            auto format = resModel.mesh.format == "packed" ? Model::Packed
+                                                           : Model::Float;
+            auto models = res->loadModel(resModel.mesh.path, format);
 
             for (auto & model : models) {
+                if (!resModel.instances.empty()) {
+                    auto instanced = make_shared<InstancedModel>(move(*model));
+                    for (auto & instance : resModel.instances)
+                        instanced->instances.emplace_back(convertTransform(instance));
+                    instanced->updateInstances();
+                    model = instanced;
+                }
+                else if (!resModel.lods.empty()) {
+                    vector<float> ratios;
+                    vector<float> sizes;
+                    for (auto & lod : resModel.lods) {
+                        ratios.push_back(lod.ratio);
+                        sizes.push_back(lod.size);
+                    }
+                    model->generateLods(ratios, sizes);
+                }
+
                 model->transform = convertTransform(resModel.transform);
 
                 string vertSource;
@@ -233,16 +293,16 @@ namespace singe {
                 scene->models.emplace_back(model);
             }
 
-            // TODO: mesh
-            // model->res->loadModel()
-            res->loadModel(resModel.mesh.path);
-
             // TODO: shader
             // model->material->shader = res->loadShader()
 
             // scene->models.emplace_back(model);
         }
 
+        for (auto & resLight : resScene->lights) {
+            scene->lights.emplace_back(convertLight(resLight));
+        }
+
         for (auto & child : resScene->children) {
             scene->children.emplace_back(convertScene(res, child));
         }
@@ -251,6 +311,7 @@ namespace singe {
     }
 
     Scene::Ptr ResourceManager::loadScene(const string & path) {
+        SINGE_PROFILE_SCOPE("ResourceManager::loadScene");
         Logging::Resource->info("ResourceManager::loadScene {}", path);
 
         fs::path fullPath = resourceAt(path);
@@ -264,7 +325,6 @@ namespace singe {
         }
 
         auto resScene = scene::SceneParser().parse(is);
-        auto scene = convertScene(this, resScene);
-        return scene;
+        return convertScene(this, resScene);
     }
 }
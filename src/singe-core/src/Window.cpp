@@ -1,6 +1,7 @@
 #include "singe/Core/Window.hpp"
 
 #include <iostream>
+#include <singe/Support/Profiler.hpp>
 
 namespace singe {
     const sf::ContextSettings settings(24, 1, 8, 3, 0);
@@ -75,6 +76,7 @@ namespace singe {
     for (auto & handler : handlers) handler->E;
 
     void Window::poll() {
+        SINGE_PROFILE_SCOPE("Window::poll");
         sf::Event event;
         while (window.pollEvent(event)) {
             switch (event.type) {
@@ -114,9 +116,18 @@ namespace singe {
 #undef FIRE_EVENT
 
     void Window::display() {
+        SINGE_PROFILE_SCOPE("Window::display");
         window.display();
     }
 
+    void Window::setVsync(bool enabled) {
+        window.setVerticalSyncEnabled(enabled);
+    }
+
+    void Window::setFramerateLimit(unsigned int limit) {
+        window.setFramerateLimit(limit);
+    }
+
     void Window::addEventHandler(EventHandler * handler) {
         handlers.push_back(handler);
     }
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Material.hpp"
+#include "Model.hpp"
+#include "RenderState.hpp"
+#include "Scene.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::vec4;
+
+    /**
+     * Pack many static Models into one shared vertex and index buffer and
+     * draw them with a single glMultiDrawElementsIndirect per bucket of
+     * shader and bound texture set. Models without indices are given
+     * sequential indices.
+     *
+     * Each draw gets a DrawData entry in a shader storage buffer at binding
+     * Batch::DrawDataBinding. The shader reads the entry with the draw id
+     * stored in attribute location Batch::DrawIdAttribute, see
+     * `shader/batch.vert` in the example resources. The mvp uniform of an
+     * MVPShader will receive the view projection matrix.
+     *
+     * Materials whose textures were packed by TextureArrays into the same
+     * arrays share a bucket. Their layer and region are taken from
+     * Material::layers into DrawData, and their colours and alpha into a
+     * MaterialData entry at binding Batch::MaterialDataBinding, instead of
+     * uniforms, see `shader/batch.frag`. Materials without a texture draw
+     * their diffuse colour. Models whose texture is not packed are skipped
+     * with a warning, as the shader only samples texture arrays.
+     *
+     * Batch needs OpenGL 4.3, or ARB_shader_storage_buffer_object,
+     * ARB_multi_draw_indirect and ARB_base_instance, see Batch::supported().
+     * Without them Batch::build() logs an error and Batch::draw() does
+     * nothing.
+     *
+     * Models are copied into the batch when added, later changes to a Model
+     * require the batch to be cleared and built again. The batch always uses
+     * the float vertex layout, Model::format is ignored.
+     */
+    class Batch {
+    public:
+        using Ptr = shared_ptr<Batch>;
+        using ConstPtr = const shared_ptr<Batch>;
+
+        /// Attribute location of the per-draw id
+        static constexpr GLuint DrawIdAttribute = 7;
+
+        /// Shader storage buffer binding of the DrawData array
+        static constexpr GLuint DrawDataBinding = 0;
+
+        /// Shader storage buffer binding of the MaterialData array
+        static constexpr GLuint MaterialDataBinding = 1;
+
+        /**
+         * Per-draw data read by the shader, matches std430 layout.
+         */
+        struct DrawData {
+            mat4     world;
+            /// Region of the layer of the first texture unit, uv offset in
+            /// xy and uv scale in zw
+            vec4     rect;
+            /// Index of the MaterialData entry
+            uint32_t material;
+            /// Layer of the first texture unit, -1 if it is not packed
+            int32_t  layer;
+            uint32_t padding[2];
+        };
+
+        /**
+         * Per-material data read by the shader, matches std430 layout.
+         */
+        struct MaterialData {
+            vec4 ambient;
+            /// Diffuse colour in rgb and Material::alpha in a
+            vec4 diffuse;
+            /// Specular colour in rgb and Material::specExp in a
+            vec4 specular;
+        };
+
+    private:
+        /// Layout of DrawElementsIndirectCommand
+        struct Command {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint  baseVertex;
+            GLuint baseInstance;
+        };
+
+        /// Textures bound per unit, see Material::boundTexture()
+        using TextureSet = std::array<const void *, Material::TextureUnits>;
+
+        struct Bucket {
+            /// First material added, binds the shader and textures. Other
+            /// materials only differ in MaterialData
+            Material::Ptr    material;
+            const Shader *   shader;
+            TextureSet       textures;
+            vector<Command>  commands;
+            vector<DrawData> draws;
+            size_t           offset;
+        };
+
+        GLuint vertexArray;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        GLuint drawIdBuffer;
+        GLuint commandBuffer;
+        GLuint drawDataBuffer;
+        GLuint materialBuffer;
+
+        vector<Vertex>       vertices;
+        vector<uint32_t>     indices;
+        vector<Bucket>       buckets;
+        vector<MaterialData> materials;
+        size_t           drawCount;
+        bool             built;
+
+        std::map<const Material *, uint32_t> materialIds;
+
+        Bucket & bucketFor(const Material::Ptr & material);
+
+        void release();
+
+    public:
+        Batch();
+
+        Batch(Batch && other);
+
+        Batch & operator=(Batch && other);
+
+        Batch(const Batch &) = delete;
+        Batch & operator=(const Batch &) = delete;
+
+        ~Batch();
+
+        /**
+         * Check if the context has the storage buffers and multi draw
+         * indirect with base instance that Batch draws with.
+         *
+         * @return true if Batch can draw
+         */
+        static bool supported();
+
+        /**
+         * Remove all models from the batch.
+         */
+        void clear();
+
+        /**
+         * Add a model to the batch with a world transform.
+         *
+         * @param model the Model to copy into the batch
+         * @param world the world transform of the model
+         */
+        void add(const Model & model, const mat4 & world = mat4(1));
+
+        /**
+         * Add all models in scene and it's child scenes to the batch.
+         *
+         * @param scene the Scene to copy models from
+         * @param parent the world transform of the scene's parent
+         */
+        void add(const Scene & scene, const mat4 & parent = mat4(1));
+
+        /**
+         * Upload the vertex, command and draw data buffers. This must be
+         * called after adding models and before Batch::draw(). Nothing is
+         * uploaded if Batch::supported() is false.
+         */
+        void build();
+
+        /**
+         * Get the number of buckets, which is the number of multi draw
+         * calls made by Batch::draw().
+         *
+         * @return the number of buckets
+         */
+        size_t bucketCount() const;
+
+        /**
+         * Get the number of models in the batch.
+         *
+         * @return the number of draws
+         */
+        size_t size() const;
+
+        /**
+         * Draw all buckets.
+         *
+         * @param state the RenderState with the camera transforms
+         */
+        void draw(const RenderState & state) const;
+    };
+}
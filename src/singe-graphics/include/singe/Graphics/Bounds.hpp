@@ -0,0 +1,134 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace singe {
+    using glm::mat4;
+    using glm::vec3;
+
+    /**
+     * Axis aligned bounding box.
+     *
+     * A default constructed AABB is empty, with min greater than max, and
+     * will take the value of the first point or box it is expanded with.
+     */
+    struct AABB {
+        vec3 min;
+        vec3 max;
+
+        /**
+         * Create an empty AABB.
+         */
+        AABB();
+
+        /**
+         * Create an AABB from the min and max corners.
+         *
+         * @param min the minimum corner
+         * @param max the maximum corner
+         */
+        AABB(const vec3 & min, const vec3 & max);
+
+        /**
+         * Is this AABB empty, ie. it has not been expanded.
+         *
+         * @return true if min is greater than max
+         */
+        bool empty() const;
+
+        /**
+         * Get the center point.
+         *
+         * @return the center of the box
+         */
+        vec3 center() const;
+
+        /**
+         * Get the half size of the box on each axis.
+         *
+         * @return the half extents
+         */
+        vec3 extent() const;
+
+        /**
+         * Grow this box to contain point.
+         *
+         * @param point the point to contain
+         */
+        void expand(const vec3 & point);
+
+        /**
+         * Grow this box to contain other.
+         *
+         * @param other the box to contain
+         */
+        void expand(const AABB & other);
+
+        /**
+         * Does this box overlap other.
+         *
+         * @param other the box to test
+         *
+         * @return true if the boxes overlap
+         */
+        bool overlaps(const AABB & other) const;
+
+        /**
+         * Does this box fully contain other.
+         *
+         * @param other the box to test
+         *
+         * @return true if other is inside this box
+         */
+        bool contains(const AABB & other) const;
+
+        /**
+         * Get the box containing this box after being transformed by matrix.
+         *
+         * @param matrix the transform to apply
+         *
+         * @return the transformed box
+         */
+        AABB transformed(const mat4 & matrix) const;
+    };
+
+    /**
+     * Bounding sphere with a center and radius.
+     */
+    struct BoundingSphere {
+        vec3  center;
+        float radius;
+
+        /**
+         * Create a sphere at the origin with radius 0.
+         */
+        BoundingSphere();
+
+        /**
+         * Create a sphere from a center and radius.
+         *
+         * @param center the center of the sphere
+         * @param radius the radius of the sphere
+         */
+        BoundingSphere(const vec3 & center, float radius);
+
+        /**
+         * Create the sphere around box, centered on the box center.
+         *
+         * @param box the box to contain
+         *
+         * @return the sphere containing box
+         */
+        static BoundingSphere fromAABB(const AABB & box);
+
+        /**
+         * Get the sphere containing this sphere after being transformed by
+         * matrix. The radius is scaled by the largest axis scale.
+         *
+         * @param matrix the transform to apply
+         *
+         * @return the transformed sphere
+         */
+        BoundingSphere transformed(const mat4 & matrix) const;
+    };
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+#include "Model.hpp"
+#include "RenderQueue.hpp"
+#include "RenderState.hpp"
+#include "Scene.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::vec3;
+
+    /**
+     * Dynamic bounding volume hierarchy of Models in world space.
+     *
+     * Each Model is a leaf (proxy) with a fat AABB that is slightly larger
+     * than the model's world bounds. Moving a model only changes the tree
+     * when it leaves its fat AABB, so small movements are free. The tree is
+     * kept balanced with rotations during insertion and removal.
+     *
+     * Build the tree from a Scene with Bvh::build() and call Bvh::refit()
+     * after transforms change. Frustum, sphere, box and ray queries return
+     * proxy ids which map back to the Model with Bvh::getModel().
+     *
+     * Grids are not part of the tree and are not drawn by Bvh::enqueue().
+     */
+    class Bvh {
+    public:
+        using Ptr = shared_ptr<Bvh>;
+        using ConstPtr = const shared_ptr<Bvh>;
+
+        /// Id of no node
+        static constexpr int32_t Null = -1;
+
+    private:
+        struct Node {
+            /// Fat box for leaves, union of children otherwise
+            AABB    box;
+            /// Parent node, or next free node when in the free list
+            int32_t parent;
+            int32_t child1;
+            int32_t child2;
+            /// 0 for leaves, -1 for free nodes
+            int32_t height;
+
+            bool isLeaf() const;
+        };
+
+        struct Leaf {
+            const Model * model;
+            AABB          bounds;
+            mat4          world;
+            mat4          local;
+            /// World version from Model::getWorldVersion() when refit
+            uint64_t version;
+        };
+
+        vector<Node>    nodes;
+        vector<Leaf>    leaves;
+        vector<int32_t> sceneProxies;
+        int32_t         root;
+        int32_t         freeList;
+        size_t          proxyCount;
+        float           margin;
+
+        int32_t allocateNode();
+
+        void freeNode(int32_t node);
+
+        void insertLeaf(int32_t leaf);
+
+        void removeLeaf(int32_t leaf);
+
+        int32_t balance(int32_t node);
+
+        AABB fatten(const AABB & box) const;
+
+        void buildScene(const Scene & scene,
+                        const mat4 &  parent,
+                        uint64_t      parentVersion);
+
+        bool refitScene(const Scene & scene,
+                        const mat4 &  parent,
+                        uint64_t      parentVersion,
+                        size_t &      index,
+                        size_t &      moved);
+
+    public:
+        /**
+         * Create an empty Bvh.
+         *
+         * @param margin fraction of a box's size added to each side of the
+         *               fat AABB
+         */
+        Bvh(float margin = 0.1f);
+
+        Bvh(Bvh && other);
+
+        Bvh & operator=(Bvh && other);
+
+        Bvh(const Bvh &) = delete;
+        Bvh & operator=(const Bvh &) = delete;
+
+        ~Bvh();
+
+        /**
+         * Remove all proxies.
+         */
+        void clear();
+
+        /**
+         * Get the number of proxies.
+         *
+         * @return the number of models in the tree
+         */
+        size_t size() const;
+
+        /**
+         * Get the height of the tree, 0 for a single leaf.
+         *
+         * @return the height of the root node or -1 if empty
+         */
+        int32_t getHeight() const;
+
+        /**
+         * Add a model to the tree.
+         *
+         * @param model the Model, Model::getBounds() is used for its size
+         * @param world the model's global transform
+         * @param local the model's own transform
+         *
+         * @return the proxy id
+         */
+        int32_t insert(const Model & model, const mat4 & world, const mat4 & local);
+
+        /**
+         * Update the transform of a proxy.
+         *
+         * @param proxy the proxy id from Bvh::insert()
+         * @param world the model's new global transform
+         * @param local the model's new own transform
+         *
+         * @return true if the proxy left its fat AABB and was re-inserted
+         */
+        bool update(int32_t proxy, const mat4 & world, const mat4 & local);
+
+        /**
+         * Remove a proxy from the tree.
+         *
+         * @param proxy the proxy id from Bvh::insert()
+         */
+        void remove(int32_t proxy);
+
+        /**
+         * Clear the tree and add every model in scene and its children.
+         *
+         * @param scene the root Scene
+         * @param parent the transform of the scene's parent
+         */
+        void build(const Scene & scene, const mat4 & parent = mat4(1));
+
+        /**
+         * Update proxies from the current transforms in scene. Only proxies
+         * that leave their fat AABB are re-inserted. If models or children
+         * were added or removed since Bvh::build() the tree is rebuilt.
+         *
+         * Models whose cached world matrix did not change are skipped, call
+         * Bvh::update() for a Model whose points changed.
+         *
+         * @param scene the root Scene passed to Bvh::build()
+         * @param parent the transform of the scene's parent
+         *
+         * @return the number of proxies re-inserted
+         */
+        size_t refit(const Scene & scene, const mat4 & parent = mat4(1));
+
+        /**
+         * Get the Model of a proxy.
+         *
+         * @param proxy the proxy id
+         *
+         * @return the Model
+         */
+        const Model * getModel(int32_t proxy) const;
+
+        /**
+         * Get the world space bounds of a proxy.
+         *
+         * @param proxy the proxy id
+         *
+         * @return the tight bounds, not the fat AABB
+         */
+        const AABB & getBounds(int32_t proxy) const;
+
+        /**
+         * Get the global transform of a proxy.
+         *
+         * @param proxy the proxy id
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorld(int32_t proxy) const;
+
+        /**
+         * Find proxies that overlap box.
+         *
+         * @param box the world space box
+         * @param out proxy ids are appended to out
+         */
+        void query(const AABB & box, vector<int32_t> & out) const;
+
+        /**
+         * Find proxies that overlap sphere.
+         *
+         * @param sphere the world space sphere
+         * @param out proxy ids are appended to out
+         */
+        void query(const BoundingSphere & sphere, vector<int32_t> & out) const;
+
+        /**
+         * Find proxies inside or intersecting frustum. Subtrees fully inside
+         * the frustum are added without testing each leaf.
+         *
+         * @param frustum the view frustum
+         * @param out proxy ids are appended to out
+         */
+        void query(const Frustum & frustum, vector<int32_t> & out) const;
+
+        /**
+         * Find the nearest proxy whose bounds are hit by a ray.
+         *
+         * @param origin the start of the ray
+         * @param direction the direction of the ray, does not need to be
+         *                  normalized
+         * @param maxDistance the furthest hit in units of direction
+         * @param distance if not null, set to the distance of the hit
+         *
+         * @return the proxy id or Bvh::Null if nothing is hit
+         */
+        int32_t raycast(const vec3 & origin,
+                        const vec3 & direction,
+                        float        maxDistance,
+                        float *      distance = nullptr) const;
+
+        /**
+         * Add models inside the view frustum to queue.
+         *
+         * @param queue the RenderQueue to add models to
+         * @param state the RenderState with the camera transforms
+         */
+        void enqueue(RenderQueue & queue, const RenderState & state) const;
+    };
+}
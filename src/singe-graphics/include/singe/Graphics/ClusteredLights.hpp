@@ -0,0 +1,235 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <singe/Support/ThreadPool.hpp>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Light.hpp"
+#include "RenderQueue.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::uvec2;
+    using glm::uvec4;
+    using glm::vec3;
+    using glm::vec4;
+
+    struct Scene;
+
+    /**
+     * Point lights binned into view space clusters for forward shading.
+     *
+     * The view frustum is split into a grid of screen tiles and depth
+     * slices, spaced exponentially so near slices stay thin. Every frame
+     * the point lights are tested against the bounds of each cluster on
+     * the ThreadPool, one depth slice per job, and the per-cluster light
+     * lists are uploaded to texture buffers. Material shaders look up the
+     * cluster of each fragment and loop over only the lights in it, so many
+     * lights cost about as much as the few that reach a pixel. Unlike the
+     * DeferredRenderer this keeps the forward path, so blending and MSAA
+     * work as usual.
+     *
+     * Shaders opt in by declaring the block and samplers below, they are
+     * registered with ShaderBindings so every Shader binds them to
+     * ClusteredLights::ClusterBinding and the texture units when it is
+     * created. See shader/clustered.frag.
+     *
+     * ```glsl
+     * layout (std140) uniform Clusters {
+     *     uvec4 clusterCounts; // tiles x, tiles y, slices, directional
+     *     vec4 clusterScale;   // tile size in pixels, near, slice scale
+     *     vec4 ambientLight;
+     *     vec4 directionalDirections[4];
+     *     vec4 directionalColors[4];
+     * };
+     *
+     * uniform samplerBuffer clusterLights;   // position radius, colour
+     * uniform usamplerBuffer clusterGrid;    // offset and count
+     * uniform usamplerBuffer clusterIndices; // light index
+     * ```
+     *
+     * The slice of a fragment at view depth d is
+     * `log(d / near) * clusterScale.w`. Only perspective projections are
+     * supported.
+     */
+    class ClusteredLights {
+    public:
+        using Ptr = shared_ptr<ClusteredLights>;
+        using ConstPtr = const shared_ptr<ClusteredLights>;
+
+        /// Binding point of the Clusters block
+        static constexpr GLuint ClusterBinding = 2;
+        /// Name of the cluster block in shaders
+        static constexpr const char * ClusterBlock = "Clusters";
+
+        /// Texture unit of the light buffer, above the Material textures
+        static constexpr GLuint LightsUnit = 8;
+        /// Texture unit of the cluster offset and count buffer
+        static constexpr GLuint GridUnit = 9;
+        /// Texture unit of the light index buffer
+        static constexpr GLuint IndexUnit = 10;
+
+        /// Sampler names bound to the units above by Shader
+        static constexpr const char * LightsSampler = "clusterLights";
+        static constexpr const char * GridSampler = "clusterGrid";
+        static constexpr const char * IndexSampler = "clusterIndices";
+
+        /// Directional lights in the block, extra lights are skipped
+        static constexpr size_t MaxDirectional = 4;
+
+        /// Layout of the Clusters block
+        struct ClusterData {
+            uvec4 counts;
+            vec4  scale;
+            vec4  ambient;
+            vec4  directions[MaxDirectional];
+            vec4  colors[MaxDirectional];
+        };
+
+        /**
+         * Counts from the last ClusteredLights::update().
+         */
+        struct Stats {
+            /// Point lights binned
+            size_t lights;
+            /// Entries in all cluster lists
+            size_t indices;
+            /// Clusters with at least one light
+            size_t activeClusters;
+            /// Longest cluster list
+            size_t maxPerCluster;
+
+            Stats();
+        };
+
+    private:
+        /// Point light in view space with the slices it reaches
+        struct ViewLight {
+            vec3     center;
+            float    radius;
+            uint32_t firstSlice;
+            uint32_t lastSlice;
+        };
+
+        GLuint tilesX;
+        GLuint tilesY;
+        GLuint slices;
+        mat4   projection;
+        GLint  viewportWidth;
+        GLint  viewportHeight;
+        float  zNear;
+        float  zFar;
+        float  sliceScale;
+
+        vector<AABB>             bounds;
+        vector<uvec2>            grid;
+        vector<vector<uint32_t>> sliceIndices;
+        vector<uint32_t>         indices;
+        vector<ViewLight>        viewLights;
+        vector<vec4>             lightData;
+        vector<Light>            sceneLights;
+        ClusterData              block;
+        Stats                    stats;
+
+        GLuint blockBuffer;
+        GLuint lightBuffer;
+        GLuint lightTexture;
+        GLuint gridBuffer;
+        GLuint gridTexture;
+        GLuint indexBuffer;
+        GLuint indexTexture;
+
+        void setup();
+
+        void release();
+
+        /**
+         * Rebuild the view space bounds of every cluster if the projection
+         * or viewport changed.
+         */
+        void updateBounds(const mat4 & projection, GLint width, GLint height);
+
+        /**
+         * Get the depth slice of a view depth, clamped to the slices.
+         */
+        uint32_t sliceOf(float depth) const;
+
+        /**
+         * Fill the grid entries and sliceIndices of one depth slice.
+         */
+        void binSlice(uint32_t slice);
+
+        void upload();
+
+    public:
+        /// Light added to every pixel
+        vec3 ambient;
+
+        /**
+         * Create a ClusteredLights.
+         *
+         * @param tilesX the number of clusters across the screen
+         * @param tilesY the number of clusters down the screen
+         * @param slices the number of depth slices
+         */
+        ClusteredLights(GLuint tilesX = 16,
+                        GLuint tilesY = 9,
+                        GLuint slices = 24);
+
+        /// @brief  Move constructor
+        /// @param other Other ClusteredLights to move fields from
+        ClusteredLights(ClusteredLights && other);
+
+        /// @brief Move operator
+        /// @param other Other ClusteredLights to move fields from
+        /// @return This ClusteredLights
+        ClusteredLights & operator=(ClusteredLights && other);
+
+        ClusteredLights(const ClusteredLights &) = delete;
+        ClusteredLights & operator=(const ClusteredLights &) = delete;
+
+        ~ClusteredLights();
+
+        /**
+         * Bin lights into clusters for the camera of state and upload the
+         * lists. The current viewport sets the tile size.
+         *
+         * @param state the RenderState with the camera transforms
+         * @param lights the lights in world space
+         * @param pool the pool the slices are binned on
+         */
+        void update(const RenderState &   state,
+                    const vector<Light> & lights,
+                    ThreadPool &          pool = ThreadPool::shared());
+
+        /**
+         * Bind the Clusters block and the light texture buffers.
+         */
+        void bind() const;
+
+        /**
+         * Bin the lights of a scene and its children, then draw the scene
+         * with the clusters bound.
+         *
+         * @param scene the scene to draw
+         * @param state the RenderState with the current global transform
+         * @param queue the RenderQueue used to sort models
+         */
+        void draw(const Scene & scene, RenderState state, RenderQueue & queue);
+
+        /**
+         * Get the counts from the last ClusteredLights::update().
+         *
+         * @return the stats
+         */
+        const Stats & getStats() const;
+    };
+}
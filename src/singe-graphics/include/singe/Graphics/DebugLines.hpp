@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::vec3;
+    using glm::vec4;
+
+    /**
+     * Coloured line segments collected over a frame and drawn with one call.
+     *
+     * Segments are written to the StreamBuffer when drawn, so lines that
+     * move every frame do not reallocate or re-upload a buffer of their own.
+     * The segments are cleared after DebugLines::draw().
+     */
+    class DebugLines {
+    public:
+        using Ptr = shared_ptr<DebugLines>;
+        using ConstPtr = const shared_ptr<DebugLines>;
+
+    private:
+        /// Vertex written to the StreamBuffer
+        struct Point {
+            vec3 pos;
+            vec4 color;
+        };
+
+        vector<Point> points;
+        GLuint        program;
+        GLint         mvpLocation;
+        GLuint        vertexArray;
+
+        void setup();
+
+        void release();
+
+    public:
+        DebugLines();
+
+        /// @brief  Move constructor
+        /// @param other Other DebugLines to move fields from
+        DebugLines(DebugLines && other);
+
+        /// @brief Move operator
+        /// @param other Other DebugLines to move fields from
+        /// @return This DebugLines
+        DebugLines & operator=(DebugLines && other);
+
+        DebugLines(const DebugLines &) = delete;
+        DebugLines & operator=(const DebugLines &) = delete;
+
+        ~DebugLines();
+
+        /**
+         * Add a line segment.
+         *
+         * @param from the start point
+         * @param to the end point
+         * @param color the line colour
+         */
+        void add(const vec3 & from, const vec3 & to, const vec4 & color);
+
+        /**
+         * Add segments joining each point to the next.
+         *
+         * @param strip the points of the line
+         * @param color the line colour
+         * @param closed join the last point back to the first
+         */
+        void addStrip(const vector<vec3> & strip,
+                      const vec4 &         color,
+                      bool                 closed = false);
+
+        /**
+         * Get the number of segments waiting to be drawn.
+         *
+         * @return the segment count
+         */
+        size_t size() const;
+
+        /**
+         * Remove all segments without drawing them.
+         */
+        void clear();
+
+        /**
+         * Draw and clear all segments.
+         *
+         * @param mvp the transform from line space to clip space
+         */
+        void draw(const mat4 & mvp);
+    };
+}
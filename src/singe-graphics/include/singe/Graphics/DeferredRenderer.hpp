@@ -0,0 +1,182 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Light.hpp"
+#include "RenderQueue.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::vec3;
+    using glm::vec4;
+
+    struct Scene;
+
+    /**
+     * Deferred shading for scenes with many dynamic lights.
+     *
+     * The geometry pass draws the scene with its usual materials into a
+     * G-buffer of albedo, world space normal and depth. Material fragment
+     * shaders write albedo to output 0 and the normal to output 1 with w set
+     * to 1, see shader/default.frag. Output 1 is dropped when drawing to the
+     * default framebuffer so the same shaders work for forward rendering.
+     *
+     * The light pass then shades each pixel once per light that reaches it.
+     * Directional lights and the ambient term are one fullscreen pass. Point
+     * lights are drawn as instanced spheres scaled to their radius, so the
+     * cost of a light is the pixels it covers rather than the whole screen.
+     * Positions are rebuilt from depth.
+     *
+     * The result is written to the framebuffer that was bound before
+     * DeferredRenderer::beginGeometry() together with the G-buffer depth, so
+     * blended or unlit geometry can be drawn forward on top afterwards.
+     *
+     * The G-buffer is sized to the viewport and created with GlUtil. Its
+     * depth is written by the composite shader rather than blitted, so the
+     * target may be multisampled.
+     */
+    class DeferredRenderer {
+    public:
+        using Ptr = shared_ptr<DeferredRenderer>;
+        using ConstPtr = const shared_ptr<DeferredRenderer>;
+
+        /// Directional lights shaded per frame, extra lights are skipped
+        static constexpr size_t MaxDirectional = 4;
+
+        /**
+         * Counts from the last DeferredRenderer::shade().
+         */
+        struct Stats {
+            /// Point light volumes drawn
+            size_t pointLights;
+            /// Directional lights shaded
+            size_t directionalLights;
+
+            Stats();
+        };
+
+    private:
+        /// Per instance attributes of a point light volume
+        struct PointInstance {
+            /// xyz position and w radius
+            vec4 positionRadius;
+            /// rgb colour times intensity
+            vec4 color;
+        };
+
+        GLint   viewport[4];
+        GLint   target;
+        GLsizei width;
+        GLsizei height;
+
+        GLuint geometryBuffer;
+        GLuint albedoTexture;
+        GLuint normalTexture;
+        GLuint depthTexture;
+        GLuint lightBuffer;
+        GLuint lightTexture;
+
+        GLuint directionalProgram;
+        GLint  ambientLocation;
+        GLint  lightCountLocation;
+        GLint  lightDirectionsLocation;
+        GLint  lightColorsLocation;
+        GLuint pointProgram;
+        GLint  viewProjLocation;
+        GLint  inverseViewProjLocation;
+        GLint  cameraPosLocation;
+        GLint  screenSizeLocation;
+        GLuint compositeProgram;
+
+        GLuint  emptyArray;
+        GLuint  volumeArray;
+        GLuint  volumeBuffer;
+        GLuint  volumeIndices;
+        GLsizei volumeIndexCount;
+
+        vector<Light>         sceneLights;
+        vector<PointInstance> instances;
+        Stats                 stats;
+
+        void setup();
+
+        void release();
+
+        void releaseTargets();
+
+        /**
+         * Create the G-buffer and light buffer textures.
+         */
+        void resize(GLsizei width, GLsizei height);
+
+        void shadeDirectional(const vector<Light> & lights);
+
+        void shadePoints(const RenderState &   state,
+                         const vector<Light> & lights);
+
+        void composite();
+
+    public:
+        /// Light added to every lit pixel
+        vec3 ambient;
+
+        DeferredRenderer();
+
+        /// @brief  Move constructor
+        /// @param other Other DeferredRenderer to move fields from
+        DeferredRenderer(DeferredRenderer && other);
+
+        /// @brief Move operator
+        /// @param other Other DeferredRenderer to move fields from
+        /// @return This DeferredRenderer
+        DeferredRenderer & operator=(DeferredRenderer && other);
+
+        DeferredRenderer(const DeferredRenderer &) = delete;
+        DeferredRenderer & operator=(const DeferredRenderer &) = delete;
+
+        ~DeferredRenderer();
+
+        /**
+         * Bind and clear the G-buffer. Everything drawn until
+         * DeferredRenderer::shade() goes into the G-buffer. The G-buffer is
+         * resized if the viewport changed.
+         */
+        void beginGeometry();
+
+        /**
+         * Shade the G-buffer and write the result and depth to the
+         * framebuffer bound before DeferredRenderer::beginGeometry().
+         *
+         * Leaves depth testing with GL_LEQUAL, depth writes and back face
+         * culling enabled and blending disabled.
+         *
+         * @param state the RenderState the geometry was drawn with
+         * @param lights the lights in world space
+         */
+        void shade(const RenderState & state, const vector<Light> & lights);
+
+        /**
+         * Draw a scene through the G-buffer and shade it with the lights of
+         * the scene and its children. Grids are skipped as they do not
+         * write a normal, draw them after this returns.
+         *
+         * @param scene the scene to draw
+         * @param state the RenderState with the current global transform
+         * @param queue the RenderQueue used to sort models
+         */
+        void draw(const Scene & scene, RenderState state, RenderQueue & queue);
+
+        /**
+         * Get the counts from the last DeferredRenderer::shade().
+         *
+         * @return the stats
+         */
+        const Stats & getStats() const;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+#include <memory>
+
+namespace singe {
+    using std::shared_ptr;
+    using glm::mat4;
+
+    class Model;
+
+    /**
+     * Position only programs for drawing Model depth without a material.
+     *
+     * Used for shadow casters and the RenderQueue depth pre-pass. There is
+     * a program for plain meshes and one for InstancedModel, both decode
+     * Model::Packed positions. gl_Position is declared invariant and is
+     * computed the same way as shader/default.vert and
+     * shader/instanced.vert, so a later pass with those shaders can test
+     * against the depth with GL_EQUAL.
+     *
+     * The programs are created on first use, a DepthProgram can be created
+     * before there is a GL context.
+     */
+    class DepthProgram {
+    public:
+        using Ptr = shared_ptr<DepthProgram>;
+        using ConstPtr = const shared_ptr<DepthProgram>;
+
+    private:
+        /// A program and its uniforms
+        struct Program {
+            GLuint program;
+            GLint  mvp;
+            GLint  posOffset;
+            GLint  posScale;
+        };
+
+        Program meshProgram;
+        Program instancedProgram;
+
+        void setup();
+
+        void release();
+
+    public:
+        DepthProgram();
+
+        /// @brief  Move constructor
+        /// @param other Other DepthProgram to move fields from
+        DepthProgram(DepthProgram && other);
+
+        /// @brief Move operator
+        /// @param other Other DepthProgram to move fields from
+        /// @return This DepthProgram
+        DepthProgram & operator=(DepthProgram && other);
+
+        DepthProgram(const DepthProgram &) = delete;
+        DepthProgram & operator=(const DepthProgram &) = delete;
+
+        ~DepthProgram();
+
+        /**
+         * Draw a mesh with no material binds. Lod selection is left to the
+         * caller, pass the Model returned by Model::selectLod().
+         *
+         * @param mesh the mesh to draw
+         * @param mvp the model view projection matrix
+         */
+        void draw(const Model & mesh, const mat4 & mvp);
+    };
+}
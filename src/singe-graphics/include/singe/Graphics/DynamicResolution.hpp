@@ -0,0 +1,165 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * Render the scene below native resolution when the GPU falls behind.
+     *
+     * Between DynamicResolution::begin() and DynamicResolution::end() the
+     * scene is drawn into an off-screen target at a fraction of the window
+     * size, then upscaled to the framebuffer that was bound before. Overlays
+     * drawn afterwards stay at native resolution.
+     *
+     * The time the GPU spends between begin and end is measured with timer
+     * queries, read a few frames later so the CPU never waits on them. When
+     * the smoothed time is above the target the scale drops, when it is
+     * well below the scale rises again, within the configured bounds. GPU
+     * time is taken to follow the pixel count, the square of the scale.
+     *
+     * The scale moves in steps of DynamicResolution::ScaleStep so passes
+     * that size their targets to the viewport, like DeferredRenderer, are
+     * not rebuilt every frame.
+     *
+     * The target is created with GlUtil at the largest scale, smaller scales
+     * use a corner of it. It is upscaled by drawing a linearly filtered
+     * fullscreen triangle, since the window framebuffer may be multisampled
+     * and can not be blitted into.
+     */
+    class DynamicResolution {
+    public:
+        using Ptr = shared_ptr<DynamicResolution>;
+        using ConstPtr = const shared_ptr<DynamicResolution>;
+
+        /// Smallest change of the scale
+        static constexpr float ScaleStep = 0.05f;
+        /// Timer queries in flight, the GPU may run this many frames behind
+        static constexpr size_t QueryCount = 4;
+
+    private:
+        float  targetTime;
+        float  minScale;
+        float  maxScale;
+        float  scale;
+        double gpuTime;
+
+        GLsizei width;
+        GLsizei height;
+        GLsizei scaledWidth;
+        GLsizei scaledHeight;
+        GLint   viewport[4];
+        GLint   target;
+
+        GLuint  frameBuffer;
+        GLuint  colorTexture;
+        GLuint  depthBuffer;
+        GLsizei textureWidth;
+        GLsizei textureHeight;
+
+        GLuint upscaleProgram;
+        GLint  regionLocation;
+        GLuint emptyArray;
+
+        GLuint queries[QueryCount];
+        bool   pending[QueryCount];
+        size_t nextQuery;
+        bool   timing;
+        size_t settleFrames;
+
+        void setup();
+
+        void release();
+
+        void releaseTarget();
+
+        /**
+         * Create the target for a window size at the largest scale.
+         */
+        void resize(GLsizei width, GLsizei height);
+
+        /**
+         * Read every finished query, oldest first, and update the scale.
+         */
+        void readQueries();
+
+        /**
+         * Move the scale towards the target time for a measured frame.
+         */
+        void updateScale(double frameTime);
+
+    public:
+        /**
+         * Create a DynamicResolution.
+         *
+         * @param targetTime the GPU time per frame to hold in milliseconds
+         * @param minScale the lowest fraction of the window size
+         * @param maxScale the highest fraction of the window size
+         */
+        DynamicResolution(float targetTime = 14.0f,
+                          float minScale = 0.5f,
+                          float maxScale = 1.0f);
+
+        /// @brief  Move constructor
+        /// @param other Other DynamicResolution to move fields from
+        DynamicResolution(DynamicResolution && other);
+
+        /// @brief Move operator
+        /// @param other Other DynamicResolution to move fields from
+        /// @return This DynamicResolution
+        DynamicResolution & operator=(DynamicResolution && other);
+
+        DynamicResolution(const DynamicResolution &) = delete;
+        DynamicResolution & operator=(const DynamicResolution &) = delete;
+
+        ~DynamicResolution();
+
+        /**
+         * Set the GPU time per frame to hold.
+         *
+         * @param milliseconds the target time
+         */
+        void setTargetTime(float milliseconds);
+
+        /**
+         * Set the bounds of the scale. The current scale is clamped to them.
+         *
+         * @param minScale the lowest fraction of the window size
+         * @param maxScale the highest fraction of the window size
+         */
+        void setScaleBounds(float minScale, float maxScale);
+
+        /**
+         * Get the current fraction of the window size rendered.
+         *
+         * @return the scale
+         */
+        float getScale() const;
+
+        /**
+         * Get the smoothed GPU time of the frames measured so far.
+         *
+         * @return the time in milliseconds, 0 before the first result
+         */
+        double getGpuTime() const;
+
+        /**
+         * Bind and clear the scaled target, set the viewport to the scaled
+         * size and start timing. The target is resized if the window size
+         * changed.
+         *
+         * @param width the window width in pixels
+         * @param height the window height in pixels
+         */
+        void begin(GLsizei width, GLsizei height);
+
+        /**
+         * Stop timing and upscale the target to the framebuffer and
+         * viewport that were bound before DynamicResolution::begin().
+         */
+        void end();
+    };
+}
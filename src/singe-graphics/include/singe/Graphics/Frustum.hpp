@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Bounds.hpp"
+
+namespace singe {
+    using glm::mat4;
+    using glm::vec4;
+
+    /**
+     * View frustum as 6 planes extracted from a view projection matrix.
+     *
+     * Plane normals point into the frustum, a point p is inside a plane if
+     * dot(plane.xyz, p) + plane.w >= 0.
+     */
+    class Frustum {
+    public:
+        enum Plane {
+            Left,
+            Right,
+            Bottom,
+            Top,
+            Near,
+            Far,
+        };
+
+        /**
+         * Result of classifying a box against the frustum.
+         */
+        enum Containment {
+            Outside,
+            Intersects,
+            Inside,
+        };
+
+    private:
+        vec4 planes[6];
+
+    public:
+        /**
+         * Create a Frustum that contains everything.
+         */
+        Frustum();
+
+        /**
+         * Create a Frustum from a view projection matrix.
+         *
+         * @param viewProjection the projection * view matrix
+         */
+        Frustum(const mat4 & viewProjection);
+
+        /**
+         * Get one of the frustum planes.
+         *
+         * @param plane the plane to get
+         *
+         * @return the normalized plane equation
+         */
+        const vec4 & getPlane(Plane plane) const;
+
+        /**
+         * Is any part of box inside the frustum.
+         *
+         * This is conservative, some boxes outside near a corner of the
+         * frustum will be reported as visible.
+         *
+         * @param box the box to test
+         *
+         * @return false if the box is fully outside any plane
+         */
+        bool intersects(const AABB & box) const;
+
+        /**
+         * Classify box as fully outside, partially inside or fully inside the
+         * frustum.
+         *
+         * Hierarchies can skip testing the children of a box that is Inside.
+         *
+         * @param box the box to test
+         *
+         * @return the containment of box
+         */
+        Containment classify(const AABB & box) const;
+
+        /**
+         * Is any part of sphere inside the frustum.
+         *
+         * @param sphere the sphere to test
+         *
+         * @return false if the sphere is fully outside any plane
+         */
+        bool intersects(const BoundingSphere & sphere) const;
+
+        /**
+         * Test many boxes against the frustum. Four boxes are tested at once
+         * with SSE when available.
+         *
+         * @param boxes the boxes to test
+         * @param count the number of boxes
+         * @param visible output array of count values, 1 if the box
+         *                intersects the frustum, otherwise 0
+         *
+         * @return the number of visible boxes
+         */
+        size_t intersects(const AABB * boxes, size_t count, uint8_t * visible) const;
+    };
+}
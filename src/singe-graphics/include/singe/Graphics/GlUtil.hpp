@@ -0,0 +1,111 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/**
+ * Helpers for the raw GL programs and render targets of internal passes.
+ *
+ * glpp::FrameBuffer does not expose its attachments, so passes that sample
+ * their own targets, like DeferredRenderer, TransparencyRenderer and
+ * DynamicResolution, create framebuffer objects and programs directly with
+ * these helpers. Errors are logged to Logging::Graphics with the name of
+ * the pass.
+ */
+namespace singe::GlUtil {
+    /**
+     * Vertex shader for one triangle covering the viewport, drawn with
+     * glDrawArrays(GL_TRIANGLES, 0, 3) and an empty vertex array. Passes
+     * `vec2 uv` from 0 to 1 across the viewport.
+     */
+    extern const char * const FullscreenVertexSource;
+
+    /**
+     * Compile one shader stage.
+     *
+     * @param type the stage, like GL_VERTEX_SHADER
+     * @param source the GLSL source
+     * @param name the pass name for the error log
+     *
+     * @return the shader, which is kept even if it failed to compile
+     */
+    GLuint compileStage(GLenum type, const char * source, const char * name);
+
+    /**
+     * Compile and link a vertex and fragment shader.
+     *
+     * @param vertexSource the vertex shader source
+     * @param fragmentSource the fragment shader source
+     * @param name the pass name for the error log
+     *
+     * @return the program, which is kept even if it failed to link
+     */
+    GLuint linkProgram(const char * vertexSource,
+                       const char * fragmentSource,
+                       const char * name);
+
+    /**
+     * Create a 2D texture to render into, clamped at the edges.
+     *
+     * @param format the internal format
+     * @param layout the pixel format of the (empty) upload
+     * @param type the pixel type of the (empty) upload
+     * @param width the width in pixels
+     * @param height the height in pixels
+     * @param filter the min and mag filter
+     *
+     * @return the texture, bound to unit 0 through StateCache
+     */
+    GLuint createTarget(GLint   format,
+                        GLenum  layout,
+                        GLenum  type,
+                        GLsizei width,
+                        GLsizei height,
+                        GLint   filter = GL_NEAREST);
+
+    /**
+     * Create a multisampled 2D texture to render into. Needs OpenGL 3.2 or
+     * ARB_texture_multisample.
+     *
+     * @param format the internal format
+     * @param samples the sample count, more than 0
+     * @param width the width in pixels
+     * @param height the height in pixels
+     *
+     * @return the texture, bound to unit 0 through StateCache
+     */
+    GLuint createMultisampleTarget(GLint   format,
+                                   GLsizei samples,
+                                   GLsizei width,
+                                   GLsizei height);
+
+    /**
+     * Log an error if the bound framebuffer is incomplete.
+     *
+     * @param name the pass name for the error log
+     *
+     * @return true if the framebuffer is complete
+     */
+    bool checkFramebuffer(const char * name);
+
+    /**
+     * Get the sample count of a framebuffer, 0 if it is not multisampled.
+     * Depth can only be blitted between framebuffers with the same sample
+     * count and depth stencil format.
+     *
+     * @param framebuffer the framebuffer, 0 for the default framebuffer
+     *
+     * @return the sample count
+     */
+    GLint getSamples(GLuint framebuffer);
+
+    /**
+     * Get the sized internal format matching the depth and stencil buffer
+     * of a framebuffer, for a target that depth is blitted into.
+     *
+     * @param framebuffer the framebuffer, 0 for the default framebuffer
+     *
+     * @return the format, or GL_NONE if framebuffer has no depth buffer or
+     *         no sized format matches it
+     */
+    GLenum getDepthFormat(GLuint framebuffer);
+}
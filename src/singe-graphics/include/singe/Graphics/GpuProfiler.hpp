@@ -0,0 +1,189 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::string;
+    using std::vector;
+
+    /**
+     * GPU time of named scopes, measured with GL_TIMESTAMP queries.
+     *
+     * Each scope writes a timestamp when it begins and ends, so scopes can
+     * nest. Queries are kept for GpuProfiler::Frames frames and a frame is
+     * only read back when its slot comes around again, by then the GPU has
+     * normally finished it. If it has not the frame is dropped rather than
+     * waiting, so profiling never stalls the CPU.
+     *
+     * Scopes with the same name and depth in a frame are summed, eg. one
+     * Grid entry for every scene with a grid.
+     *
+     * Profiling is off until GpuProfiler::setEnabled() is called, scopes do
+     * nothing while it is off.
+     *
+     * ```cpp
+     * {
+     *     GpuProfiler::Scope scope("Shadows");
+     *     shadows.render(state, sun, &level, &actors);
+     * }
+     * ```
+     */
+    class GpuProfiler {
+    public:
+        using Ptr = shared_ptr<GpuProfiler>;
+        using ConstPtr = const shared_ptr<GpuProfiler>;
+
+        /// Frames in flight before a frame's queries are read
+        static constexpr size_t Frames = 3;
+
+        /**
+         * Time of a scope in the last frame that was read back.
+         */
+        struct Timing {
+            string name;
+            /// Number of scopes this one is nested in
+            size_t depth;
+            /// Number of scopes summed into this timing
+            size_t calls;
+            double milliseconds;
+        };
+
+        /**
+         * Times the GPU work issued during its lifetime.
+         */
+        class Scope {
+            GpuProfiler & profiler;
+
+        public:
+            /**
+             * Begin a scope.
+             *
+             * @param name the scope name
+             * @param profiler the profiler to record to
+             */
+            Scope(const string & name,
+                  GpuProfiler &  profiler = GpuProfiler::current());
+
+            Scope(const Scope &) = delete;
+            Scope & operator=(const Scope &) = delete;
+
+            /**
+             * End the scope.
+             */
+            ~Scope();
+        };
+
+    private:
+        /// A begun scope and its timestamp queries
+        struct Marker {
+            string name;
+            size_t depth;
+            GLuint begin;
+            GLuint end;
+        };
+
+        /// Queries of one frame, reused when the slot comes around
+        struct Frame {
+            vector<GLuint> queries;
+            vector<Marker> markers;
+            size_t         usedQueries;
+        };
+
+        bool           enabled;
+        Frame          frames[Frames];
+        size_t         frameIndex;
+        vector<size_t> open;
+        vector<Timing> timings;
+        size_t         droppedFrames;
+
+        void release();
+
+        GLuint nextQuery();
+
+        /**
+         * Read the timings of a frame if the GPU has finished it.
+         *
+         * @return false if the frame was not finished
+         */
+        bool read(Frame & frame);
+
+    public:
+        GpuProfiler();
+
+        /// @brief  Move constructor
+        /// @param other Other GpuProfiler to move fields from
+        GpuProfiler(GpuProfiler && other);
+
+        /// @brief Move operator
+        /// @param other Other GpuProfiler to move fields from
+        /// @return This GpuProfiler
+        GpuProfiler & operator=(GpuProfiler && other);
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler & operator=(const GpuProfiler &) = delete;
+
+        ~GpuProfiler();
+
+        /**
+         * Get the GpuProfiler for the context that is current on this
+         * thread.
+         *
+         * @return the GpuProfiler
+         */
+        static GpuProfiler & current();
+
+        /**
+         * Turn profiling on or off. Turning it off drops the frames in
+         * flight and the last timings.
+         *
+         * @param enabled true to record scopes
+         */
+        void setEnabled(bool enabled);
+
+        /**
+         * Check if scopes are recorded.
+         *
+         * @return true if profiling is on
+         */
+        bool isEnabled() const;
+
+        /**
+         * Start a new frame. The oldest frame in flight is read back if the
+         * GPU has finished it. GameBase calls this before every frame.
+         */
+        void beginFrame();
+
+        /**
+         * Begin a named scope, prefer GpuProfiler::Scope.
+         *
+         * @param name the scope name
+         */
+        void begin(const string & name);
+
+        /**
+         * End the innermost scope.
+         */
+        void end();
+
+        /**
+         * Get the scope timings of the last frame read back, in the order
+         * the scopes began.
+         *
+         * @return the timings
+         */
+        const vector<Timing> & getTimings() const;
+
+        /**
+         * Get the number of frames dropped because the GPU had not finished
+         * them when their queries were needed again.
+         *
+         * @return the dropped frame count
+         */
+        size_t getDroppedFrames() const;
+    };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glpp/extra/Transform.hpp>
+#include <memory>
+#include <vector>
+
+#include "Model.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glpp::extra::Transform;
+
+    /**
+     * Model drawn once for each instance transform with a single instanced
+     * draw call.
+     *
+     * The world matrix of each instance is stored in an instance buffer bound
+     * to attribute locations 3 to 6 as a mat4 with a divisor of 1. The shader
+     * must read this attribute and apply it before the mvp transform, see
+     * `shader/instanced.vert` in the example resources.
+     *
+     * Remember to call InstancedModel::updateInstances() after making changes
+     * to instances.
+     */
+    class InstancedModel : public Model {
+    public:
+        using Ptr = shared_ptr<InstancedModel>;
+        using ConstPtr = const shared_ptr<InstancedModel>;
+
+        /// First attribute location of the per-instance mat4
+        static constexpr GLuint InstanceAttribute = 3;
+
+    private:
+        GLuint instanceBuffer;
+        size_t instanceCount;
+
+    protected:
+        /**
+         * Calculate bounds and sphere to contain the mesh at every instance
+         * transform.
+         */
+        void updateBounds() override;
+
+    public:
+        /// Transform of each instance relative to the model transform
+        vector<Transform> instances;
+
+        /**
+         * Create an empty InstancedModel. This will do nothing until points
+         * are added, instances are added and both Model::update() and
+         * InstancedModel::updateInstances() are called.
+         */
+        InstancedModel();
+
+        /**
+         * Create an InstancedModel by moving the mesh and material from
+         * another Model.
+         *
+         * @param model the Model to move fields from
+         */
+        InstancedModel(Model && model);
+
+        InstancedModel(InstancedModel && other);
+
+        InstancedModel & operator=(InstancedModel && other);
+
+        InstancedModel(const InstancedModel &) = delete;
+        InstancedModel & operator=(const InstancedModel &) = delete;
+
+        ~InstancedModel() override;
+
+        /**
+         * Buffer the instance transforms into the instance buffer and update
+         * the bounds.
+         *
+         * This method must be called after any changes to instances.
+         *
+         * @param usage glpp::Buffer usage hint
+         */
+        void updateInstances(Buffer::Usage usage = Buffer::Static);
+
+        /**
+         * Draw all instances with glDrawElementsInstanced, or
+         * glDrawArraysInstanced if the model has no indices.
+         */
+        void drawMesh() const override;
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace singe {
+    using glm::mat4;
+    using glm::vec3;
+
+    /**
+     * A light drawn by the DeferredRenderer.
+     *
+     * Point lights fall off to nothing at their radius so they only shade
+     * pixels inside a sphere. Directional lights shade every pixel and
+     * ignore position and radius.
+     */
+    struct Light {
+        enum Type {
+            /// Light at position fading out at radius
+            Point,
+            /// Light travelling in direction from infinitely far away
+            Directional,
+        };
+
+        Type  type;
+        vec3  position;
+        /// Direction the light travels, not the direction towards it
+        vec3  direction;
+        vec3  color;
+        float intensity;
+        float radius;
+
+        /**
+         * Create a white light of intensity 1 at the origin with radius 10
+         * pointing down.
+         *
+         * @param type the type of light
+         */
+        Light(Type type = Point);
+
+        /**
+         * Create a point light.
+         *
+         * @param position the position of the light
+         * @param color the colour of the light
+         * @param intensity multiplier for color
+         * @param radius the distance at which the light reaches 0
+         *
+         * @return the light
+         */
+        static Light point(const vec3 & position,
+                           const vec3 & color,
+                           float        intensity,
+                           float        radius);
+
+        /**
+         * Create a directional light.
+         *
+         * @param direction the direction the light travels
+         * @param color the colour of the light
+         * @param intensity multiplier for color
+         *
+         * @return the light
+         */
+        static Light directional(const vec3 & direction,
+                                 const vec3 & color,
+                                 float        intensity);
+
+        /**
+         * Get this light moved into another space. The radius is scaled by
+         * the largest axis scale of matrix.
+         *
+         * @param matrix the transform, eg. a Scene world matrix
+         *
+         * @return the transformed light
+         */
+        Light transformed(const mat4 & matrix) const;
+    };
+}
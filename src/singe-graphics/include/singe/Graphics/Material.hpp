@@ -1,5 +1,7 @@
 #pragma once
 
+#include <GL/glew.h>
+
 #include <glm/glm.hpp>
 #include <glpp/Texture.hpp>
 #include <memory>
@@ -11,15 +13,38 @@ namespace singe {
     using std::shared_ptr;
     using std::string;
     using glm::vec3;
+    using glm::vec4;
     using glpp::Texture;
 
+    /**
+     * Location of a Material texture packed by TextureArrays.
+     */
+    struct TextureLayer {
+        /// GL_TEXTURE_2D_ARRAY holding the texture, 0 if not packed
+        GLuint array;
+        /// Layer of array
+        float layer;
+        /// Region of the layer, uv offset in xy and uv scale in zw
+        vec4 rect;
+
+        TextureLayer();
+    };
+
     /**
      * Material properties, textures and shader.
+     *
+     * When textures are packed by TextureArrays the arrays are bound instead
+     * of the textures, and shaders read the layer and region of each unit
+     * from the uniforms `vec3 textureLayers` and `vec4 textureRects[3]`, see
+     * `shader/array.frag`. Units that are not packed have a layer of -1.
      */
     struct Material {
         using Ptr = shared_ptr<Material>;
         using ConstPtr = const shared_ptr<Material>;
 
+        /// Number of texture units used by a Material
+        static constexpr size_t TextureUnits = 3;
+
         Shader::Ptr shader;
 
         string       name;
@@ -29,6 +54,8 @@ namespace singe {
         Texture::Ptr texture;
         Texture::Ptr normalTexture;
         Texture::Ptr specularTexture;
+        /// Packed location of texture, normalTexture and specularTexture
+        TextureLayer layers[TextureUnits];
 
         Material();
 
@@ -45,5 +72,30 @@ namespace singe {
          * Bind the shader and textures.
          */
         void bind() const;
+
+        /**
+         * Bind the textures. This also calls Material::applyLayers(), which
+         * binds the shader program to send its uniforms.
+         */
+        void bindTextures() const;
+
+        /**
+         * Send the texture layers and regions to the shader, they are only
+         * sent when a texture is packed. Material::alpha is also sent to
+         * `float materialAlpha` if the shader declares it. The shader
+         * program is bound through StateCache. RenderQueue calls this on
+         * each material change, even when the bound textures are the same.
+         */
+        void applyLayers() const;
+
+        /**
+         * Get the texture bound to a unit by Material::bindTextures(), for
+         * comparing texture sets.
+         *
+         * @param unit the texture unit, less than Material::TextureUnits
+         *
+         * @return the texture array or Texture, nullptr if nothing is bound
+         */
+        const void * boundTexture(size_t unit) const;
     };
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <glpp/extra/Vertex.hpp>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+    using glpp::extra::Vertex;
+
+    /**
+     * Convert triangle lists to indexed meshes and reorder them for the GPU.
+     *
+     * The usual order is MeshOptimizer::weld(), then
+     * MeshOptimizer::optimizeVertexCache() and finally
+     * MeshOptimizer::optimizeVertexFetch().
+     */
+    class MeshOptimizer {
+    public:
+        /// Cache size used by MeshOptimizer::acmr()
+        static constexpr size_t DefaultCacheSize = 16;
+
+        /**
+         * Remove duplicate vertices from a triangle list.
+         *
+         * Vertices are merged only when position, normal and uv are all
+         * equal, so the mesh draws exactly as before.
+         *
+         * @param points the triangle list, replaced with the unique vertices
+         *
+         * @return indices into points, 3 per triangle
+         */
+        static vector<uint32_t> weld(vector<Vertex> & points);
+
+        /**
+         * Reorder triangles so recently transformed vertices are reused,
+         * using Tom Forsyth's linear-speed vertex cache optimisation.
+         *
+         * @param indices the triangle indices to reorder
+         * @param vertexCount the number of vertices indices refer to
+         */
+        static void optimizeVertexCache(vector<uint32_t> & indices,
+                                        size_t             vertexCount);
+
+        /**
+         * Reorder vertices in the order they are first used by indices, so
+         * vertex fetches move forward through memory. Unused vertices are
+         * removed.
+         *
+         * @param points the vertices to reorder
+         * @param indices the indices to remap
+         */
+        static void optimizeVertexFetch(vector<Vertex> &   points,
+                                        vector<uint32_t> & indices);
+
+        /**
+         * Average cache miss ratio, the number of vertex shader runs per
+         * triangle for a FIFO post-transform cache. 3 is the worst case and
+         * about 0.5 is the best for a regular grid.
+         *
+         * @param indices the triangle indices
+         * @param cacheSize the number of vertices in the simulated cache
+         *
+         * @return transformed vertices per triangle
+         */
+        static float acmr(const vector<uint32_t> & indices,
+                          size_t                   cacheSize = DefaultCacheSize);
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glpp/extra/Vertex.hpp>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+    using glpp::extra::Vertex;
+
+    /**
+     * Reduce the triangle count of a mesh with quadric error metric edge
+     * collapses (Garland and Heckbert).
+     *
+     * Error quadrics are built on vertices welded by position, so the mesh
+     * is connected across normal and uv seams. Each triangle corner keeps its
+     * own normal and uv (its wedge). Positions with more than one wedge lie
+     * on a seam and never move, so hard edges and uv seams are kept in every
+     * LOD. Each collapse moves one vertex onto a neighbour and takes the
+     * neighbour's wedge, so no new attributes are interpolated. Open borders
+     * are weighted so the silhouette of holes is kept, and collapses that
+     * would flip a triangle are rejected.
+     */
+    class MeshSimplifier {
+        /// Symmetric 4x4 quadric, upper triangle
+        struct Quadric {
+            double a[10];
+
+            Quadric();
+
+            void addPlane(double x, double y, double z, double d, double weight);
+
+            void add(const Quadric & other);
+
+            double error(const glm::vec3 & p) const;
+        };
+
+        vector<glm::vec3>               positions;
+        /// Distinct corners, position, normal and uv
+        vector<Vertex>                  wedges;
+        /// Wedge of each position not on a seam
+        vector<uint32_t>                positionWedge;
+        vector<bool>                    seam;
+        /// Position indices of each triangle
+        vector<std::array<uint32_t, 3>> triangles;
+        /// Wedge indices of each triangle
+        vector<std::array<uint32_t, 3>> triangleWedges;
+        vector<Quadric>                 quadrics;
+
+    public:
+        /**
+         * Prepare a mesh for simplification.
+         *
+         * @param points the vertices, or the triangle list if indices is empty
+         * @param indices optional triangle indices into points
+         */
+        MeshSimplifier(const vector<Vertex> &   points,
+                       const vector<uint32_t> & indices = {});
+
+        /**
+         * Get the number of triangles in the source mesh after welding and
+         * removing degenerate triangles.
+         *
+         * @return the triangle count
+         */
+        size_t triangleCount() const;
+
+        /**
+         * Simplify the mesh.
+         *
+         * @param ratio the fraction of triangles to keep, from 0 to 1
+         *
+         * @return the simplified triangle list
+         */
+        vector<Vertex> simplify(float ratio) const;
+    };
+}
@@ -1,12 +1,18 @@
 #pragma once
 
+#include <GL/glew.h>
+
+#include <cstdint>
 #include <glpp/Buffer.hpp>
 #include <glpp/extra/Vertex.hpp>
 #include <memory>
 #include <vector>
 
+#include "Bounds.hpp"
 #include "Material.hpp"
 #include "RenderState.hpp"
+#include "StreamBuffer.hpp"
+#include "TransformCache.hpp"
 
 namespace singe {
     using std::shared_ptr;
@@ -21,19 +27,93 @@ namespace singe {
      *
      * Remember to call Model::update() after making changes to points. This
      * will buffer the mesh points into the vertex buffer.
+     *
+     * If indices is not empty the mesh is drawn with glDrawElements, otherwise
+     * points is a triangle list drawn with glDrawArrays.
+     *
+     * points are always kept as full Vertex values on the CPU, format only
+     * changes the layout uploaded to the vertex buffer.
+     *
+     * Float models updated with Buffer::Dynamic are written to the
+     * StreamBuffer instead of their own vertex buffer, so changing points
+     * every frame does not stall on or reallocate GPU memory.
      */
     class Model {
     public:
         using Ptr = shared_ptr<Model>;
         using ConstPtr = const shared_ptr<Model>;
 
-    private:
-        VertexBufferArray array;
+        /**
+         * Layout of the vertex buffer.
+         */
+        enum VertexFormat {
+            /// 32 bytes, float3 position, float3 normal and float2 uv
+            Float,
+            /// 16 bytes, unorm16 x3 position in the bounds, octahedral snorm16
+            /// x2 normal and half x2 uv, the shader must decode these. See
+            /// VertexPacker, no float vertex buffer is kept
+            Packed,
+        };
+
+    protected:
+        VertexBufferArray                array;
+        GLuint                           indexBuffer;
+        GLenum                           indexType;
+        size_t                           indexCount;
+        AABB                             bounds;
+        BoundingSphere                   sphere;
+        uint64_t                         boundsVersion;
+        mutable size_t                   lodLevel;
+        GLuint                           packedArray;
+        GLuint                           packedBuffer;
+        vec3                             quantOffset;
+        vec3                             quantScale;
+        size_t                           indexBytes;
+        bool                             streamed;
+        mutable GLuint                   streamArray;
+        mutable TransformCache           transformCache;
+        mutable StreamBuffer::Allocation streamAllocation;
+
+        /**
+         * Bind the vertex array for format. Streamed points are written again
+         * if their StreamBuffer segment has been reused.
+         */
+        void bindVertexArray() const;
+
+        /**
+         * Write points to the StreamBuffer and point streamArray at them.
+         */
+        void streamPoints() const;
+
+        /**
+         * Upload points to the packed vertex buffer and setup packedArray.
+         *
+         * @param usage the buffer usage hint
+         */
+        void updatePacked(GLenum usage);
+
+        /**
+         * Calculate bounds and sphere from points. This is called by
+         * Model::update().
+         */
+        virtual void updateBounds();
 
     public:
-        vector<Vertex> points;
-        Material::Ptr  material;
-        Transform      transform;
+        vector<Vertex>   points;
+        vector<uint32_t> indices;
+        Material::Ptr    material;
+        Transform        transform;
+        /// Layout of the vertex buffer, call Model::update() after changing
+        VertexFormat format;
+
+        /// Lower detail meshes, lods[i] is drawn when the projected size is
+        /// below lodSizes[i]
+        vector<shared_ptr<Model>> lods;
+        /// Fraction of the screen height for each lod, largest first
+        vector<float> lodSizes;
+        /// Fraction of a lod size the projected size must pass by to change
+        /// level, this stops popping back and forth at a boundary
+        float lodHysteresis;
 
         /**
          * Create an empty Model. This will do nothing until points are added to
@@ -73,22 +153,162 @@ namespace singe {
         virtual ~Model();
 
         /**
-         * Buffer points into the vertex buffer.
+         * Buffer points into the vertex buffer, indices into the index buffer
+         * and update the bounds. Indices are stored as 16-bit when there are
+         * few enough points.
+         *
+         * With Buffer::Dynamic and the Float format points are written to
+         * the StreamBuffer, and indices of the same size are written over
+         * the old ones.
          *
-         * This method must be called after any changes to points.
+         * This method must be called after any changes to points or indices.
          *
          * @param usage glpp::Buffer usage hint
          */
         void update(Buffer::Usage usage = Buffer::Static);
 
+        /**
+         * Get transform as a matrix. The matrix is cached until transform
+         * changes.
+         *
+         * @return the local matrix
+         */
+        const mat4 & getLocalMatrix() const;
+
+        /**
+         * Get parent * transform. The matrix is cached until transform or
+         * the parent changes.
+         *
+         * @param parent the world matrix of the parent Scene
+         * @param parentVersion the parent's version from
+         *                      Scene::getWorldVersion(), or
+         *                      TransformCache::Unversioned to compare parent
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorldMatrix(
+            const mat4 & parent,
+            uint64_t     parentVersion = TransformCache::Unversioned) const;
+
+        /**
+         * Read matrices from a TransformStore node. This is called by
+         * TransformStore::add() and TransformStore::clear(), moving the Model
+         * moves the binding with it.
+         *
+         * @param store the store, or nullptr to use transform again
+         * @param node the node handle in store
+         */
+        void bindTransformStore(TransformStore * store, uint32_t node) const;
+
+        /**
+         * Get the version of the last world matrix from
+         * Model::getWorldMatrix().
+         *
+         * @return the world version
+         */
+        uint64_t getWorldVersion() const;
+
+        /**
+         * Get the box containing all points, not including transform.
+         *
+         * @return the local bounding box from the last Model::update()
+         */
+        const AABB & getBounds() const;
+
+        /**
+         * Get the version of the bounds, which changes on every
+         * Model::update(). Versions come from TransformCache::nextVersion(),
+         * so they are comparable with world versions.
+         *
+         * @return the bounds version
+         */
+        uint64_t getBoundsVersion() const;
+
+        /**
+         * Get the sphere containing all points, not including transform.
+         *
+         * @return the local bounding sphere from the last Model::update()
+         */
+        const BoundingSphere & getBoundingSphere() const;
+
+        /**
+         * Get the number of vertices Model::drawMesh() submits, the index
+         * count when the mesh is indexed.
+         *
+         * @return the vertex count of one draw
+         */
+        size_t getDrawCount() const;
+
+        /**
+         * Weld duplicate points into indices, then reorder for the vertex
+         * cache and vertex fetch with MeshOptimizer. Call Model::update()
+         * after this to buffer the result.
+         */
+        void optimize();
+
+        /**
+         * Build lower detail meshes from points with MeshSimplifier.
+         *
+         * @param ratios fraction of triangles to keep for each lod
+         * @param sizes fraction of the screen height below which each lod is
+         *              used, must be the same length as ratios
+         */
+        void generateLods(const vector<float> & ratios, const vector<float> & sizes);
+
+        /**
+         * Get the height of the bounding sphere on screen.
+         *
+         * @param world the model's global transform
+         * @param projection the camera projection transform
+         * @param view the camera view transform
+         *
+         * @return the projected size as a fraction of the screen height
+         */
+        float screenSize(const mat4 & world,
+                         const mat4 & projection,
+                         const mat4 & view) const;
+
+        /**
+         * Choose the lod to draw from the projected size. The chosen level is
+         * kept for hysteresis so a Model shared by several scenes will use
+         * the band of the last one drawn.
+         *
+         * @param world the model's global transform
+         * @param projection the camera projection transform
+         * @param view the camera view transform
+         *
+         * @return this or one of lods
+         */
+        const Model & selectLod(const mat4 & world,
+                                const mat4 & projection,
+                                const mat4 & view) const;
+
+        /**
+         * Set the vertex decode parameters of this model's format in state.
+         * This must be applied before the shader is bound.
+         *
+         * @param state the RenderState to update
+         */
+        void applyFormat(RenderState & state) const;
+
         /**
          * Draw the vertex buffer.
          *
+         * The lod is chosen with Model::selectLod().
+         *
          * You must call Model::update() to buffer any changes to points before
          * drawing.
          *
          * @param state the parent state with transform for shader's mvp uniform
          */
         void draw(RenderState state) const;
+
+        /**
+         * Draw the vertex buffer without binding the Material or Shader.
+         *
+         * This is used by RenderQueue which binds state once for a group of
+         * models.
+         */
+        virtual void drawMesh() const;
     };
 }
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Model.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::vec3;
+
+    /**
+     * Skip models hidden behind other geometry using hardware occlusion
+     * queries.
+     *
+     * After the frame is drawn, the bounding box of each model is drawn with
+     * color and depth writes disabled inside a GL_ANY_SAMPLES_PASSED query.
+     * On the next frame the result is polled without waiting:
+     *
+     * - available and no samples passed, the model is rejected on the CPU
+     * - available and samples passed, the model is drawn normally
+     * - not available yet, the model is drawn inside
+     *   glBeginConditionalRender() with GL_QUERY_NO_WAIT so the GPU decides
+     *
+     * The CPU never waits for a query result. As visibility comes from the
+     * previous frame, a model can appear one frame late when it is uncovered.
+     *
+     * Models are identified by their Model pointer and the order they are
+     * acquired in each frame, so a Model drawn in several places has a query
+     * for each.
+     */
+    class OcclusionCuller {
+    public:
+        using Ptr = shared_ptr<OcclusionCuller>;
+        using ConstPtr = const shared_ptr<OcclusionCuller>;
+
+        /**
+         * Counters for the current frame, reset by
+         * OcclusionCuller::beginFrame().
+         */
+        struct Stats {
+            /// Number of occlusion queries issued
+            size_t queries;
+            /// Number of models skipped because their last query failed
+            size_t rejected;
+            /// Number of models drawn with conditional rendering
+            size_t conditional;
+
+            Stats();
+        };
+
+    private:
+        struct Object {
+            GLuint        query;
+            bool          pending;
+            bool          visible;
+            bool          inside;
+            bool          conditional;
+            const Model * model;
+            mat4          world;
+        };
+
+        struct Slot {
+            vector<uint32_t> objects;
+            size_t           used;
+            uint32_t         frame;
+        };
+
+        vector<Object>                           objects;
+        std::unordered_map<const Model *, Slot> slots;
+        vector<uint32_t>                         candidates;
+        uint32_t                                 frame;
+        vec3                                     cameraPos;
+        Stats                                    stats;
+
+        GLuint program;
+        GLint  mvpLocation;
+        GLuint vertexArray;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+
+        void setup();
+
+        void release();
+
+    public:
+        OcclusionCuller();
+
+        OcclusionCuller(OcclusionCuller && other);
+
+        OcclusionCuller & operator=(OcclusionCuller && other);
+
+        OcclusionCuller(const OcclusionCuller &) = delete;
+        OcclusionCuller & operator=(const OcclusionCuller &) = delete;
+
+        ~OcclusionCuller();
+
+        /**
+         * Delete all queries. Every model is treated as visible until it has
+         * been queried again.
+         */
+        void clear();
+
+        /**
+         * Start a frame by polling the results of the previous frame's
+         * queries and resetting stats.
+         *
+         * @param state the RenderState with the camera transforms
+         */
+        void beginFrame(const RenderState & state);
+
+        /**
+         * Get the object id of a model for this frame. Models must be
+         * acquired in the same order each frame.
+         *
+         * @param model the Model to draw
+         * @param world the model's global transform
+         *
+         * @return the object id for OcclusionCuller::beginDraw()
+         */
+        uint32_t acquire(const Model & model, const mat4 & world);
+
+        /**
+         * Start drawing an object.
+         *
+         * @param object the id from OcclusionCuller::acquire()
+         *
+         * @return false if the object is occluded and must not be drawn
+         */
+        bool beginDraw(uint32_t object);
+
+        /**
+         * Finish drawing an object, this must be called after each
+         * OcclusionCuller::beginDraw() that returned true.
+         *
+         * @param object the id from OcclusionCuller::acquire()
+         */
+        void endDraw(uint32_t object);
+
+        /**
+         * Issue queries for the bounding boxes of all objects acquired this
+         * frame. Call this after all occluders have been drawn.
+         *
+         * @param state the RenderState with the camera transforms
+         */
+        void endFrame(const RenderState & state);
+
+        /**
+         * Get the counters for the current frame.
+         *
+         * @return the occlusion stats
+         */
+        const Stats & getStats() const;
+    };
+}
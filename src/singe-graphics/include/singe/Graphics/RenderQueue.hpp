@@ -0,0 +1,275 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DepthProgram.hpp"
+#include "Model.hpp"
+#include "OcclusionCuller.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+
+    /**
+     * Collect draw items for a frame, sort them by a 64-bit key and submit
+     * them with the fewest shader and texture binds.
+     *
+     * Opaque items are grouped by shader, material and texture set and drawn
+     * front-to-back within each group. Blended items (Material::alpha < 1)
+     * are drawn after all opaque items in back-to-front order, or grouped
+     * like opaque items when RenderQueue::setSortBlended() is off for order
+     * independent transparency.
+     *
+     * With RenderQueue::setDepthPrepass() on, opaque items are first drawn
+     * depth only with a DepthProgram, then drawn again with their materials
+     * testing `GL_EQUAL` without depth writes, so material shaders run once
+     * per visible pixel. Material vertex shaders must declare
+     * `invariant gl_Position` and compute it like DepthProgram does.
+     * Shaders that discard fragments are not supported by the pre-pass.
+     */
+    class RenderQueue {
+    public:
+        using Ptr = shared_ptr<RenderQueue>;
+        using ConstPtr = const shared_ptr<RenderQueue>;
+
+        /**
+         * The pass an item is drawn in. This is stored in the highest bits of
+         * the sort key.
+         */
+        enum Pass {
+            Opaque = 0,
+            Blended = 1,
+        };
+
+        /**
+         * Counters for the calls to RenderQueue::submit() since the last
+         * RenderQueue::clear(), all passes when they are submitted
+         * separately.
+         */
+        struct Stats {
+            /// Number of models drawn
+            size_t draws;
+            /// Number of vertices drawn after lod selection
+            size_t vertices;
+            /// Number of times a different shader was bound
+            size_t shaderBinds;
+            /// Number of times a different material was applied
+            size_t materialBinds;
+            /// Number of times a different texture set was bound
+            size_t textureBinds;
+            /// Number of models and scenes skipped by frustum culling
+            size_t culled;
+            /// Number of models drawn by the depth pre-pass
+            size_t prepassDraws;
+
+            Stats();
+        };
+
+    private:
+        struct Item {
+            const Model * model;
+            mat4          world;
+            mat4          local;
+            uint32_t      textureSet;
+        };
+
+        struct SortEntry {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        vector<Item>          items;
+        vector<SortEntry>     entries;
+        vector<SortEntry>     scratch;
+        vector<uint32_t>      occlusionIds;
+        // Per sorted entry, filled by submit
+        vector<const Model *> meshes;
+        vector<int64_t>       drawOffsets;
+        bool                  sorted;
+        bool                  sortBlended;
+        bool                  depthPrepass;
+        DepthProgram          depthProgram;
+        mutable Stats         stats;
+
+        std::unordered_map<const void *, uint32_t>        shaderIds;
+        std::unordered_map<const void *, uint32_t>        materialIds;
+        std::map<std::array<const void *, 3>, uint32_t> textureSetIds;
+
+        uint32_t shaderId(const Shader * shader);
+
+        uint32_t materialId(const Material * material);
+
+        uint32_t textureSetId(const Material * material);
+
+        /**
+         * Draw the sorted entries from first up to last. With the depth
+         * pre-pass on, the opaque entries at the start of the range are
+         * drawn twice.
+         */
+        void submitRange(const RenderState & state,
+                         size_t              first,
+                         size_t              last,
+                         OcclusionCuller *   occlusion);
+
+    public:
+        RenderQueue();
+
+        RenderQueue(RenderQueue && other);
+
+        RenderQueue & operator=(RenderQueue && other);
+
+        RenderQueue(const RenderQueue &) = delete;
+        RenderQueue & operator=(const RenderQueue &) = delete;
+
+        ~RenderQueue();
+
+        /**
+         * Remove all items from the queue and reset the stats. The buffers
+         * and id tables are kept so the next frame does not need to
+         * allocate.
+         */
+        void clear();
+
+        /**
+         * Get the number of items in the queue.
+         *
+         * @return the number of queued items
+         */
+        size_t size() const;
+
+        /**
+         * Set if blended items are sorted back-to-front. When off they are
+         * grouped by state like opaque items, which suits a blend that does
+         * not depend on order such as TransparencyRenderer. This applies to
+         * items pushed after the call.
+         *
+         * @param sort true to sort blended items by depth, the default
+         */
+        void setSortBlended(bool sort);
+
+        /**
+         * Check if blended items are sorted back-to-front.
+         *
+         * @return true if blended items are sorted by depth
+         */
+        bool getSortBlended() const;
+
+        /**
+         * Set if opaque items are drawn depth only before they are shaded.
+         * This pays off when material shaders are expensive and opaque
+         * geometry overlaps on screen, at the cost of drawing every opaque
+         * vertex twice.
+         *
+         * While submitting opaque items with the pre-pass the depth function
+         * is `GL_EQUAL`, afterwards it is `GL_LEQUAL` with depth writes on.
+         *
+         * @param prepass true to draw a depth pre-pass, off by default
+         */
+        void setDepthPrepass(bool prepass);
+
+        /**
+         * Check if opaque items are drawn depth only before they are shaded.
+         *
+         * @return true if the depth pre-pass is on
+         */
+        bool getDepthPrepass() const;
+
+        /**
+         * Add a model to the queue.
+         *
+         * The model transform must already be pushed to state.
+         *
+         * @param model the Model to draw
+         * @param state the RenderState with the model's global transform
+         */
+        void push(const Model & model, const RenderState & state);
+
+        /**
+         * Add a model to the queue with explicit transforms.
+         *
+         * @param model the Model to draw
+         * @param world the model's global transform
+         * @param local the model's own transform
+         * @param view the camera view transform, used for depth sorting
+         */
+        void push(const Model & model,
+                  const mat4 &  world,
+                  const mat4 &  local,
+                  const mat4 &  view);
+
+        /**
+         * Record models or scenes that were not pushed because they were
+         * culled. This count is reset by RenderQueue::clear().
+         *
+         * @param count the number of culled models or scenes
+         */
+        void addCulled(size_t count);
+
+        /**
+         * Sort the queued items by their key using a radix sort.
+         */
+        void sort();
+
+        /**
+         * Draw all queued items in sorted order. This will call
+         * RenderQueue::sort() if the queue has not been sorted.
+         *
+         * Only the projection, view and grid enable of state are used, the
+         * model and local transforms come from each item.
+         *
+         * If occlusion is given, models it reports as occluded are skipped
+         * and bounding box queries are issued for the next frame after all
+         * items are drawn.
+         *
+         * @param state the RenderState with the camera transforms
+         * @param occlusion optional OcclusionCuller to skip hidden models
+         */
+        void submit(const RenderState & state,
+                    OcclusionCuller *   occlusion = nullptr);
+
+        /**
+         * Draw only the queued items of one pass in sorted order. This will
+         * call RenderQueue::sort() if the queue has not been sorted.
+         *
+         * Passes can be submitted separately to change render targets or
+         * blending between them. Occlusion culling is not available here.
+         *
+         * @param state the RenderState with the camera transforms
+         * @param pass the pass to draw
+         */
+        void submit(const RenderState & state, Pass pass);
+
+        /**
+         * Get the counters from RenderQueue::submit() since the last
+         * RenderQueue::clear().
+         *
+         * @return the submit stats
+         */
+        const Stats & getStats() const;
+
+        /**
+         * Build the sort key for an item.
+         *
+         * @param pass the pass the item is drawn in
+         * @param shader the shader id
+         * @param material the material id
+         * @param textureSet the texture set id
+         * @param depth the view space distance from the camera
+         *
+         * @return the 64-bit sort key
+         */
+        static uint64_t makeKey(Pass     pass,
+                                uint32_t shader,
+                                uint32_t material,
+                                uint32_t textureSet,
+                                float    depth);
+    };
+}
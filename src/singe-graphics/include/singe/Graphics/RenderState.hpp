@@ -5,8 +5,12 @@
 #include <glpp/extra/Camera.hpp>
 #include <glpp/extra/Transform.hpp>
 
+#include "Frustum.hpp"
+#include "TransformCache.hpp"
+
 namespace singe {
     using glm::mat4;
+    using glm::vec3;
     using glpp::extra::Camera;
     using glpp::extra::Transform;
 
@@ -18,13 +22,23 @@ namespace singe {
      *
      * **note** local should only be the last transform applied to model. model
      * should be the latest local.
+     *
+     * projection * view is calculated once when the RenderState is created
+     * and copied with it.
      */
     class RenderState {
-        mat4 projection;
-        mat4 view;
-        mat4 model;
-        mat4 local;
-        bool drawGrid;
+        mat4     projection;
+        mat4     view;
+        mat4     vp;
+        mat4     model;
+        mat4     local;
+        uint64_t modelVersion;
+        bool     drawGrid;
+        bool     cull;
+        bool     packed;
+        vec3     positionOffset;
+        vec3     positionScale;
+        int64_t  drawOffset;
 
     public:
         /**
@@ -75,14 +89,100 @@ namespace singe {
          */
         void setGridEnable(bool enabled);
 
+        /**
+         * @brief Will scenes and models outside the frustum be skipped.
+         *
+         * @return is frustum culling enabled
+         */
+        bool getCullEnable() const;
+
+        /**
+         * @brief Enable or disable frustum culling of scenes and models.
+         *
+         * Scene bounds are updated by Scene::enqueue() when culling is
+         * enabled.
+         *
+         * @param enabled state of frustum culling
+         */
+        void setCullEnable(bool enabled);
+
+        /**
+         * Is the current mesh in Model::Packed format.
+         *
+         * @return true if vertex positions and normals must be decoded
+         */
+        bool getPacked() const;
+
+        /**
+         * Get the offset added to decoded packed positions.
+         *
+         * @return the minimum corner of the mesh bounds
+         */
+        const vec3 & getPositionOffset() const;
+
+        /**
+         * Get the scale applied to packed positions in the range 0 to 1.
+         *
+         * @return the size of the mesh bounds
+         */
+        const vec3 & getPositionScale() const;
+
+        /**
+         * Set how the shader decodes the vertices of the current mesh. This is
+         * set by Model before the shader is applied.
+         *
+         * @param packed is the mesh in Model::Packed format
+         * @param offset the minimum corner of the packed position range
+         * @param scale the size of the packed position range
+         */
+        void setVertexDecode(bool packed, const vec3 & offset, const vec3 & scale);
+
+        /**
+         * Get the offset of this draw's Draw block in the UniformBuffers
+         * ring.
+         *
+         * @return the offset, or -1 if the draw has not been uploaded
+         */
+        int64_t getDrawOffset() const;
+
+        /**
+         * Set the offset of this draw's Draw block. This is set by
+         * RenderQueue which uploads the blocks of all queued draws at once.
+         *
+         * @param offset the offset from UniformBuffers, or -1
+         */
+        void setDrawOffset(int64_t offset);
+
+        /**
+         * Get the view frustum from the projection and view transforms. This
+         * is calculated on each call.
+         *
+         * @return the view frustum in world space
+         */
+        Frustum getFrustum() const;
+
+        /**
+         * Get the projection transform.
+         *
+         * @return the projection matrix
+         */
+        const mat4 & getProjection() const;
+
+        /**
+         * Get the view transform.
+         *
+         * @return the view matrix
+         */
+        const mat4 & getView() const;
+
         /**
          * Get the vp transform.
          *
          * VP  = projection * view
          *
-         * @return the resulting matrix
+         * @return the cached matrix
          */
-        mat4 getVP() const;
+        const mat4 & getVP() const;
 
         /**
          * Get the mvp transform.
@@ -107,6 +207,23 @@ namespace singe {
          */
         const mat4 & getLocal() const;
 
+        /**
+         * Get the version of the model transform from TransformCache.
+         *
+         * @return the version or TransformCache::Unversioned if the model
+         *         transform was pushed without a cache
+         */
+        uint64_t getModelVersion() const;
+
+        /**
+         * Replace the model and local transforms with cached matrices.
+         *
+         * @param model the world matrix
+         * @param local the last transform applied to model
+         * @param version the version of model from TransformCache
+         */
+        void setModel(const mat4 & model, const mat4 & local, uint64_t version);
+
         /**
          *  Call pushTransform with the Transform matrix.
          *
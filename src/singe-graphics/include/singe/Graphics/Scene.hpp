@@ -5,8 +5,12 @@
 #include <memory>
 #include <vector>
 
+#include "Bounds.hpp"
+#include "Light.hpp"
 #include "Model.hpp"
+#include "RenderQueue.hpp"
 #include "RenderState.hpp"
+#include "TransformCache.hpp"
 
 using glpp::extra::Grid;
 
@@ -17,6 +21,9 @@ namespace singe {
 
     /**
      * Group of Models and child Scenes.
+     *
+     * Local and world matrices of scenes and models are cached, a frame where
+     * no transform changed does not convert or multiply any transforms.
      */
     struct Scene {
         using Ptr = shared_ptr<Scene>;
@@ -24,8 +31,39 @@ namespace singe {
 
         vector<Scene::Ptr> children;
         vector<Model::Ptr> models;
+        /// Lights in this scene's space, used by the DeferredRenderer
+        vector<Light>      lights;
         Grid::Ptr          grid;
         Transform          transform;
+        /// Draw opaque models depth only first in Scene::draw(), see
+        /// RenderQueue::setDepthPrepass()
+        bool depthPrepass;
+
+    private:
+        mutable TransformCache transformCache;
+        mutable AABB           worldBounds;
+        mutable uint64_t       boundsVersion;
+        mutable size_t         boundsItems;
+
+        /**
+         * Update the world bounds of this scene and all child scenes. Only
+         * scenes where a world version, model bounds version or the number
+         * of models and children changed are combined again.
+         *
+         * @param parent the world matrix of the parent
+         * @param parentVersion the parent's world version
+         *
+         * @return the newest version in this scene and all child scenes
+         */
+        uint64_t updateBounds(const mat4 & parent,
+                              uint64_t     parentVersion) const;
+
+        /**
+         * Scene::enqueue() after the bounds have been updated.
+         */
+        void enqueueVisible(RenderQueue & queue, RenderState state) const;
+
+    public:
 
         Scene();
 
@@ -53,11 +91,109 @@ namespace singe {
         Model::Ptr & addModel();
 
         /**
-         * Draw child scenes and then mesh in this scene.
+         * Create and return a new model of a type derived from Model, eg.
+         * InstancedModel.
+         *
+         * @return shared_ptr to the new model
+         */
+        template<typename T>
+        shared_ptr<T> addModel() {
+            auto model = std::make_shared<T>();
+            models.emplace_back(model);
+            return model;
+        }
+
+        /**
+         * Get transform as a matrix. The matrix is cached until transform
+         * changes.
          *
-         * Models in this scene will be drawn with this transform and child
+         * @return the local matrix
+         */
+        const mat4 & getLocalMatrix() const;
+
+        /**
+         * Get parent * transform. The matrix is cached until transform or
+         * the parent changes.
+         *
+         * @param parent the world matrix of the parent
+         * @param parentVersion the parent's version from
+         *                      Scene::getWorldVersion(), or
+         *                      TransformCache::Unversioned to compare parent
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorldMatrix(
+            const mat4 & parent,
+            uint64_t     parentVersion = TransformCache::Unversioned) const;
+
+        /**
+         * Read matrices from a TransformStore node. This is called by
+         * TransformStore::add() and TransformStore::clear(), moving the Scene
+         * moves the binding with it.
+         *
+         * @param store the store, or nullptr to use transform again
+         * @param node the node handle in store
+         */
+        void bindTransformStore(TransformStore * store, uint32_t node) const;
+
+        /**
+         * Get the version of the last world matrix from
+         * Scene::getWorldMatrix(). Children compare this to find out if
+         * their world matrix must be updated.
+         *
+         * @return the world version
+         */
+        uint64_t getWorldVersion() const;
+
+        /**
+         * Get the bounds of all models and child scenes in world space.
+         *
+         * @return the bounds from the last Scene::enqueue() with culling
+         *         enabled
+         */
+        const AABB & getBounds() const;
+
+        /**
+         * Add models in this scene and all child scenes to queue. Grids are
+         * drawn immediately as they are not part of the queue.
+         *
+         * Models in this scene will be queued with this transform and child
          * scenes will transform with this scene as their origin.
          *
+         * If culling is enabled in state, child scenes and models that are
+         * outside the view frustum are skipped. Scene bounds are updated
+         * first, following changes to transforms, models and children.
+         *
+         * @param queue the RenderQueue to add models to
+         * @param state the RenderState with the current global transform
+         */
+        void enqueue(RenderQueue & queue, RenderState state) const;
+
+        /**
+         * Append the lights of this scene and all child scenes to lights,
+         * transformed to world space.
+         *
+         * @param lights the list to append to
+         * @param parent the world matrix of the parent scene
+         */
+        void collectLights(vector<Light> & lights,
+                           const mat4 &    parent = mat4(1)) const;
+
+        /**
+         * Draw this scene and all child scenes through queue.
+         *
+         * The queue is cleared, filled with Scene::enqueue(), sorted and
+         * submitted, with a depth pre-pass if Scene::depthPrepass is set.
+         * Re-using the same queue each frame avoids allocations.
+         *
+         * @param state the RenderState with the current global transform
+         * @param queue the RenderQueue used to sort models
+         */
+        void draw(RenderState state, RenderQueue & queue) const;
+
+        /**
+         * Draw this scene and all child scenes using a temporary RenderQueue.
+         *
          * @param state the RenderState with the current global transform
          */
         void draw(RenderState state) const;
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <GL/glew.h>
+
 #include <glpp/Shader.hpp>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "RenderState.hpp"
@@ -11,10 +14,18 @@
 namespace singe {
     using std::shared_ptr;
     using std::string;
+    using std::unordered_map;
     using std::vector;
 
     /**
      * Wrapper for glpp shader which also holds mvp uniform.
+     *
+     * If the program declares the `Frame` or `Draw` uniform blocks of
+     * UniformBuffers they are assigned to their binding points here, as
+     * are the blocks and samplers registered with ShaderBindings.
+     *
+     * Active uniform locations are read once with glGetActiveUniform when
+     * the Shader is created, see Shader::location().
      */
     class Shader {
     public:
@@ -22,8 +33,14 @@ namespace singe {
         using ConstPtr = const shared_ptr<Shader>;
 
     protected:
-        glpp::Shader              m_shader;
-        vector<UniformExtra::Ptr> m_extras;
+        glpp::Shader                 m_shader;
+        GLuint                       m_program;
+        unordered_map<string, GLint> m_locations;
+        vector<UniformExtra::Ptr>    m_extras;
+        shared_ptr<uint64_t>         m_extrasVersion;
+        mutable uint64_t             m_sentExtras;
+        bool                         m_frameBlock;
+        bool                         m_drawBlock;
 
     public:
         /**
@@ -42,6 +59,38 @@ namespace singe {
          */
         const glpp::Shader & shader() const;
 
+        /**
+         * Get the OpenGL program name of the glpp::Shader.
+         *
+         * @return the program name
+         */
+        GLuint program() const;
+
+        /**
+         * Does the program use the UniformBuffers Frame block.
+         *
+         * @return true if the block is declared and used
+         */
+        bool usesFrameBlock() const;
+
+        /**
+         * Does the program use the UniformBuffers Draw block.
+         *
+         * @return true if the block is declared and used
+         */
+        bool usesDrawBlock() const;
+
+        /**
+         * Get the location of an active uniform. Arrays can be found with or
+         * without the `[0]` suffix.
+         *
+         * @param name the uniform name
+         *
+         * @return the location, or -1 if the uniform is not active or is in
+         *         a uniform block
+         */
+        GLint location(const string & name) const;
+
         /**
          * Get a glpp::Uniform for name from the glpp::Shader.
          *
@@ -52,24 +101,62 @@ namespace singe {
         glpp::Uniform uniform(const string & name) const;
 
         /**
-         * Add an exta uniform to be applied when this shader is bound.
+         * Add an exta uniform to be sent when it changes.
          *
-         * @param extra a shared_ptr to a derived class of UniformExtra
+         * @param extra a UniformExtra for this shader's program
          */
         void addExtra(UniformExtra::ConstPtr & extra);
 
         /**
-         * Bind the shader
+         * Create and add an extra uniform by name.
+         *
+         * @param name the uniform name
+         * @param value the initial value
+         *
+         * @return the extra, set its value to update the uniform
+         */
+        template <typename T>
+        typename TypedUniformExtra<T>::Ptr
+            addExtra(const string & name, const T & value = T(0)) {
+            auto extra = std::make_shared<TypedUniformExtra<T>>(
+                m_program, location(name), value);
+            addExtra(extra);
+            return extra;
+        }
+
+        /**
+         * Send every extra uniform that changed since it was last sent. The
+         * program does not need to be bound, it is bound through StateCache
+         * when glProgramUniform is not available. This is called by
+         * Shader::bind(RenderState &) and does nothing if no extra changed.
+         */
+        void sendExtras() const;
+
+        /**
+         * Bind the shader. This is skipped by the StateCache if the shader is
+         * already bound.
          */
         void bind() const;
 
         /**
-         * Bind the shader and apply any extra uniforms.
+         * Bind the shader and the Frame block, send changed extra uniforms,
+         * then call Shader::apply().
          *
          * @param state the RenderState including transforms
          */
         virtual void bind(RenderState & state) const;
 
+        /**
+         * Apply per-draw uniforms to this shader without binding it or sending
+         * the extra uniforms. The shader must already be bound.
+         *
+         * If the program uses the Draw block the draw's range is bound,
+         * uploading it first if RenderState::getDrawOffset() is not set.
+         *
+         * @param state the RenderState including transforms
+         */
+        virtual void apply(RenderState & state) const;
+
         /**
          * Unbind the shader, effectively binding 0.
          */
@@ -78,7 +165,14 @@ namespace singe {
 
     /**
      * Derived Shader which holds a uniform called mvp. The glpp::Shader must
-     * have a uniform called mvp of type mat4.
+     * have a uniform called mvp of type mat4, or use the Draw block of
+     * UniformBuffers.
+     *
+     * If the shader has the uniforms `bool packedVertex`, `vec3 posOffset`
+     * and `vec3 posScale` they are set from RenderState so Model::Packed
+     * meshes can be decoded, and `mat4 model` is set to the world matrix,
+     * see `shader/instanced.vert`. With the Draw block these are part of
+     * the block instead, see `shader/default.vert`.
      */
     class MVPShader : public Shader {
     public:
@@ -87,6 +181,10 @@ namespace singe {
 
     private:
         glpp::Uniform m_mvp;
+        GLint         m_model;
+        GLint         m_packed;
+        GLint         m_positionOffset;
+        GLint         m_positionScale;
 
     public:
         /**
@@ -110,5 +208,14 @@ namespace singe {
          * @param state the RenderState including transforms
          */
         void bind(RenderState & state) const override;
+
+        /**
+         * Apply the mvp, model and vertex decode uniforms to the already
+         * bound shader. With the Draw block, Shader::apply() binds the
+         * draw's range instead.
+         *
+         * @param state the RenderState including transforms
+         */
+        void apply(RenderState & state) const override;
     };
 }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+namespace singe {
+    using std::vector;
+
+    /**
+     * Uniform blocks and samplers that passes bind once for every shader, at
+     * fixed binding points and texture units.
+     *
+     * Passes register their names during static initialisation, so every
+     * Shader, whenever it is created, assigns the blocks and samplers it
+     * declares. Names a program does not declare are skipped.
+     *
+     * ```cpp
+     * static const bool kRegistered =
+     *     ShaderBindings::addBlock("Shadows", 3)
+     *     && ShaderBindings::addSampler("shadowMap", 11);
+     * ```
+     */
+    class ShaderBindings {
+    public:
+        /**
+         * A block name and binding point, or a sampler name and unit.
+         */
+        struct Binding {
+            const char * name;
+            GLuint       index;
+        };
+
+        /**
+         * Register a uniform block binding point.
+         *
+         * @param name the block name, must outlive the registry
+         * @param binding the binding point
+         *
+         * @return true, so it can initialise a constant
+         */
+        static bool addBlock(const char * name, GLuint binding);
+
+        /**
+         * Register a texture unit for a sampler uniform.
+         *
+         * @param name the sampler name, must outlive the registry
+         * @param unit the texture unit
+         *
+         * @return true, so it can initialise a constant
+         */
+        static bool addSampler(const char * name, GLuint unit);
+
+        /**
+         * Get the registered uniform blocks.
+         *
+         * @return the blocks and their binding points
+         */
+        static const vector<Binding> & getBlocks();
+
+        /**
+         * Get the registered samplers.
+         *
+         * @return the samplers and their texture units
+         */
+        static const vector<Binding> & getSamplers();
+
+    private:
+        static vector<Binding> & blocks();
+
+        static vector<Binding> & samplers();
+    };
+}
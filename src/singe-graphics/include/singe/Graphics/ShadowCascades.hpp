@@ -0,0 +1,234 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "Bounds.hpp"
+#include "DepthProgram.hpp"
+#include "Frustum.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using glm::mat4;
+    using glm::vec3;
+    using glm::vec4;
+
+    struct Scene;
+    class Model;
+
+    /**
+     * Cascaded shadow maps for one directional light.
+     *
+     * The camera range from the near plane to the shadow distance is split
+     * into ShadowCascades::Cascades slices, closer to logarithmic than
+     * linear, and each slice gets a layer of a depth array rendered from the
+     * light. Cascades are fitted to a bounding sphere of the slice so they
+     * do not change size as the camera turns.
+     *
+     * Static casters are rendered to a cached array and only redrawn for a
+     * cascade when the light moves, the cascade moves, a static caster
+     * moves or is updated, or ShadowCascades::invalidateStatic() is called.
+     * Static casters are found to have changed from their world and bounds
+     * versions. Cascade centres snap to
+     * steps of 1/CacheSteps of their size, with the cascade grown to cover
+     * the step, so a moving camera only re-renders a cascade every few
+     * steps instead of every frame. Each frame the cached layers are copied
+     * to the sampled array and dynamic casters are drawn on top.
+     *
+     * Casters are drawn depth only with a DepthProgram and no material
+     * binds.
+     *
+     * Shaders opt in by declaring the block and sampler below, they are
+     * registered with ShaderBindings so every Shader binds them to
+     * ShadowCascades::ShadowBinding and ShadowCascades::ShadowUnit when it
+     * is created. See shader/shadowed.frag.
+     *
+     * ```glsl
+     * layout (std140) uniform Shadows {
+     *     mat4 shadowMatrices[4]; // world to shadow map uv and depth
+     *     vec4 cascadeSplits;     // far view depth of each cascade
+     *     vec4 shadowLight;       // xyz direction the light travels
+     * };
+     *
+     * uniform sampler2DArrayShadow shadowMap;
+     * ```
+     */
+    class ShadowCascades {
+    public:
+        using Ptr = shared_ptr<ShadowCascades>;
+        using ConstPtr = const shared_ptr<ShadowCascades>;
+
+        /// Number of cascades, also the size of the arrays in the block
+        static constexpr size_t Cascades = 4;
+        /// Cascades move in steps of 1 / CacheSteps of their size
+        static constexpr float CacheSteps = 8;
+
+        /// Binding point of the Shadows block
+        static constexpr GLuint ShadowBinding = 3;
+        /// Name of the shadow block in shaders
+        static constexpr const char * ShadowBlock = "Shadows";
+        /// Texture unit of the shadow map
+        static constexpr GLuint ShadowUnit = 11;
+        /// Sampler name bound to ShadowCascades::ShadowUnit by Shader
+        static constexpr const char * ShadowSampler = "shadowMap";
+
+        /// Layout of the Shadows block
+        struct ShadowData {
+            mat4 matrices[Cascades];
+            vec4 splits;
+            vec4 light;
+        };
+
+        /**
+         * Counts from the last ShadowCascades::render().
+         */
+        struct Stats {
+            /// Cascades whose static casters were redrawn
+            size_t staticCascades;
+            /// Static models drawn
+            size_t staticCasters;
+            /// Dynamic models drawn
+            size_t dynamicCasters;
+
+            Stats();
+        };
+
+    private:
+        /// Light space projection of one cascade
+        struct Cascade {
+            mat4     viewProjection;
+            Frustum  frustum;
+            /// Matrix the static layer was rendered with
+            mat4     cachedMatrix;
+            uint64_t cachedVersion;
+        };
+
+        GLsizei    size;
+        float      distance;
+        float      splitLambda;
+        float      depthMargin;
+        Cascade    cascades[Cascades];
+        ShadowData block;
+        uint64_t   staticVersion;
+        Stats      stats;
+
+        /// Static casters the cache was drawn from, the newest world or
+        /// bounds version in them and their number of models and scenes
+        const Scene * staticScene;
+        uint64_t      staticNewest;
+        size_t        staticItems;
+
+        GLuint       staticArray;
+        GLuint       shadowArray;
+        GLuint       staticBuffer;
+        GLuint       shadowBuffer;
+        GLuint       blockBuffer;
+        DepthProgram casterProgram;
+
+        void setup();
+
+        void release();
+
+        /**
+         * Fit each cascade to its slice of the camera frustum.
+         */
+        void updateCascades(const RenderState & state, const vec3 & direction);
+
+        /**
+         * Invalidate the static cache if the static casters changed since
+         * it was drawn.
+         */
+        void checkStatic(const Scene * casters, const RenderState & state);
+
+        /**
+         * Draw the models of scene and its children that touch the cascade
+         * frustum into the bound layer.
+         *
+         * @return the number of models drawn
+         */
+        size_t drawCasters(const Scene &       scene,
+                           const mat4 &        parent,
+                           uint64_t            parentVersion,
+                           const Cascade &     cascade,
+                           const RenderState & camera);
+
+        void drawCaster(const Model &       model,
+                        const mat4 &        world,
+                        const Cascade &     cascade,
+                        const RenderState & camera);
+
+    public:
+        /**
+         * Create a ShadowCascades.
+         *
+         * @param size the width and height of each cascade layer
+         * @param distance the view distance covered, clamped to the camera
+         *                 far plane
+         * @param splitLambda 0 for evenly spaced splits up to 1 for
+         *                    logarithmic splits
+         */
+        ShadowCascades(GLsizei size = 2048,
+                       float   distance = 60,
+                       float   splitLambda = 0.75);
+
+        /// @brief  Move constructor
+        /// @param other Other ShadowCascades to move fields from
+        ShadowCascades(ShadowCascades && other);
+
+        /// @brief Move operator
+        /// @param other Other ShadowCascades to move fields from
+        /// @return This ShadowCascades
+        ShadowCascades & operator=(ShadowCascades && other);
+
+        ShadowCascades(const ShadowCascades &) = delete;
+        ShadowCascades & operator=(const ShadowCascades &) = delete;
+
+        ~ShadowCascades();
+
+        /**
+         * Set how far towards the light casters outside a cascade are
+         * still drawn.
+         *
+         * @param margin the distance in world units
+         */
+        void setDepthMargin(float margin);
+
+        /**
+         * Redraw the static casters of every cascade on the next
+         * ShadowCascades::render(). Moved or updated static casters are
+         * found by ShadowCascades::render(), call this after changing a
+         * Material or Model::lods of one.
+         */
+        void invalidateStatic();
+
+        /**
+         * Render the cascades for the camera of state. The viewport and
+         * framebuffer are restored afterwards.
+         *
+         * @param state the RenderState with the camera transforms
+         * @param direction the direction the light travels
+         * @param staticCasters scene drawn to the cache, or nullptr
+         * @param dynamicCasters scene drawn every frame, or nullptr
+         */
+        void render(const RenderState & state,
+                    const vec3 &        direction,
+                    const Scene *       staticCasters,
+                    const Scene *       dynamicCasters);
+
+        /**
+         * Bind the Shadows block and the shadow map.
+         */
+        void bind() const;
+
+        /**
+         * Get the counts from the last ShadowCascades::render().
+         *
+         * @return the stats
+         */
+        const Stats & getStats() const;
+    };
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <glpp/Texture.hpp>
+
+namespace singe {
+    using glpp::Texture;
+
+    /**
+     * Shadow copy of OpenGL state for the current context. Calls that would
+     * not change the bound program, vertex array, textures or the
+     * blend / depth / cull state are skipped.
+     *
+     * The cache only knows about calls made through it. Code that changes
+     * state directly, like glpp::extra::Grid or SFML drawing, must be
+     * followed by StateCache::invalidate() or StateCache::invalidateBindings()
+     * so the next call is issued.
+     */
+    class StateCache {
+    public:
+        /// Number of texture units tracked by the cache
+        static constexpr size_t MaxTextureUnits = 16;
+
+        /**
+         * Counters for calls made through the cache.
+         */
+        struct Stats {
+            /// Number of calls forwarded to OpenGL
+            size_t issued;
+            /// Number of calls skipped because the state was already set
+            size_t skipped;
+
+            Stats();
+        };
+
+    private:
+        struct TextureUnit {
+            bool         valid;
+            GLenum       target;
+            GLuint       name;
+            const void * object;
+        };
+
+        struct Capability {
+            bool valid;
+            bool enabled;
+        };
+
+        bool   programValid;
+        GLuint program;
+
+        bool   vertexArrayValid;
+        GLuint vertexArray;
+
+        bool        activeUnitValid;
+        GLuint      activeUnit;
+        TextureUnit units[MaxTextureUnits];
+
+        Capability blendCap;
+        Capability depthTestCap;
+        Capability cullFaceCap;
+
+        bool   blendFuncValid;
+        GLenum blendSrc, blendDst;
+        bool   depthFuncValid;
+        GLenum depthFn;
+        bool   depthMaskValid;
+        bool   depthWrite;
+        bool   cullModeValid;
+        GLenum cullMode;
+        bool   frontFaceValid;
+        GLenum frontFaceMode;
+
+        Stats stats;
+
+        Capability * capability(GLenum cap);
+
+        bool skip(bool unchanged);
+
+    public:
+        /**
+         * Create a StateCache where all state is unknown.
+         */
+        StateCache();
+
+        StateCache(const StateCache &) = delete;
+        StateCache & operator=(const StateCache &) = delete;
+
+        ~StateCache();
+
+        /**
+         * Get the StateCache for the context that is current on this thread.
+         *
+         * @return the StateCache for this thread's context
+         */
+        static StateCache & current();
+
+        /**
+         * Forget all state. The next call for each state will be issued.
+         */
+        void invalidate();
+
+        /**
+         * Forget the bound program, vertex array and textures but keep the
+         * blend / depth / cull state.
+         */
+        void invalidateBindings();
+
+        /**
+         * Forget the bound vertex array. This should be called after drawing
+         * with a glpp::BufferArray which binds it's own vertex array.
+         */
+        void invalidateVertexArray();
+
+        /**
+         * Bind a shader program with glUseProgram.
+         *
+         * @param program the program name
+         */
+        void useProgram(GLuint program);
+
+        /**
+         * Bind a vertex array object with glBindVertexArray.
+         *
+         * @param vertexArray the vertex array name
+         */
+        void bindVertexArray(GLuint vertexArray);
+
+        /**
+         * Set the active texture unit with glActiveTexture.
+         *
+         * @param unit the texture unit index, not GL_TEXTURE0 + unit
+         */
+        void activeTexture(GLuint unit);
+
+        /**
+         * Bind a texture name to unit with glBindTexture.
+         *
+         * @param unit the texture unit index
+         * @param target the texture target, eg. GL_TEXTURE_2D
+         * @param texture the texture name
+         */
+        void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+        /**
+         * Bind a glpp::Texture to unit with Texture::bind().
+         *
+         * @param unit the texture unit index
+         * @param texture the texture to bind
+         */
+        void bindTexture(GLuint unit, const Texture * texture);
+
+        /**
+         * Enable or disable GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE. Other
+         * capabilities are forwarded without caching.
+         *
+         * @param cap the capability
+         * @param enabled should the capability be enabled
+         */
+        void setEnabled(GLenum cap, bool enabled);
+
+        /**
+         * Set the blend function with glBlendFunc.
+         *
+         * @param src the source factor
+         * @param dst the destination factor
+         */
+        void blendFunc(GLenum src, GLenum dst);
+
+        /**
+         * Set the depth function with glDepthFunc.
+         *
+         * @param func the depth comparison function
+         */
+        void depthFunc(GLenum func);
+
+        /**
+         * Enable or disable depth writes with glDepthMask.
+         *
+         * @param write should depth be written
+         */
+        void depthMask(bool write);
+
+        /**
+         * Set the culled face with glCullFace.
+         *
+         * @param mode GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
+         */
+        void cullFace(GLenum mode);
+
+        /**
+         * Set the front face winding with glFrontFace.
+         *
+         * @param mode GL_CW or GL_CCW
+         */
+        void frontFace(GLenum mode);
+
+        /**
+         * Get the issued and skipped call counters.
+         *
+         * @return the counters since the last reset
+         */
+        const Stats & getStats() const;
+
+        /**
+         * Reset the issued and skipped counters to 0.
+         */
+        void resetStats();
+    };
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+
+    /**
+     * Ring buffer for data written by the CPU every frame, shared by all
+     * users in the current context.
+     *
+     * The buffer is split into StreamBuffer::Frames segments. Allocations
+     * are taken from the current segment and a fence is placed when the ring
+     * moves on, so a segment is only written again once the GPU has finished
+     * the draws that read it. With ARB_buffer_storage the buffer is mapped
+     * once with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT and written
+     * directly, otherwise writes go to a CPU copy and are sent with
+     * glBufferSubData in StreamBuffer::commit().
+     *
+     * GameBase calls StreamBuffer::endFrame() after each frame. When a frame
+     * writes more than a segment the ring moves on early, and only grows when
+     * every segment is already in use by the frame.
+     */
+    class StreamBuffer {
+    public:
+        /// Number of segments, frames in flight before a segment is reused
+        static constexpr size_t Frames = 3;
+
+        /**
+         * Memory returned by StreamBuffer::allocate().
+         */
+        struct Allocation {
+            /// Write pointer, valid until the segment is reused
+            uint8_t * data;
+            /// Buffer to bind for drawing
+            GLuint buffer;
+            /// Offset of data in buffer
+            GLintptr offset;
+            /// Size in bytes
+            GLsizeiptr size;
+            /// Segment counter when allocated, used by StreamBuffer::valid()
+            uint64_t segment;
+
+            Allocation();
+        };
+
+    private:
+        GLuint          buffer;
+        uint8_t *       mapped;
+        vector<uint8_t> shadow;
+        bool            persistent;
+        size_t          segmentSize;
+        size_t          head;
+        uint64_t        segment;
+        uint64_t        frame;
+        uint64_t        segmentFrames[Frames];
+        GLsync          fences[Frames];
+        vector<GLuint>  retired;
+
+        StreamBuffer();
+
+        /**
+         * Create the buffer with segments of size bytes. Allocations in the
+         * old buffer stay readable until the next StreamBuffer::endFrame().
+         */
+        void create(size_t size);
+
+        /**
+         * Fence the current segment and move to the next one, waiting for
+         * the GPU if it is still reading it.
+         */
+        void advance();
+
+    public:
+        StreamBuffer(const StreamBuffer &) = delete;
+        StreamBuffer & operator=(const StreamBuffer &) = delete;
+
+        /// The buffer belongs to the context and is released with it
+        ~StreamBuffer();
+
+        /**
+         * Get the StreamBuffer for the context that is current on this
+         * thread. The buffer is created on first use.
+         *
+         * @return the StreamBuffer
+         */
+        static StreamBuffer & current();
+
+        /**
+         * Reserve memory in the current segment.
+         *
+         * @param size the number of bytes
+         * @param alignment the required alignment of the offset, which does
+         *                  not have to be a power of two
+         *
+         * @return the allocation to write to
+         */
+        Allocation allocate(size_t size, size_t alignment = 16);
+
+        /**
+         * Make writes to an allocation visible to the GPU. This does nothing
+         * when the buffer is persistently mapped.
+         *
+         * @param allocation the allocation from StreamBuffer::allocate()
+         */
+        void commit(const Allocation & allocation);
+
+        /**
+         * Check if an allocation can still be drawn from. Data kept for
+         * several frames must be written again once this is false.
+         *
+         * @param allocation the allocation from StreamBuffer::allocate()
+         *
+         * @return true if the segment of allocation has not been reused
+         */
+        bool valid(const Allocation & allocation) const;
+
+        /**
+         * Get if the buffer is persistently mapped.
+         *
+         * @return false if writes are sent by StreamBuffer::commit()
+         */
+        bool isPersistent() const;
+
+        /**
+         * Finish the frame, fencing its segment. This is called by GameBase
+         * after GameBase::onDraw().
+         */
+        void endFrame();
+    };
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Material.hpp"
+
+namespace singe {
+    using std::map;
+    using std::shared_ptr;
+    using std::vector;
+
+    class Scene;
+
+    /**
+     * Pack Material textures into GL_TEXTURE_2D_ARRAY layers so materials
+     * share texture binds.
+     *
+     * Textures with the same size and internal format become layers of one
+     * array and keep repeating. The remaining textures no larger than the
+     * atlas threshold are packed into atlas layers, each surrounded by
+     * copies of its edge texels so filtering and mipmaps do not bleed.
+     * Atlas regions are clamped, uvs outside 0 to 1 wrap in the shader.
+     * Anything else, and compressed textures, are left alone as packing
+     * them would not save a bind.
+     *
+     * Add materials, call TextureArrays::build() once and keep the
+     * TextureArrays alive as long as the materials are drawn. The source
+     * textures are copied on the GPU and can be released afterwards.
+     */
+    class TextureArrays {
+    public:
+        using Ptr = shared_ptr<TextureArrays>;
+        using ConstPtr = const shared_ptr<TextureArrays>;
+
+        /**
+         * Counts from TextureArrays::build().
+         */
+        struct Stats {
+            /// Distinct source textures
+            size_t textures;
+            /// Textures that became a layer of an array
+            size_t layered;
+            /// Textures packed into an atlas
+            size_t atlased;
+            /// Array textures created, including atlases
+            size_t arrays;
+
+            Stats();
+        };
+
+    private:
+        /// A source texture read back from GL
+        struct Source {
+            const Texture * texture;
+            GLuint          name;
+            GLint           width;
+            GLint           height;
+            GLint           format;
+        };
+
+        GLsizei                            atlasSize;
+        GLsizei                            atlasThreshold;
+        vector<Material::Ptr>              materials;
+        vector<GLuint>                     arrays;
+        map<const Texture *, TextureLayer> layers;
+        Stats                              stats;
+
+        /**
+         * Create an array texture with storage for count layers.
+         */
+        GLuint createArray(GLint   format,
+                           GLsizei width,
+                           GLsizei height,
+                           GLsizei count,
+                           GLsizei levels);
+
+        /**
+         * Copy level 0 of a source into a region of an array layer, and
+         * repeat its edge texels over padding texels around the region.
+         */
+        void copy(const Source & source,
+                  GLuint         array,
+                  GLint          x,
+                  GLint          y,
+                  GLint          layer,
+                  GLint          padding);
+
+        /**
+         * Put each texture of a group with one size in its own layer.
+         */
+        void packLayers(const vector<Source> & group);
+
+        /**
+         * Pack textures of one format into atlas layers, tallest first on
+         * shelves.
+         */
+        void packAtlas(vector<Source> group);
+
+        void release();
+
+    public:
+        /**
+         * Create an empty TextureArrays.
+         *
+         * @param atlasSize the width and height of atlas layers
+         * @param atlasThreshold the largest texture size put in an atlas
+         */
+        TextureArrays(GLsizei atlasSize = 2048, GLsizei atlasThreshold = 256);
+
+        /// @brief  Move constructor
+        /// @param other Other TextureArrays to move fields from
+        TextureArrays(TextureArrays && other);
+
+        /// @brief Move operator
+        /// @param other Other TextureArrays to move fields from
+        /// @return This TextureArrays
+        TextureArrays & operator=(TextureArrays && other);
+
+        TextureArrays(const TextureArrays &) = delete;
+        TextureArrays & operator=(const TextureArrays &) = delete;
+
+        ~TextureArrays();
+
+        /**
+         * Add a material whose textures should be packed.
+         *
+         * @param material the material, updated by TextureArrays::build()
+         */
+        void add(const Material::Ptr & material);
+
+        /**
+         * Add the materials of every model and lod in a scene and its
+         * children.
+         *
+         * @param scene the scene
+         */
+        void add(const Scene & scene);
+
+        /**
+         * Pack the textures of all added materials and set their
+         * Material::layers. Arrays from an earlier build are released.
+         */
+        void build();
+
+        /**
+         * Get the counts from the last TextureArrays::build().
+         *
+         * @return the stats
+         */
+        const Stats & getStats() const;
+    };
+}
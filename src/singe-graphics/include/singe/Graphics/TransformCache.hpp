@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glpp/extra/Transform.hpp>
+
+namespace singe {
+    using glm::mat4;
+    using glpp::extra::Transform;
+
+    class TransformStore;
+
+    /**
+     * Cached local and world matrices for a Transform.
+     *
+     * Transform has no change notification, so the cache keeps a copy of the
+     * Transform it last converted and compares against it. The world matrix
+     * is only multiplied again when the Transform or the parent changed.
+     *
+     * Each new world matrix gets a version that is unique across all caches.
+     * Children pass their parent's version instead of comparing the parent
+     * matrix, so a change only costs work in the subtree below it.
+     *
+     * A cache bound to a TransformStore node returns the store's matrices
+     * and ignores the transform and parent passed to it. The binding is
+     * released when the cache is destroyed, see TransformStore::detach().
+     */
+    class TransformCache {
+        Transform              snapshot;
+        mat4                   local;
+        mat4                   parent;
+        mat4                   world;
+        uint64_t               parentVersion;
+        uint64_t               version;
+        bool                   localValid;
+        TransformStore *       store;
+        uint32_t               node;
+
+    public:
+        /// Version of a parent matrix that is not cached, the matrix is
+        /// compared by value instead
+        static constexpr uint64_t Unversioned = 0;
+
+        /**
+         * Create an empty cache. The first call to each getter will calculate
+         * the matrix.
+         */
+        TransformCache();
+
+        TransformCache(const TransformCache &) = delete;
+        TransformCache & operator=(const TransformCache &) = delete;
+
+        /// @brief Detach from the bound TransformStore node.
+        ~TransformCache();
+
+        /**
+         * Get transform as a matrix, converting only if transform changed.
+         *
+         * @param transform the current Transform
+         *
+         * @return the local matrix
+         */
+        const mat4 & getLocal(const Transform & transform);
+
+        /**
+         * Get parent * transform, multiplying only if either changed.
+         *
+         * @param transform the current Transform
+         * @param parent the parent's world matrix
+         * @param parentVersion the parent's version or Unversioned
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorld(const Transform & transform,
+                              const mat4 &      parent,
+                              uint64_t          parentVersion = Unversioned);
+
+        /**
+         * Get the version of the world matrix from the last
+         * TransformCache::getWorld(). This changes whenever the world matrix
+         * changes.
+         *
+         * @return the world version
+         */
+        uint64_t getVersion() const;
+
+        /**
+         * Force both matrices to be calculated on next use.
+         */
+        void invalidate();
+
+        /**
+         * Read matrices from a TransformStore node instead of calculating
+         * them. This is called by TransformStore::add().
+         *
+         * @param store the store, or nullptr to calculate again
+         * @param node the node in store
+         * @param transform the Transform the store reads for node
+         */
+        void bind(TransformStore *  store,
+                  uint32_t          node,
+                  const Transform & transform);
+
+        /**
+         * Take over the binding of other, which is left unbound. This is
+         * called by the Scene and Model move operations so the store reads
+         * the moved-to transform.
+         *
+         * @param other the cache of the moved-from Scene or Model
+         * @param transform the Transform of the moved-to Scene or Model
+         */
+        void takeBinding(TransformCache & other, const Transform & transform);
+
+        /**
+         * Get a new world version, unique across all caches and stores.
+         *
+         * @return the version
+         */
+        static uint64_t nextVersion();
+    };
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glpp/extra/Transform.hpp>
+#include <memory>
+#include <singe/Support/ThreadPool.hpp>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::quat;
+    using glm::vec3;
+    using glpp::extra::Transform;
+
+    struct Scene;
+    class Model;
+    class TransformCache;
+
+    /**
+     * Flat structure of arrays of transforms for large sets of moving nodes.
+     *
+     * Nodes are kept in level order, parents before children, with the
+     * parent index, local translation / rotation / scale, local matrix and
+     * world matrix each in their own array. TransformStore::update()
+     * calculates one level at a time, splitting each level across a
+     * ThreadPool and multiplying with SSE.
+     *
+     * Scenes and Models added to the store become views into it, their
+     * Scene::getWorldMatrix() and Model::getWorldMatrix() return the store's
+     * matrices. Their transform is read on each update. Nodes added without
+     * a Scene or Model use the translation, rotation and scale set with
+     * TransformStore::setTransform(), which avoids touching the scene graph
+     * at all.
+     *
+     * Each node keeps the version of its world matrix, which only changes
+     * when its transform or an ancestor changed, so Bvh::refit() skips
+     * bound models that did not move.
+     *
+     * Moving a bound Scene or Model moves its binding. Destroying one keeps
+     * its node, frozen at the last transform, until TransformStore::clear().
+     * Root nodes have no parent, the transform passed to Scene::draw() is
+     * not applied to a bound scene.
+     */
+    class TransformStore {
+    public:
+        using Ptr = shared_ptr<TransformStore>;
+        using ConstPtr = const shared_ptr<TransformStore>;
+
+        /// Parent of a root node
+        static constexpr uint32_t None = ~uint32_t(0);
+
+        /// Nodes in a chunk given to one thread
+        static constexpr size_t Grain = 512;
+
+    private:
+        // Per slot, in level order
+        vector<uint32_t>          parents;
+        vector<uint32_t>          levels;
+        vector<vec3>              positions;
+        vector<quat>              rotations;
+        vector<vec3>              scales;
+        vector<const Transform *> sources;
+        vector<TransformCache *>  caches;
+        vector<uint8_t>           detached;
+        vector<mat4>              locals;
+        vector<mat4>              worlds;
+        vector<uint64_t>          versions;
+        vector<uint32_t>          handles;
+
+        // Node handle to slot
+        vector<uint32_t> slots;
+        // First slot of each level, with size() at the end
+        vector<uint32_t> levelStarts;
+
+        uint64_t version;
+        bool     sorted;
+
+        uint32_t addNode(uint32_t parent);
+
+        void sort();
+
+    public:
+        /**
+         * Create an empty TransformStore.
+         */
+        TransformStore();
+
+        TransformStore(TransformStore && other) = delete;
+        TransformStore & operator=(TransformStore && other) = delete;
+
+        TransformStore(const TransformStore &) = delete;
+        TransformStore & operator=(const TransformStore &) = delete;
+
+        /// @brief Unbind all Scenes and Models.
+        ~TransformStore();
+
+        /**
+         * Add a node that is not part of a Scene.
+         *
+         * @param parent the parent node or TransformStore::None
+         * @param position the local translation
+         * @param rotation the local rotation
+         * @param scale the local scale
+         *
+         * @return the node handle, which stays valid until
+         *         TransformStore::clear()
+         */
+        uint32_t add(uint32_t     parent,
+                     const vec3 & position = vec3(0),
+                     const quat & rotation = quat(1, 0, 0, 0),
+                     const vec3 & scale = vec3(1));
+
+        /**
+         * Add scene, its models and all child scenes and bind them to the
+         * new nodes.
+         *
+         * @param scene the scene to add
+         * @param parent the parent node or TransformStore::None
+         *
+         * @return the node handle of scene
+         */
+        uint32_t add(const Scene & scene, uint32_t parent = None);
+
+        /**
+         * Add model and bind it to the new node.
+         *
+         * @param model the model to add
+         * @param parent the parent node or TransformStore::None
+         *
+         * @return the node handle of model
+         */
+        uint32_t add(const Model & model, uint32_t parent = None);
+
+        /**
+         * Remove all nodes and unbind all Scenes and Models.
+         */
+        void clear();
+
+        /**
+         * Get the number of nodes.
+         *
+         * @return the node count
+         */
+        size_t size() const;
+
+        /**
+         * Get the number of levels, the depth of the deepest node + 1.
+         *
+         * @return the level count after the last TransformStore::update()
+         */
+        size_t getLevelCount() const;
+
+        /**
+         * Set the local transform of a node that is not bound to a Scene or
+         * Model. This is applied on the next TransformStore::update().
+         *
+         * @param node the node handle
+         * @param position the local translation
+         * @param rotation the local rotation
+         * @param scale the local scale
+         */
+        void setTransform(uint32_t     node,
+                          const vec3 & position,
+                          const quat & rotation,
+                          const vec3 & scale = vec3(1));
+
+        /**
+         * Get the local matrix of a node.
+         *
+         * @param node the node handle
+         *
+         * @return the local matrix from the last TransformStore::update()
+         */
+        const mat4 & getLocal(uint32_t node) const;
+
+        /**
+         * Get the world matrix of a node.
+         *
+         * @param node the node handle
+         *
+         * @return the world matrix from the last TransformStore::update()
+         */
+        const mat4 & getWorld(uint32_t node) const;
+
+        /**
+         * Get the version of the last TransformStore::update().
+         *
+         * @return the store version
+         */
+        uint64_t getVersion() const;
+
+        /**
+         * Get the version of the world matrix of a node, this only changes
+         * when the matrix changed.
+         *
+         * @param node the node handle
+         *
+         * @return the world version
+         */
+        uint64_t getVersion(uint32_t node) const;
+
+        /**
+         * Read the local transform of node from transform and unbind the
+         * cache it was bound to before. This is called by
+         * TransformCache::bind().
+         *
+         * @param node the node handle
+         * @param cache the cache now bound to node
+         * @param transform the Transform to read on each update
+         */
+        void attach(uint32_t          node,
+                    TransformCache &  cache,
+                    const Transform & transform);
+
+        /**
+         * Stop reading the bound Transform of node, the node keeps its last
+         * local matrix. This is called when the bound cache is destroyed or
+         * bound elsewhere.
+         *
+         * @param node the node handle
+         */
+        void detach(uint32_t node);
+
+        /**
+         * Calculate every local and world matrix.
+         *
+         * @param pool the threads to split each level across
+         */
+        void update(ThreadPool & pool = ThreadPool::shared());
+    };
+}
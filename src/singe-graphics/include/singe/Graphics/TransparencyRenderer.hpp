@@ -0,0 +1,134 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <memory>
+
+#include "RenderQueue.hpp"
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+
+    struct Scene;
+
+    /**
+     * Weighted blended order independent transparency.
+     *
+     * Blended models are drawn in one unsorted pass into an accumulation
+     * target, the sum of premultiplied colour and alpha scaled by a depth
+     * weight, and a revealage target, the product of one minus each alpha.
+     * A composite pass then blends the weighted average colour over the
+     * framebuffer that was bound before TransparencyRenderer::begin(). The
+     * result does not depend on draw order, so RenderQueue can group the
+     * blended pass by state instead of sorting it back-to-front.
+     *
+     * The depth of the bound framebuffer is copied in first so opaque
+     * geometry hides transparent surfaces behind it, and is not written.
+     * The targets match the sample count and depth format of that
+     * framebuffer so the copy is a plain blit, and a multisampled target is
+     * resolved per sample in the composite pass.
+     *
+     * Revealage is blended separately from colour with glBlendFunci, which
+     * needs OpenGL 4.0 or ARB_draw_buffers_blend. Multisampled targets need
+     * OpenGL 3.2 or ARB_texture_multisample, without it transparent
+     * surfaces are only tested against each other.
+     *
+     * Material fragment shaders write the weighted colour to output 0 and
+     * alpha to output 1, see shader/transparent.frag. Material::alpha is
+     * available to them as `float materialAlpha`.
+     *
+     * The targets are sized to the viewport and created with GlUtil.
+     */
+    class TransparencyRenderer {
+    public:
+        using Ptr = shared_ptr<TransparencyRenderer>;
+        using ConstPtr = const shared_ptr<TransparencyRenderer>;
+
+    private:
+        GLint   viewport[4];
+        GLint   target;
+        GLint   sampledTarget;
+        bool    copyDepth;
+        bool    indexedBlend;
+        GLsizei samples;
+        GLenum  depthFormat;
+        GLsizei width;
+        GLsizei height;
+
+        GLuint transparencyBuffer;
+        GLuint accumTexture;
+        GLuint revealTexture;
+        GLuint depthBuffer;
+
+        GLuint compositeProgram;
+        GLuint emptyArray;
+
+        void setup();
+
+        void release();
+
+        void releaseTargets();
+
+        /**
+         * Match the sample count and depth format of a framebuffer, the
+         * targets are recreated on the next resize if they changed.
+         */
+        void match(GLint framebuffer);
+
+        /**
+         * Create the accumulation and revealage textures and the depth
+         * buffer.
+         */
+        void resize(GLsizei width, GLsizei height);
+
+    public:
+        TransparencyRenderer();
+
+        /// @brief  Move constructor
+        /// @param other Other TransparencyRenderer to move fields from
+        TransparencyRenderer(TransparencyRenderer && other);
+
+        /// @brief Move operator
+        /// @param other Other TransparencyRenderer to move fields from
+        /// @return This TransparencyRenderer
+        TransparencyRenderer & operator=(TransparencyRenderer && other);
+
+        TransparencyRenderer(const TransparencyRenderer &) = delete;
+        TransparencyRenderer &
+        operator=(const TransparencyRenderer &) = delete;
+
+        ~TransparencyRenderer();
+
+        /**
+         * Copy the depth of the bound framebuffer, then bind and clear the
+         * transparency targets. Blended geometry drawn until
+         * TransparencyRenderer::end() is accumulated. The targets are
+         * resized if the viewport changed and recreated if the bound
+         * framebuffer's sample count or depth format changed.
+         *
+         * Enables depth testing and blending and disables depth writes.
+         */
+        void begin();
+
+        /**
+         * Composite the accumulated geometry over the framebuffer bound
+         * before TransparencyRenderer::begin().
+         *
+         * Leaves depth testing, depth writes and face culling enabled, the
+         * polygon mode filled and blending set to
+         * `GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA`.
+         */
+        void end();
+
+        /**
+         * Draw the opaque models of a scene, then its blended models through
+         * the transparency targets in one unsorted pass.
+         *
+         * @param scene the scene to draw
+         * @param state the RenderState with the current global transform
+         * @param queue the RenderQueue used to sort models
+         */
+        void draw(const Scene & scene, RenderState state, RenderQueue & queue);
+    };
+}
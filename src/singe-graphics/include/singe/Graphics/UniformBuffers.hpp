@@ -0,0 +1,160 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "RenderState.hpp"
+
+namespace singe {
+    using std::vector;
+    using glm::mat4;
+    using glm::vec4;
+
+    /**
+     * std140 uniform buffers shared by all shaders of the current context.
+     *
+     * Per-frame camera data is a single block at UniformBuffers::FrameBinding
+     * which is only uploaded when it changes. Per-draw data is written to the
+     * StreamBuffer, many draws at once, and each draw binds its range to
+     * UniformBuffers::DrawBinding with glBindBufferRange.
+     *
+     * Shaders opt in by declaring the blocks below, Shader binds them to the
+     * binding points when it is created.
+     *
+     * ```glsl
+     * layout (std140) uniform Frame {
+     *     mat4 view;
+     *     mat4 projection;
+     *     mat4 viewProj;
+     *     vec4 cameraPos;
+     *     float time;
+     * };
+     *
+     * layout (std140) uniform Draw {
+     *     mat4 model;
+     *     mat4 mvp;
+     *     vec4 posOffset; // w is 1 for Model::Packed
+     *     vec4 posScale;
+     * };
+     * ```
+     */
+    class UniformBuffers {
+    public:
+        /// Binding point of the Frame block
+        static constexpr GLuint FrameBinding = 0;
+        /// Binding point of the Draw block
+        static constexpr GLuint DrawBinding = 1;
+
+        /// Name of the per-frame block in shaders
+        static constexpr const char * FrameBlock = "Frame";
+        /// Name of the per-draw block in shaders
+        static constexpr const char * DrawBlock = "Draw";
+
+        /// Layout of the Frame block
+        struct FrameData {
+            mat4  view;
+            mat4  projection;
+            mat4  viewProj;
+            vec4  cameraPos;
+            float time;
+            float padding[3];
+        };
+
+        /// Layout of the Draw block
+        struct DrawData {
+            mat4 model;
+            mat4 mvp;
+            vec4 posOffset;
+            vec4 posScale;
+        };
+
+    private:
+        GLuint          frameBuffer;
+        FrameData       frame;
+        bool            frameValid;
+        float           time;
+        GLuint          drawBuffer;
+        size_t          drawAlignment;
+        size_t          drawStride;
+        vector<uint8_t> staging;
+        size_t          stagedDraws;
+
+        void init();
+
+        UniformBuffers();
+
+    public:
+        UniformBuffers(const UniformBuffers &) = delete;
+        UniformBuffers & operator=(const UniformBuffers &) = delete;
+
+        /// The buffers belong to the context and are released with it
+        ~UniformBuffers();
+
+        /**
+         * Get the UniformBuffers for the context that is current on this
+         * thread. The buffers are created on first use.
+         *
+         * @return the UniformBuffers
+         */
+        static UniformBuffers & current();
+
+        /**
+         * Set the time sent in the Frame block. This is set by GameBase each
+         * frame.
+         *
+         * @param seconds the time since the game started
+         */
+        void setTime(float seconds);
+
+        /**
+         * Get the time sent in the Frame block.
+         *
+         * @return the time in seconds
+         */
+        float getTime() const;
+
+        /**
+         * Upload the camera transforms of state to the Frame block if they
+         * changed and bind it.
+         *
+         * @param state the RenderState with the camera transforms
+         */
+        void setFrame(const RenderState & state);
+
+        /**
+         * Get the distance between uploaded draws, sizeof(DrawData) rounded
+         * up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+         *
+         * @return the stride in bytes
+         */
+        size_t getDrawStride();
+
+        /**
+         * Stage the Draw block for state. Nothing is sent until
+         * UniformBuffers::uploadDraws().
+         *
+         * @param state the RenderState with model transform and vertex decode
+         *
+         * @return the index of the draw in this upload
+         */
+        size_t addDraw(const RenderState & state);
+
+        /**
+         * Copy all staged draws to the StreamBuffer in one allocation. The
+         * offsets are valid until the next upload.
+         *
+         * @return the offset of draw 0, draw i is at offset + i * stride
+         */
+        GLintptr uploadDraws();
+
+        /**
+         * Bind one draw's range to UniformBuffers::DrawBinding.
+         *
+         * @param offset the offset of the draw in the StreamBuffer
+         */
+        void bindDraw(GLintptr offset);
+    };
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <GL/glew.h>
+
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <glpp/Shader.hpp>
 #include <memory>
 
 namespace singe {
@@ -16,25 +18,46 @@ namespace singe {
     /**
      * Wrapper for a uniform added to a Shader.
      *
-     * This is an abstract base class with virtual send() method. This method is
-     * implemented by the derived class to send their value to the appropriate
-     * uniform type.
+     * Values are versioned so UniformExtra::send() only uploads after a
+     * change. Uploads use glProgramUniform where OpenGL 4.1 or
+     * ARB_separate_shader_objects is available, so the program does not have
+     * to be bound and every changed extra can be sent in one pass with
+     * Shader::sendExtras(). Otherwise the program is bound through
+     * StateCache for each upload.
+     *
+     * The upload is a function pointer set by TypedUniformExtra rather than
+     * a virtual method, so unchanged extras cost one compare.
      */
     class UniformExtra {
     public:
         using Ptr = shared_ptr<UniformExtra>;
         using ConstPtr = const shared_ptr<UniformExtra>;
 
+        /// Upload the value of extra to its program
+        using SendFunction = void (*)(const UniformExtra & extra);
+
     protected:
-        glpp::Uniform uniform;
+        GLuint               program;
+        GLint                location;
+        uint64_t             version;
+        uint64_t             sentVersion;
+        shared_ptr<uint64_t> programVersion;
+        SendFunction         sendFunction;
+
+        /**
+         * Mark the value as changed for this extra and its Shader.
+         */
+        void touch();
 
     public:
         /**
          * Create a new UniformExtra.
          *
-         * @param uniform the glpp::Uniform from the shader
+         * @param program the program name of the shader
+         * @param location the uniform location, -1 sends nothing
+         * @param sendFunction the function that uploads the value
          */
-        UniformExtra(glpp::Uniform uniform);
+        UniformExtra(GLuint program, GLint location, SendFunction sendFunction);
 
         /**
          * Virtual destructor.
@@ -42,249 +65,112 @@ namespace singe {
         virtual ~UniformExtra();
 
         /**
-         * Virtual method to be implemented by derived classes. This method
-         * will be called when a shader is bound to update it's uniforms.
-         */
-        virtual void send() const = 0;
-    };
-
-    /**
-     * UniformExtra of type bool
-     */
-    class BoolUniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<BoolUniformExtra>;
-        using ConstPtr = const shared_ptr<BoolUniformExtra>;
-
-        /// The uniform value
-        bool value;
-
-        /**
-         * Create a new BoolUniformExtra.
+         * Get the program the uniform belongs to.
          *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        BoolUniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
+         * @return the program name
          */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type int
-     */
-    class IntUniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<IntUniformExtra>;
-        using ConstPtr = const shared_ptr<IntUniformExtra>;
-
-        /// The uniform value
-        int value;
+        GLuint getProgram() const;
 
         /**
-         * Create a new IntUniformExtra.
+         * Get the uniform location.
          *
-         * @param uniform the glpp::Uniform from the shader
+         * @return the location, -1 if the uniform is not in the program
          */
-        IntUniformExtra(glpp::Uniform uniform);
+        GLint getLocation() const;
 
         /**
-         * Send the uniform to the shader.
-         */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type uint
-     */
-    class UIntUniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<UIntUniformExtra>;
-        using ConstPtr = const shared_ptr<UIntUniformExtra>;
-
-        /// The uniform value
-        unsigned int value;
-
-        /**
-         * Create a new UIntUniformExtra.
+         * Get the version of the value, incremented on every change.
          *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        UIntUniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
+         * @return the version
          */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type float
-     */
-    class FloatUniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<FloatUniformExtra>;
-        using ConstPtr = const shared_ptr<FloatUniformExtra>;
-
-        /// The uniform value
-        float value;
+        uint64_t getVersion() const;
 
         /**
-         * Create a new FloatUniformExtra.
+         * Check if the value has changed since it was last sent.
          *
-         * @param uniform the glpp::Uniform from the shader
+         * @return true if UniformExtra::send() would upload
          */
-        FloatUniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
-         */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type vec2
-     */
-    class Vec2UniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<Vec2UniformExtra>;
-        using ConstPtr = const shared_ptr<Vec2UniformExtra>;
-
-        /// The uniform value
-        vec2 value;
+        bool isDirty() const;
 
         /**
-         * Create a new Vec2UniformExtra.
+         * Share the change counter of a Shader. This is called by
+         * Shader::addExtra().
          *
-         * @param uniform the glpp::Uniform from the shader
+         * @param programVersion the counter incremented on every change
          */
-        Vec2UniformExtra(glpp::Uniform uniform);
+        void attach(shared_ptr<uint64_t> programVersion);
 
         /**
-         * Send the uniform to the shader.
+         * Upload the value if it has changed since it was last sent.
          */
-        void send() const override;
+        void send();
     };
 
     /**
-     * UniformExtra of type vec3
+     * UniformExtra holding a value of type T.
+     *
+     * Instantiated for bool, int, unsigned int, float, vec2, vec3, vec4,
+     * mat2, mat3 and mat4.
      */
-    class Vec3UniformExtra : public UniformExtra {
+    template <typename T>
+    class TypedUniformExtra : public UniformExtra {
     public:
-        using Ptr = shared_ptr<Vec3UniformExtra>;
-        using ConstPtr = const shared_ptr<Vec3UniformExtra>;
-
-        /// The uniform value
-        vec3 value;
+        using Ptr = shared_ptr<TypedUniformExtra<T>>;
+        using ConstPtr = const shared_ptr<TypedUniformExtra<T>>;
 
-        /**
-         * Create a new Vec3UniformExtra.
-         *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        Vec3UniformExtra(glpp::Uniform uniform);
+    private:
+        T value;
 
-        /**
-         * Send the uniform to the shader.
-         */
-        void send() const override;
-    };
+        static void sendValue(const UniformExtra & extra);
 
-    /**
-     * UniformExtra of type vec4
-     */
-    class Vec4UniformExtra : public UniformExtra {
     public:
-        using Ptr = shared_ptr<Vec4UniformExtra>;
-        using ConstPtr = const shared_ptr<Vec4UniformExtra>;
-
-        /// The uniform value
-        vec4 value;
-
         /**
-         * Create a new Vec4UniformExtra.
+         * Create a new TypedUniformExtra. Shader::addExtra() looks up the
+         * location by name.
          *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        Vec4UniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
+         * @param program the program name of the shader
+         * @param location the uniform location
+         * @param value the initial value
          */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type mat2
-     */
-    class Mat2UniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<Mat2UniformExtra>;
-        using ConstPtr = const shared_ptr<Mat2UniformExtra>;
-
-        /// The uniform value
-        mat2 value;
+        TypedUniformExtra(GLuint    program,
+                          GLint     location,
+                          const T & value = T(0));
 
         /**
-         * Create a new Mat2UniformExtra.
+         * Get the uniform value.
          *
-         * @param uniform the glpp::Uniform from the shader
+         * @return the value
          */
-        Mat2UniformExtra(glpp::Uniform uniform);
+        const T & get() const;
 
         /**
-         * Send the uniform to the shader.
-         */
-        void send() const override;
-    };
-
-    /**
-     * UniformExtra of type mat3
-     */
-    class Mat3UniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<Mat3UniformExtra>;
-        using ConstPtr = const shared_ptr<Mat3UniformExtra>;
-
-        /// The uniform value
-        mat3 value;
-
-        /**
-         * Create a new Mat3UniformExtra.
+         * Set the uniform value. The value is sent the next time the shader
+         * is bound, or by Shader::sendExtras(), only if it changed.
          *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        Mat3UniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
+         * @param value the new value
          */
-        void send() const override;
+        void set(const T & value);
     };
 
-    /**
-     * UniformExtra of type mat4
-     */
-    class Mat4UniformExtra : public UniformExtra {
-    public:
-        using Ptr = shared_ptr<Mat4UniformExtra>;
-        using ConstPtr = const shared_ptr<Mat4UniformExtra>;
-
-        /// The uniform value
-        mat4 value;
-
-        /**
-         * Create a new Mat4UniformExtra.
-         *
-         * @param uniform the glpp::Uniform from the shader
-         */
-        Mat4UniformExtra(glpp::Uniform uniform);
-
-        /**
-         * Send the uniform to the shader.
-         */
-        void send() const override;
-    };
+    extern template class TypedUniformExtra<bool>;
+    extern template class TypedUniformExtra<int>;
+    extern template class TypedUniformExtra<unsigned int>;
+    extern template class TypedUniformExtra<float>;
+    extern template class TypedUniformExtra<vec2>;
+    extern template class TypedUniformExtra<vec3>;
+    extern template class TypedUniformExtra<vec4>;
+    extern template class TypedUniformExtra<mat2>;
+    extern template class TypedUniformExtra<mat3>;
+    extern template class TypedUniformExtra<mat4>;
+
+    using BoolUniformExtra = TypedUniformExtra<bool>;
+    using IntUniformExtra = TypedUniformExtra<int>;
+    using UIntUniformExtra = TypedUniformExtra<unsigned int>;
+    using FloatUniformExtra = TypedUniformExtra<float>;
+    using Vec2UniformExtra = TypedUniformExtra<vec2>;
+    using Vec3UniformExtra = TypedUniformExtra<vec3>;
+    using Vec4UniformExtra = TypedUniformExtra<vec4>;
+    using Mat2UniformExtra = TypedUniformExtra<mat2>;
+    using Mat3UniformExtra = TypedUniformExtra<mat3>;
+    using Mat4UniformExtra = TypedUniformExtra<mat4>;
 }
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glpp/extra/Vertex.hpp>
+
+#include "Bounds.hpp"
+
+namespace singe {
+    using glm::vec3;
+    using glpp::extra::Vertex;
+
+    /// Vertex in the Model::Packed format
+    struct PackedVertex {
+        /// unorm16 position in the bounds, the last component is padding
+        uint16_t pos[4];
+        /// Octahedral snorm16 normal
+        int16_t  normal[2];
+        /// Half float uv
+        uint16_t uv[2];
+    };
+
+    static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+    /**
+     * Convert vertices to and from the Model::Packed format.
+     *
+     * Positions are stored relative to a box, so the error is at most half
+     * a step of 1/65535 of the box size on each axis. Normals are projected
+     * onto an octahedron, which keeps the angle error below 0.005 degrees.
+     * Uvs are half floats with 11 bits of precision.
+     */
+    class VertexPacker {
+        vec3 offset;
+        vec3 scale;
+        vec3 invScale;
+
+    public:
+        /**
+         * Create a packer for positions inside bounds.
+         *
+         * @param bounds the box containing every position to pack
+         */
+        VertexPacker(const AABB & bounds);
+
+        /**
+         * Get the position of the box minimum, decoded position is
+         * offset + pos * scale.
+         *
+         * @return the position offset
+         */
+        const vec3 & getOffset() const;
+
+        /**
+         * Get the size of the box.
+         *
+         * @return the position scale
+         */
+        const vec3 & getScale() const;
+
+        /**
+         * Encode a vertex.
+         *
+         * @param vertex the vertex, its position must be inside the bounds
+         *
+         * @return the packed vertex
+         */
+        PackedVertex pack(const Vertex & vertex) const;
+
+        /**
+         * Decode a vertex the same way the vertex shaders do.
+         *
+         * @param packed the packed vertex
+         *
+         * @return the decoded vertex
+         */
+        Vertex unpack(const PackedVertex & packed) const;
+    };
+}
@@ -0,0 +1,331 @@
+#include "singe/Graphics/Batch.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+
+    static Batch::MaterialData toMaterialData(const Material * material) {
+        Batch::MaterialData data;
+        if (!material) {
+            data.ambient = vec4(0, 0, 0, 1);
+            data.diffuse = vec4(1);
+            data.specular = vec4(0, 0, 0, 1);
+            return data;
+        }
+        data.ambient = vec4(material->ambient, 1);
+        data.diffuse = vec4(material->diffuse, material->alpha);
+        data.specular = vec4(material->specular, material->specExp);
+        return data;
+    }
+
+    Batch::Batch()
+        : vertexArray(0),
+          vertexBuffer(0),
+          indexBuffer(0),
+          drawIdBuffer(0),
+          commandBuffer(0),
+          drawDataBuffer(0),
+          materialBuffer(0),
+          drawCount(0),
+          built(false) {}
+
+    Batch::Batch(Batch && other)
+        : vertexArray(other.vertexArray),
+          vertexBuffer(other.vertexBuffer),
+          indexBuffer(other.indexBuffer),
+          drawIdBuffer(other.drawIdBuffer),
+          commandBuffer(other.commandBuffer),
+          drawDataBuffer(other.drawDataBuffer),
+          materialBuffer(other.materialBuffer),
+          vertices(move(other.vertices)),
+          indices(move(other.indices)),
+          buckets(move(other.buckets)),
+          materials(move(other.materials)),
+          drawCount(other.drawCount),
+          built(other.built),
+          materialIds(move(other.materialIds)) {
+        other.vertexArray = 0;
+        other.vertexBuffer = 0;
+        other.indexBuffer = 0;
+        other.drawIdBuffer = 0;
+        other.commandBuffer = 0;
+        other.drawDataBuffer = 0;
+        other.materialBuffer = 0;
+        other.built = false;
+    }
+
+    Batch & Batch::operator=(Batch && other) {
+        release();
+        vertexArray = other.vertexArray;
+        vertexBuffer = other.vertexBuffer;
+        indexBuffer = other.indexBuffer;
+        drawIdBuffer = other.drawIdBuffer;
+        commandBuffer = other.commandBuffer;
+        drawDataBuffer = other.drawDataBuffer;
+        materialBuffer = other.materialBuffer;
+        vertices = move(other.vertices);
+        indices = move(other.indices);
+        buckets = move(other.buckets);
+        materials = move(other.materials);
+        drawCount = other.drawCount;
+        built = other.built;
+        materialIds = move(other.materialIds);
+        other.vertexArray = 0;
+        other.vertexBuffer = 0;
+        other.indexBuffer = 0;
+        other.drawIdBuffer = 0;
+        other.commandBuffer = 0;
+        other.drawDataBuffer = 0;
+        other.materialBuffer = 0;
+        other.built = false;
+        return *this;
+    }
+
+    Batch::~Batch() {
+        release();
+    }
+
+    void Batch::release() {
+        if (vertexArray)
+            glDeleteVertexArrays(1, &vertexArray);
+        GLuint buffers[] = {vertexBuffer,  indexBuffer,    drawIdBuffer,
+                            commandBuffer, drawDataBuffer, materialBuffer};
+        glDeleteBuffers(6, buffers);
+        vertexArray = 0;
+        vertexBuffer = 0;
+        indexBuffer = 0;
+        drawIdBuffer = 0;
+        commandBuffer = 0;
+        drawDataBuffer = 0;
+        materialBuffer = 0;
+    }
+
+    Batch::Bucket & Batch::bucketFor(const Material::Ptr & material) {
+        const Shader * shader = material ? material->shader.get() : nullptr;
+        TextureSet     textures {};
+        if (material) {
+            for (size_t unit = 0; unit < textures.size(); unit++)
+                textures[unit] = material->boundTexture(unit);
+        }
+
+        // Layers and colours differ per draw, so materials only split
+        // buckets by what is bound
+        for (auto & bucket : buckets) {
+            if (bucket.shader == shader && bucket.textures == textures)
+                return bucket;
+        }
+        auto & bucket = buckets.emplace_back();
+        bucket.material = material;
+        bucket.shader = shader;
+        bucket.textures = textures;
+        bucket.offset = 0;
+        return bucket;
+    }
+
+    bool Batch::supported() {
+        return GLEW_VERSION_4_3
+            || (GLEW_ARB_shader_storage_buffer_object
+                && GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+    }
+
+    void Batch::clear() {
+        vertices.clear();
+        indices.clear();
+        buckets.clear();
+        materials.clear();
+        materialIds.clear();
+        drawCount = 0;
+        built = false;
+    }
+
+    void Batch::add(const Model & model, const mat4 & world) {
+        if (model.points.empty())
+            return;
+        if (model.material && model.material->texture
+            && !model.material->layers[0].array) {
+            Logging::Graphics->warning(
+                "Batch skipped a model, texture of material {} is not "
+                "packed by TextureArrays",
+                model.material->name);
+            return;
+        }
+
+        Bucket & bucket = bucketFor(model.material);
+
+        Command command;
+        command.count = model.indices.empty() ? model.points.size()
+                                              : model.indices.size();
+        command.instanceCount = 1;
+        command.firstIndex = indices.size();
+        command.baseVertex = vertices.size();
+        command.baseInstance = 0; // assigned in build()
+        bucket.commands.push_back(command);
+
+        DrawData data {};
+        data.world = world;
+        auto [entry, added] =
+            materialIds.emplace(model.material.get(), materialIds.size());
+        if (added)
+            materials.push_back(toMaterialData(model.material.get()));
+        data.material = entry->second;
+        TextureLayer layer;
+        if (model.material)
+            layer = model.material->layers[0];
+        data.rect = layer.rect;
+        data.layer = layer.layer;
+        bucket.draws.push_back(data);
+
+        if (model.indices.empty()) {
+            for (uint32_t i = 0; i < model.points.size(); i++) indices.push_back(i);
+        }
+        else {
+            indices.insert(indices.end(), model.indices.begin(),
+                           model.indices.end());
+        }
+        vertices.insert(vertices.end(), model.points.begin(), model.points.end());
+        drawCount++;
+        built = false;
+    }
+
+    void Batch::add(const Scene & scene, const mat4 & parent) {
+        const mat4 & world = scene.getWorldMatrix(parent);
+        for (auto & model : scene.models)
+            add(*model, model->getWorldMatrix(world, scene.getWorldVersion()));
+        for (auto & child : scene.children) add(*child, world);
+    }
+
+    void Batch::build() {
+        if (!supported()) {
+            Logging::Graphics->error(
+                "Batch needs OpenGL 4.3 or ARB_shader_storage_buffer_object, "
+                "ARB_multi_draw_indirect and ARB_base_instance");
+            return;
+        }
+
+        if (!vertexArray) {
+            glGenVertexArrays(1, &vertexArray);
+            glGenBuffers(1, &vertexBuffer);
+            glGenBuffers(1, &indexBuffer);
+            glGenBuffers(1, &drawIdBuffer);
+            glGenBuffers(1, &commandBuffer);
+            glGenBuffers(1, &drawDataBuffer);
+            glGenBuffers(1, &materialBuffer);
+        }
+
+        // Buckets are stored back to back so each is one contiguous range of
+        // commands. baseInstance is the draw id which is read by the shader
+        // through the instanced draw id attribute.
+        vector<Command>  commands;
+        vector<DrawData> draws;
+        commands.reserve(drawCount);
+        draws.reserve(drawCount);
+        for (auto & bucket : buckets) {
+            bucket.offset = commands.size();
+            for (size_t i = 0; i < bucket.commands.size(); i++) {
+                Command command = bucket.commands[i];
+                command.baseInstance = commands.size();
+                commands.push_back(command);
+                draws.push_back(bucket.draws[i]);
+            }
+        }
+
+        vector<GLuint> drawIds(drawCount);
+        std::iota(drawIds.begin(), drawIds.end(), 0);
+
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+                     vertices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (const void *)offsetof(Vertex, pos));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (const void *)offsetof(Vertex, norm));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                              (const void *)offsetof(Vertex, uv));
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t),
+                     indices.data(), GL_STATIC_DRAW);
+
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint),
+                     drawIds.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(DrawIdAttribute);
+        glVertexAttribIPointer(DrawIdAttribute, 1, GL_UNSIGNED_INT,
+                               sizeof(GLuint), nullptr);
+        glVertexAttribDivisor(DrawIdAttribute, 1);
+
+        cache.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(Command),
+                     commands.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(DrawData),
+                     draws.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,
+                     materials.size() * sizeof(MaterialData), materials.data(),
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        built = true;
+    }
+
+    size_t Batch::bucketCount() const {
+        return buckets.size();
+    }
+
+    size_t Batch::size() const {
+        return drawCount;
+    }
+
+    void Batch::draw(const RenderState & state) const {
+        if (!built || drawCount == 0)
+            return;
+
+        // World transforms come from DrawData so mvp is only view projection
+        RenderState batchState(state.getProjection(), state.getView(), mat4(1),
+                               mat4(1), state.getGridEnable());
+
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(vertexArray);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding,
+                         drawDataBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MaterialDataBinding,
+                         materialBuffer);
+
+        for (auto & bucket : buckets) {
+            // Every material in the bucket binds the same textures, their
+            // layers and colours are read from the storage buffers
+            if (bucket.material) {
+                bucket.material->bindTextures();
+                if (bucket.material->shader)
+                    bucket.material->shader->bind(batchState);
+            }
+
+            const void * offset =
+                (const void *)(bucket.offset * sizeof(Command));
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset,
+                                        bucket.commands.size(), 0);
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        cache.bindVertexArray(0);
+    }
+}
@@ -0,0 +1,83 @@
+#include "singe/Graphics/Bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace singe {
+    static constexpr float inf = std::numeric_limits<float>::infinity();
+
+    AABB::AABB() : min(inf), max(-inf) {}
+
+    AABB::AABB(const vec3 & min, const vec3 & max) : min(min), max(max) {}
+
+    bool AABB::empty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    vec3 AABB::center() const {
+        return (min + max) * 0.5f;
+    }
+
+    vec3 AABB::extent() const {
+        return (max - min) * 0.5f;
+    }
+
+    void AABB::expand(const vec3 & point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void AABB::expand(const AABB & other) {
+        if (other.empty())
+            return;
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool AABB::overlaps(const AABB & other) const {
+        return min.x <= other.max.x && max.x >= other.min.x
+               && min.y <= other.max.y && max.y >= other.min.y
+               && min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    bool AABB::contains(const AABB & other) const {
+        return min.x <= other.min.x && max.x >= other.max.x
+               && min.y <= other.min.y && max.y >= other.max.y
+               && min.z <= other.min.z && max.z >= other.max.z;
+    }
+
+    AABB AABB::transformed(const mat4 & matrix) const {
+        if (empty())
+            return AABB();
+
+        // Transform the center and project the extents onto the new axes
+        vec3 c = vec3(matrix * glm::vec4(center(), 1.0f));
+        vec3 e = extent();
+        vec3 r;
+        for (int i = 0; i < 3; i++) {
+            r[i] = std::abs(matrix[0][i]) * e.x + std::abs(matrix[1][i]) * e.y
+                   + std::abs(matrix[2][i]) * e.z;
+        }
+        return AABB(c - r, c + r);
+    }
+
+    BoundingSphere::BoundingSphere() : center(0), radius(0) {}
+
+    BoundingSphere::BoundingSphere(const vec3 & center, float radius)
+        : center(center), radius(radius) {}
+
+    BoundingSphere BoundingSphere::fromAABB(const AABB & box) {
+        if (box.empty())
+            return BoundingSphere();
+        return BoundingSphere(box.center(), glm::length(box.extent()));
+    }
+
+    BoundingSphere BoundingSphere::transformed(const mat4 & matrix) const {
+        vec3  c = vec3(matrix * glm::vec4(center, 1.0f));
+        float scale = std::max({glm::length(vec3(matrix[0])),
+                                glm::length(vec3(matrix[1])),
+                                glm::length(vec3(matrix[2]))});
+        return BoundingSphere(c, radius * scale);
+    }
+}
@@ -0,0 +1,571 @@
+#include "singe/Graphics/Bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+namespace singe {
+    using std::move;
+
+    /// Enough for any balanced tree, AVL height is below 1.45 log2(n)
+    static constexpr size_t kStackSize = 128;
+
+    static float surfaceArea(const AABB & box) {
+        vec3 d = box.max - box.min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+
+    static AABB merge(const AABB & a, const AABB & b) {
+        return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+
+    static bool overlaps(const AABB & box, const BoundingSphere & sphere) {
+        vec3 closest = glm::clamp(sphere.center, box.min, box.max);
+        vec3 d = closest - sphere.center;
+        return glm::dot(d, d) <= sphere.radius * sphere.radius;
+    }
+
+    /// Slab test, returns the entry distance or a negative value on a miss
+    static float rayHit(const AABB & box,
+                        const vec3 & origin,
+                        const vec3 & invDirection,
+                        float        maxDistance) {
+        vec3  t1 = (box.min - origin) * invDirection;
+        vec3  t2 = (box.max - origin) * invDirection;
+        vec3  tNear = glm::min(t1, t2);
+        vec3  tFar = glm::max(t1, t2);
+        float enter = std::max({tNear.x, tNear.y, tNear.z, 0.0f});
+        float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+        return enter <= exit ? enter : -1.0f;
+    }
+
+    bool Bvh::Node::isLeaf() const {
+        return child1 == Null;
+    }
+
+    Bvh::Bvh(float margin)
+        : root(Null), freeList(Null), proxyCount(0), margin(margin) {}
+
+    Bvh::Bvh(Bvh && other)
+        : nodes(move(other.nodes)),
+          leaves(move(other.leaves)),
+          sceneProxies(move(other.sceneProxies)),
+          root(other.root),
+          freeList(other.freeList),
+          proxyCount(other.proxyCount),
+          margin(other.margin) {
+        other.clear();
+    }
+
+    Bvh & Bvh::operator=(Bvh && other) {
+        nodes = move(other.nodes);
+        leaves = move(other.leaves);
+        sceneProxies = move(other.sceneProxies);
+        root = other.root;
+        freeList = other.freeList;
+        proxyCount = other.proxyCount;
+        margin = other.margin;
+        other.clear();
+        return *this;
+    }
+
+    Bvh::~Bvh() {}
+
+    void Bvh::clear() {
+        nodes.clear();
+        leaves.clear();
+        sceneProxies.clear();
+        root = Null;
+        freeList = Null;
+        proxyCount = 0;
+    }
+
+    size_t Bvh::size() const {
+        return proxyCount;
+    }
+
+    int32_t Bvh::getHeight() const {
+        return root == Null ? -1 : nodes[root].height;
+    }
+
+    int32_t Bvh::allocateNode() {
+        int32_t id;
+        if (freeList == Null) {
+            id = nodes.size();
+            nodes.emplace_back();
+            leaves.emplace_back();
+        }
+        else {
+            id = freeList;
+            freeList = nodes[id].parent;
+        }
+        Node & node = nodes[id];
+        node.box = AABB();
+        node.parent = Null;
+        node.child1 = Null;
+        node.child2 = Null;
+        node.height = 0;
+        leaves[id].model = nullptr;
+        return id;
+    }
+
+    void Bvh::freeNode(int32_t node) {
+        nodes[node].parent = freeList;
+        nodes[node].height = -1;
+        leaves[node].model = nullptr;
+        freeList = node;
+    }
+
+    AABB Bvh::fatten(const AABB & box) const {
+        vec3 pad = (box.max - box.min) * margin;
+        return AABB(box.min - pad, box.max + pad);
+    }
+
+    void Bvh::insertLeaf(int32_t leaf) {
+        if (root == Null) {
+            root = leaf;
+            nodes[root].parent = Null;
+            return;
+        }
+
+        // Find the best sibling with the surface area heuristic, descending
+        // while the cost of pushing the leaf down is lower than pairing here
+        AABB    leafBox = nodes[leaf].box;
+        int32_t index = root;
+        while (!nodes[index].isLeaf()) {
+            const Node & node = nodes[index];
+
+            float area = surfaceArea(node.box);
+            float combinedArea = surfaceArea(merge(node.box, leafBox));
+
+            float cost = 2.0f * combinedArea;
+            float inheritance = 2.0f * (combinedArea - area);
+
+            auto childCost = [&](int32_t child) {
+                const Node & c = nodes[child];
+                float        merged = surfaceArea(merge(c.box, leafBox));
+                if (c.isLeaf())
+                    return merged + inheritance;
+                return merged - surfaceArea(c.box) + inheritance;
+            };
+
+            float cost1 = childCost(node.child1);
+            float cost2 = childCost(node.child2);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        int32_t sibling = index;
+        int32_t oldParent = nodes[sibling].parent;
+        int32_t newParent = allocateNode();
+
+        nodes[newParent].parent = oldParent;
+        nodes[newParent].box = merge(leafBox, nodes[sibling].box);
+        nodes[newParent].height = nodes[sibling].height + 1;
+        nodes[newParent].child1 = sibling;
+        nodes[newParent].child2 = leaf;
+        nodes[sibling].parent = newParent;
+        nodes[leaf].parent = newParent;
+
+        if (oldParent != Null) {
+            if (nodes[oldParent].child1 == sibling)
+                nodes[oldParent].child1 = newParent;
+            else
+                nodes[oldParent].child2 = newParent;
+        }
+        else {
+            root = newParent;
+        }
+
+        // Refit and balance the ancestors
+        index = nodes[leaf].parent;
+        while (index != Null) {
+            index = balance(index);
+            Node & node = nodes[index];
+            node.height = 1 + std::max(nodes[node.child1].height,
+                                       nodes[node.child2].height);
+            node.box = merge(nodes[node.child1].box, nodes[node.child2].box);
+            index = node.parent;
+        }
+    }
+
+    void Bvh::removeLeaf(int32_t leaf) {
+        if (leaf == root) {
+            root = Null;
+            return;
+        }
+
+        int32_t parent = nodes[leaf].parent;
+        int32_t grandParent = nodes[parent].parent;
+        int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2
+                                                       : nodes[parent].child1;
+
+        freeNode(parent);
+
+        if (grandParent == Null) {
+            root = sibling;
+            nodes[sibling].parent = Null;
+            return;
+        }
+
+        if (nodes[grandParent].child1 == parent)
+            nodes[grandParent].child1 = sibling;
+        else
+            nodes[grandParent].child2 = sibling;
+        nodes[sibling].parent = grandParent;
+
+        int32_t index = grandParent;
+        while (index != Null) {
+            index = balance(index);
+            Node & node = nodes[index];
+            node.height = 1 + std::max(nodes[node.child1].height,
+                                       nodes[node.child2].height);
+            node.box = merge(nodes[node.child1].box, nodes[node.child2].box);
+            index = node.parent;
+        }
+    }
+
+    int32_t Bvh::balance(int32_t iA) {
+        Node & A = nodes[iA];
+        if (A.isLeaf() || A.height < 2)
+            return iA;
+
+        int32_t iB = A.child1;
+        int32_t iC = A.child2;
+        Node &  B = nodes[iB];
+        Node &  C = nodes[iC];
+
+        int32_t diff = C.height - B.height;
+
+        // Rotate C up
+        if (diff > 1) {
+            int32_t iF = C.child1;
+            int32_t iG = C.child2;
+            Node &  F = nodes[iF];
+            Node &  G = nodes[iG];
+
+            C.child1 = iA;
+            C.parent = A.parent;
+            A.parent = iC;
+
+            if (C.parent != Null) {
+                if (nodes[C.parent].child1 == iA)
+                    nodes[C.parent].child1 = iC;
+                else
+                    nodes[C.parent].child2 = iC;
+            }
+            else {
+                root = iC;
+            }
+
+            if (F.height > G.height) {
+                C.child2 = iF;
+                A.child2 = iG;
+                G.parent = iA;
+                A.box = merge(B.box, G.box);
+                C.box = merge(A.box, F.box);
+                A.height = 1 + std::max(B.height, G.height);
+                C.height = 1 + std::max(A.height, F.height);
+            }
+            else {
+                C.child2 = iG;
+                A.child2 = iF;
+                F.parent = iA;
+                A.box = merge(B.box, F.box);
+                C.box = merge(A.box, G.box);
+                A.height = 1 + std::max(B.height, F.height);
+                C.height = 1 + std::max(A.height, G.height);
+            }
+            return iC;
+        }
+
+        // Rotate B up
+        if (diff < -1) {
+            int32_t iD = B.child1;
+            int32_t iE = B.child2;
+            Node &  D = nodes[iD];
+            Node &  E = nodes[iE];
+
+            B.child1 = iA;
+            B.parent = A.parent;
+            A.parent = iB;
+
+            if (B.parent != Null) {
+                if (nodes[B.parent].child1 == iA)
+                    nodes[B.parent].child1 = iB;
+                else
+                    nodes[B.parent].child2 = iB;
+            }
+            else {
+                root = iB;
+            }
+
+            if (D.height > E.height) {
+                B.child2 = iD;
+                A.child1 = iE;
+                E.parent = iA;
+                A.box = merge(C.box, E.box);
+                B.box = merge(A.box, D.box);
+                A.height = 1 + std::max(C.height, E.height);
+                B.height = 1 + std::max(A.height, D.height);
+            }
+            else {
+                B.child2 = iE;
+                A.child1 = iD;
+                D.parent = iA;
+                A.box = merge(C.box, D.box);
+                B.box = merge(A.box, E.box);
+                A.height = 1 + std::max(C.height, D.height);
+                B.height = 1 + std::max(A.height, E.height);
+            }
+            return iB;
+        }
+
+        return iA;
+    }
+
+    int32_t Bvh::insert(const Model & model, const mat4 & world, const mat4 & local) {
+        int32_t proxy = allocateNode();
+        Leaf &  leaf = leaves[proxy];
+        leaf.model = &model;
+        leaf.bounds = model.getBounds().transformed(world);
+        leaf.world = world;
+        leaf.local = local;
+        leaf.version = TransformCache::Unversioned;
+        nodes[proxy].box = fatten(leaf.bounds);
+        insertLeaf(proxy);
+        proxyCount++;
+        return proxy;
+    }
+
+    bool Bvh::update(int32_t proxy, const mat4 & world, const mat4 & local) {
+        Leaf & leaf = leaves[proxy];
+        leaf.bounds = leaf.model->getBounds().transformed(world);
+        leaf.world = world;
+        leaf.local = local;
+
+        if (nodes[proxy].box.contains(leaf.bounds))
+            return false;
+
+        AABB fat = fatten(leaf.bounds);
+        removeLeaf(proxy);
+        nodes[proxy].box = fat;
+        insertLeaf(proxy);
+        return true;
+    }
+
+    void Bvh::remove(int32_t proxy) {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        proxyCount--;
+    }
+
+    void Bvh::buildScene(const Scene & scene,
+                         const mat4 &  parent,
+                         uint64_t      parentVersion) {
+        const mat4 & world = scene.getWorldMatrix(parent, parentVersion);
+        uint64_t     version = scene.getWorldVersion();
+        for (auto & model : scene.models) {
+            int32_t proxy = insert(*model, model->getWorldMatrix(world, version),
+                                   model->getLocalMatrix());
+            leaves[proxy].version = model->getWorldVersion();
+            sceneProxies.push_back(proxy);
+        }
+        for (auto & child : scene.children) buildScene(*child, world, version);
+    }
+
+    void Bvh::build(const Scene & scene, const mat4 & parent) {
+        clear();
+        buildScene(scene, parent, TransformCache::Unversioned);
+    }
+
+    bool Bvh::refitScene(const Scene & scene,
+                         const mat4 &  parent,
+                         uint64_t      parentVersion,
+                         size_t &      index,
+                         size_t &      moved) {
+        const mat4 & world = scene.getWorldMatrix(parent, parentVersion);
+        uint64_t     version = scene.getWorldVersion();
+        for (auto & model : scene.models) {
+            // The scene was changed, models are visited in build order
+            if (index >= sceneProxies.size()
+                || leaves[sceneProxies[index]].model != model.get())
+                return false;
+
+            // Skip models whose world matrix did not change
+            int32_t      proxy = sceneProxies[index++];
+            const mat4 & modelWorld = model->getWorldMatrix(world, version);
+            if (leaves[proxy].version == model->getWorldVersion())
+                continue;
+            if (update(proxy, modelWorld, model->getLocalMatrix()))
+                moved++;
+            leaves[proxy].version = model->getWorldVersion();
+        }
+        for (auto & child : scene.children) {
+            if (!refitScene(*child, world, version, index, moved))
+                return false;
+        }
+        return true;
+    }
+
+    size_t Bvh::refit(const Scene & scene, const mat4 & parent) {
+        size_t index = 0;
+        size_t moved = 0;
+        if (!refitScene(scene, parent, TransformCache::Unversioned, index,
+                        moved)
+            || index != sceneProxies.size()) {
+            build(scene, parent);
+            return proxyCount;
+        }
+        return moved;
+    }
+
+    const Model * Bvh::getModel(int32_t proxy) const {
+        return leaves[proxy].model;
+    }
+
+    const AABB & Bvh::getBounds(int32_t proxy) const {
+        return leaves[proxy].bounds;
+    }
+
+    const mat4 & Bvh::getWorld(int32_t proxy) const {
+        return leaves[proxy].world;
+    }
+
+    void Bvh::query(const AABB & box, vector<int32_t> & out) const {
+        if (root == Null)
+            return;
+
+        int32_t stack[kStackSize];
+        size_t  top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            const Node & node = nodes[stack[--top]];
+            if (!node.box.overlaps(box))
+                continue;
+            if (node.isLeaf()) {
+                int32_t id = &node - nodes.data();
+                if (leaves[id].bounds.overlaps(box))
+                    out.push_back(id);
+            }
+            else {
+                stack[top++] = node.child1;
+                stack[top++] = node.child2;
+            }
+        }
+    }
+
+    void Bvh::query(const BoundingSphere & sphere, vector<int32_t> & out) const {
+        if (root == Null)
+            return;
+
+        int32_t stack[kStackSize];
+        size_t  top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            const Node & node = nodes[stack[--top]];
+            if (!overlaps(node.box, sphere))
+                continue;
+            if (node.isLeaf()) {
+                int32_t id = &node - nodes.data();
+                if (overlaps(leaves[id].bounds, sphere))
+                    out.push_back(id);
+            }
+            else {
+                stack[top++] = node.child1;
+                stack[top++] = node.child2;
+            }
+        }
+    }
+
+    void Bvh::query(const Frustum & frustum, vector<int32_t> & out) const {
+        if (root == Null)
+            return;
+
+        // The second value is set when the parent is fully inside
+        struct Entry {
+            int32_t node;
+            bool    inside;
+        };
+
+        Entry  stack[kStackSize];
+        size_t top = 0;
+        stack[top++] = {root, false};
+        while (top > 0) {
+            Entry        entry = stack[--top];
+            const Node & node = nodes[entry.node];
+
+            bool inside = entry.inside;
+            if (!inside) {
+                auto result = frustum.classify(node.box);
+                if (result == Frustum::Outside)
+                    continue;
+                inside = result == Frustum::Inside;
+            }
+
+            if (node.isLeaf()) {
+                if (inside || frustum.intersects(leaves[entry.node].bounds))
+                    out.push_back(entry.node);
+            }
+            else {
+                stack[top++] = {node.child1, inside};
+                stack[top++] = {node.child2, inside};
+            }
+        }
+    }
+
+    int32_t Bvh::raycast(const vec3 & origin,
+                         const vec3 & direction,
+                         float        maxDistance,
+                         float *      distance) const {
+        if (root == Null)
+            return Null;
+
+        vec3    invDirection = 1.0f / direction;
+        int32_t best = Null;
+        float   bestDistance = maxDistance;
+
+        int32_t stack[kStackSize];
+        size_t  top = 0;
+        stack[top++] = root;
+        while (top > 0) {
+            int32_t      id = stack[--top];
+            const Node & node = nodes[id];
+
+            // Nodes further than the current best hit are skipped
+            if (rayHit(node.box, origin, invDirection, bestDistance) < 0)
+                continue;
+
+            if (node.isLeaf()) {
+                float t = rayHit(leaves[id].bounds, origin, invDirection,
+                                 bestDistance);
+                if (t >= 0) {
+                    best = id;
+                    bestDistance = t;
+                }
+            }
+            else {
+                stack[top++] = node.child1;
+                stack[top++] = node.child2;
+            }
+        }
+
+        if (distance && best != Null)
+            *distance = bestDistance;
+        return best;
+    }
+
+    void Bvh::enqueue(RenderQueue & queue, const RenderState & state) const {
+        thread_local vector<int32_t> visible;
+        visible.clear();
+        query(state.getFrustum(), visible);
+
+        for (int32_t proxy : visible) {
+            const Leaf & leaf = leaves[proxy];
+            queue.push(*leaf.model, leaf.world, leaf.local, state.getView());
+        }
+        queue.addCulled(proxyCount - visible.size());
+    }
+}
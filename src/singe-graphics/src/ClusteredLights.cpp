@@ -0,0 +1,357 @@
+#include "singe/Graphics/ClusteredLights.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/ShaderBindings.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using glm::vec2;
+
+    static const bool kBindingsRegistered =
+        ShaderBindings::addBlock(ClusteredLights::ClusterBlock,
+                                 ClusteredLights::ClusterBinding)
+        && ShaderBindings::addSampler(ClusteredLights::LightsSampler,
+                                      ClusteredLights::LightsUnit)
+        && ShaderBindings::addSampler(ClusteredLights::GridSampler,
+                                      ClusteredLights::GridUnit)
+        && ShaderBindings::addSampler(ClusteredLights::IndexSampler,
+                                      ClusteredLights::IndexUnit);
+
+    static bool intersects(const AABB & box,
+                           const vec3 & center,
+                           float        radius) {
+        vec3 offset = glm::clamp(center, box.min, box.max) - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    ClusteredLights::Stats::Stats()
+        : lights(0), indices(0), activeClusters(0), maxPerCluster(0) {}
+
+    ClusteredLights::ClusteredLights(GLuint tilesX,
+                                     GLuint tilesY,
+                                     GLuint slices)
+        : tilesX(std::max(tilesX, 1u)),
+          tilesY(std::max(tilesY, 1u)),
+          slices(std::max(slices, 1u)),
+          projection(0),
+          viewportWidth(0),
+          viewportHeight(0),
+          zNear(0),
+          zFar(0),
+          sliceScale(0),
+          block(),
+          blockBuffer(0),
+          lightBuffer(0),
+          lightTexture(0),
+          gridBuffer(0),
+          gridTexture(0),
+          indexBuffer(0),
+          indexTexture(0),
+          ambient(0.1f) {
+        size_t clusters = size_t(this->tilesX) * this->tilesY * this->slices;
+        bounds.resize(clusters);
+        grid.resize(clusters);
+        sliceIndices.resize(this->slices);
+    }
+
+    ClusteredLights::ClusteredLights(ClusteredLights && other)
+        : ClusteredLights(other.tilesX, other.tilesY, other.slices) {
+        *this = move(other);
+    }
+
+    ClusteredLights & ClusteredLights::operator=(ClusteredLights && other) {
+        release();
+        tilesX = other.tilesX;
+        tilesY = other.tilesY;
+        slices = other.slices;
+        projection = other.projection;
+        viewportWidth = other.viewportWidth;
+        viewportHeight = other.viewportHeight;
+        zNear = other.zNear;
+        zFar = other.zFar;
+        sliceScale = other.sliceScale;
+        bounds = move(other.bounds);
+        grid = move(other.grid);
+        sliceIndices = move(other.sliceIndices);
+        indices = move(other.indices);
+        viewLights = move(other.viewLights);
+        lightData = move(other.lightData);
+        sceneLights = move(other.sceneLights);
+        block = other.block;
+        stats = other.stats;
+        blockBuffer = other.blockBuffer;
+        lightBuffer = other.lightBuffer;
+        lightTexture = other.lightTexture;
+        gridBuffer = other.gridBuffer;
+        gridTexture = other.gridTexture;
+        indexBuffer = other.indexBuffer;
+        indexTexture = other.indexTexture;
+        ambient = other.ambient;
+
+        other.blockBuffer = 0;
+        other.lightBuffer = 0;
+        other.lightTexture = 0;
+        other.gridBuffer = 0;
+        other.gridTexture = 0;
+        other.indexBuffer = 0;
+        other.indexTexture = 0;
+        return *this;
+    }
+
+    ClusteredLights::~ClusteredLights() {
+        release();
+    }
+
+    void ClusteredLights::release() {
+        GLuint buffers[] = {blockBuffer, lightBuffer, gridBuffer, indexBuffer};
+        for (auto buffer : buffers) {
+            if (buffer)
+                glDeleteBuffers(1, &buffer);
+        }
+        GLuint textures[] = {lightTexture, gridTexture, indexTexture};
+        for (auto texture : textures) {
+            if (texture)
+                glDeleteTextures(1, &texture);
+        }
+        if (lightTexture)
+            StateCache::current().invalidateBindings();
+
+        blockBuffer = 0;
+        lightBuffer = 0;
+        lightTexture = 0;
+        gridBuffer = 0;
+        gridTexture = 0;
+        indexBuffer = 0;
+        indexTexture = 0;
+    }
+
+    static void createTextureBuffer(GLuint   unit,
+                                    GLenum   format,
+                                    GLuint & buffer,
+                                    GLuint & texture) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+        glGenTextures(1, &texture);
+        StateCache::current().bindTexture(unit, GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    }
+
+    void ClusteredLights::setup() {
+        glGenBuffers(1, &blockBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, blockBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterData), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        createTextureBuffer(LightsUnit, GL_RGBA32F, lightBuffer, lightTexture);
+        createTextureBuffer(GridUnit, GL_RG32UI, gridBuffer, gridTexture);
+        createTextureBuffer(IndexUnit, GL_R32UI, indexBuffer, indexTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void ClusteredLights::updateBounds(const mat4 & projection,
+                                       GLint        width,
+                                       GLint        height) {
+        if (projection == this->projection && width == viewportWidth
+            && height == viewportHeight)
+            return;
+        this->projection = projection;
+        viewportWidth = width;
+        viewportHeight = height;
+
+        if (projection[2][3] == 0)
+            Logging::Graphics->warning(
+                "ClusteredLights only supports perspective projections");
+
+        // Planes of a glm::perspective projection
+        zNear = projection[3][2] / (projection[2][2] - 1);
+        zFar = projection[3][2] / (projection[2][2] + 1);
+        sliceScale = slices / std::log(zFar / zNear);
+
+        // A point at ndc (x, y) and view depth d is at
+        // d * (ndc + offset) / scale on each axis
+        vec2 scale(projection[0][0], projection[1][1]);
+        vec2 offset(projection[2][0], projection[2][1]);
+        for (GLuint slice = 0; slice < slices; slice++) {
+            float depths[] = {
+                zNear * std::pow(zFar / zNear, float(slice) / slices),
+                zNear * std::pow(zFar / zNear, float(slice + 1) / slices)};
+            for (GLuint y = 0; y < tilesY; y++) {
+                for (GLuint x = 0; x < tilesX; x++) {
+                    vec2 ndcMin(-1 + 2.0f * x / tilesX,
+                                -1 + 2.0f * y / tilesY);
+                    vec2 ndcMax(-1 + 2.0f * (x + 1) / tilesX,
+                                -1 + 2.0f * (y + 1) / tilesY);
+
+                    AABB box(vec3(INFINITY), vec3(-INFINITY));
+                    for (float depth : depths) {
+                        vec2 a = depth * (ndcMin + offset) / scale;
+                        vec2 b = depth * (ndcMax + offset) / scale;
+                        box.min =
+                            glm::min(box.min, vec3(glm::min(a, b), -depth));
+                        box.max =
+                            glm::max(box.max, vec3(glm::max(a, b), -depth));
+                    }
+                    bounds[(size_t(slice) * tilesY + y) * tilesX + x] = box;
+                }
+            }
+        }
+
+        block.scale = vec4(float(width) / tilesX, float(height) / tilesY,
+                           zNear, sliceScale);
+    }
+
+    uint32_t ClusteredLights::sliceOf(float depth) const {
+        if (depth <= zNear)
+            return 0;
+        float slice = std::log(depth / zNear) * sliceScale;
+        return std::min(uint32_t(slice), slices - 1);
+    }
+
+    void ClusteredLights::binSlice(uint32_t slice) {
+        // Lights are tested against every tile of the slices they reach,
+        // the lists of one slice are built by one thread
+        thread_local vector<uint32_t> candidates;
+        candidates.clear();
+        for (uint32_t i = 0; i < viewLights.size(); i++) {
+            if (viewLights[i].firstSlice <= slice
+                && slice <= viewLights[i].lastSlice)
+                candidates.push_back(i);
+        }
+
+        auto & list = sliceIndices[slice];
+        list.clear();
+        size_t first = size_t(slice) * tilesX * tilesY;
+        size_t last = first + size_t(tilesX) * tilesY;
+        for (size_t cluster = first; cluster < last; cluster++) {
+            uint32_t offset = list.size();
+            for (auto i : candidates) {
+                if (intersects(bounds[cluster], viewLights[i].center,
+                               viewLights[i].radius))
+                    list.push_back(i);
+            }
+            grid[cluster] = uvec2(offset, list.size() - offset);
+        }
+    }
+
+    void ClusteredLights::upload() {
+        glBindBuffer(GL_UNIFORM_BUFFER, blockBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClusterData), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        // Orphan the buffers so the draws of the last frame can still read
+        // the old lists
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER,
+                     std::max<size_t>(lightData.size(), 1) * sizeof(vec4),
+                     lightData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, gridBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, grid.size() * sizeof(uvec2),
+                     grid.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        glBufferData(GL_TEXTURE_BUFFER,
+                     std::max<size_t>(indices.size(), 1) * sizeof(uint32_t),
+                     indices.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void ClusteredLights::update(const RenderState &   state,
+                                 const vector<Light> & lights,
+                                 ThreadPool &          pool) {
+        if (!blockBuffer)
+            setup();
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        updateBounds(state.getProjection(), viewport[2], viewport[3]);
+
+        stats = Stats();
+        viewLights.clear();
+        lightData.clear();
+
+        const mat4 & view = state.getView();
+        GLuint       directional = 0;
+        for (auto & light : lights) {
+            if (light.type == Light::Directional) {
+                if (directional == MaxDirectional)
+                    continue;
+                block.directions[directional] =
+                    vec4(glm::normalize(light.direction), 0);
+                block.colors[directional] =
+                    vec4(light.color * light.intensity, 0);
+                directional++;
+                continue;
+            }
+            if (light.radius <= 0 || light.intensity <= 0)
+                continue;
+
+            vec3  center = vec3(view * vec4(light.position, 1));
+            float nearest = -center.z - light.radius;
+            float farthest = -center.z + light.radius;
+            if (farthest < zNear || nearest > zFar)
+                continue;
+
+            viewLights.push_back({center, light.radius, sliceOf(nearest),
+                                  sliceOf(farthest)});
+            lightData.push_back(vec4(light.position, light.radius));
+            lightData.push_back(vec4(light.color * light.intensity, 0));
+        }
+        block.counts = uvec4(tilesX, tilesY, slices, directional);
+        block.ambient = vec4(ambient, 0);
+
+        pool.parallelFor(slices, 1, [this](size_t begin, size_t end) {
+            for (size_t slice = begin; slice < end; slice++) binSlice(slice);
+        });
+
+        // Join the slice lists, offsets were relative to their slice
+        indices.clear();
+        size_t perSlice = size_t(tilesX) * tilesY;
+        for (GLuint slice = 0; slice < slices; slice++) {
+            uint32_t base = indices.size();
+            for (size_t i = 0; i < perSlice; i++) {
+                auto & cluster = grid[slice * perSlice + i];
+                cluster.x += base;
+                if (cluster.y) {
+                    stats.activeClusters++;
+                    stats.maxPerCluster =
+                        std::max<size_t>(stats.maxPerCluster, cluster.y);
+                }
+            }
+            indices.insert(indices.end(), sliceIndices[slice].begin(),
+                           sliceIndices[slice].end());
+        }
+        stats.lights = viewLights.size();
+        stats.indices = indices.size();
+
+        upload();
+    }
+
+    void ClusteredLights::bind() const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, ClusterBinding, blockBuffer);
+        auto & cache = StateCache::current();
+        cache.bindTexture(LightsUnit, GL_TEXTURE_BUFFER, lightTexture);
+        cache.bindTexture(GridUnit, GL_TEXTURE_BUFFER, gridTexture);
+        cache.bindTexture(IndexUnit, GL_TEXTURE_BUFFER, indexTexture);
+    }
+
+    void ClusteredLights::draw(const Scene & scene,
+                               RenderState   state,
+                               RenderQueue & queue) {
+        sceneLights.clear();
+        scene.collectLights(sceneLights, state.getModel());
+        update(state, sceneLights);
+        bind();
+        scene.draw(state, queue);
+    }
+
+    const ClusteredLights::Stats & ClusteredLights::getStats() const {
+        return stats;
+    }
+}
@@ -0,0 +1,132 @@
+#include "singe/Graphics/DebugLines.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/StreamBuffer.hpp"
+
+namespace singe {
+    static const char * kVertexSource = R"(#version 330 core
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec4 color;
+uniform mat4 mvp;
+out vec4 lineColor;
+void main() {
+    lineColor = color;
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+
+    static const char * kFragmentSource = R"(#version 330 core
+in vec4 lineColor;
+out vec4 color;
+void main() {
+    color = lineColor;
+}
+)";
+
+    DebugLines::DebugLines() : program(0), mvpLocation(-1), vertexArray(0) {}
+
+    DebugLines::DebugLines(DebugLines && other)
+        : points(std::move(other.points)),
+          program(other.program),
+          mvpLocation(other.mvpLocation),
+          vertexArray(other.vertexArray) {
+        other.program = 0;
+        other.vertexArray = 0;
+    }
+
+    DebugLines & DebugLines::operator=(DebugLines && other) {
+        release();
+        points = std::move(other.points);
+        program = other.program;
+        mvpLocation = other.mvpLocation;
+        vertexArray = other.vertexArray;
+        other.program = 0;
+        other.vertexArray = 0;
+        return *this;
+    }
+
+    DebugLines::~DebugLines() {
+        release();
+    }
+
+    void DebugLines::release() {
+        if (program)
+            glDeleteProgram(program);
+        if (vertexArray)
+            glDeleteVertexArrays(1, &vertexArray);
+        program = 0;
+        vertexArray = 0;
+    }
+
+    void DebugLines::setup() {
+        program = GlUtil::linkProgram(kVertexSource, kFragmentSource, "Line");
+        mvpLocation = glGetUniformLocation(program, "mvp");
+
+        glGenVertexArrays(1, &vertexArray);
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(vertexArray);
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        cache.bindVertexArray(0);
+    }
+
+    void DebugLines::add(const vec3 & from, const vec3 & to, const vec4 & color) {
+        points.push_back({from, color});
+        points.push_back({to, color});
+    }
+
+    void DebugLines::addStrip(const vector<vec3> & strip,
+                              const vec4 &         color,
+                              bool                 closed) {
+        for (size_t i = 1; i < strip.size(); i++)
+            add(strip[i - 1], strip[i], color);
+        if (closed && strip.size() > 2)
+            add(strip.back(), strip.front(), color);
+    }
+
+    size_t DebugLines::size() const {
+        return points.size() / 2;
+    }
+
+    void DebugLines::clear() {
+        points.clear();
+    }
+
+    void DebugLines::draw(const mat4 & mvp) {
+        if (points.empty())
+            return;
+        if (!program)
+            setup();
+
+        auto & stream = StreamBuffer::current();
+        size_t bytes = points.size() * sizeof(Point);
+        auto   allocation = stream.allocate(bytes, sizeof(Point));
+        std::memcpy(allocation.data, points.data(), bytes);
+        stream.commit(allocation);
+
+        // The allocation moves around the ring so the attributes are set
+        // for every draw
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+        glVertexAttribPointer(
+            0, 3, GL_FLOAT, GL_FALSE, sizeof(Point),
+            (const void *)(allocation.offset + offsetof(Point, pos)));
+        glVertexAttribPointer(
+            1, 4, GL_FLOAT, GL_FALSE, sizeof(Point),
+            (const void *)(allocation.offset + offsetof(Point, color)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        cache.useProgram(program);
+        glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, glm::value_ptr(mvp));
+        glDrawArrays(GL_LINES, 0, points.size());
+        cache.bindVertexArray(0);
+
+        points.clear();
+    }
+}
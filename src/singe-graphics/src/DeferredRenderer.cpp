@@ -0,0 +1,584 @@
+#include "singe/Graphics/DeferredRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+#include <map>
+#include <singe/Support/log.hpp>
+#include <utility>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/StreamBuffer.hpp"
+
+namespace singe {
+    using std::move;
+
+    /// Faces of the light volume sit inside the unit sphere, at worst at
+    /// 0.934, push them out so the volume covers the whole radius
+    static constexpr float kVolumeScale = 1.1f;
+
+    static const GLfloat kClearZero[] = {0, 0, 0, 0};
+
+    static const char * kDirectionalFragmentSource = R"(#version 330 core
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform vec3 ambient;
+uniform int lightCount;
+// Sized to DeferredRenderer::MaxDirectional
+uniform vec3 lightDirections[4];
+uniform vec3 lightColors[4];
+in vec2 uv;
+out vec4 color;
+void main() {
+    vec4 normal = texture(gNormal, uv);
+    if (normal.w == 0.0)
+        discard;
+    vec3 n = normalize(normal.xyz);
+    vec3 light = ambient;
+    for (int i = 0; i < lightCount; i++)
+        light += lightColors[i] * max(dot(n, -lightDirections[i]), 0.0);
+    color = vec4(texture(gAlbedo, uv).rgb * light, 1.0);
+}
+)";
+
+    static const char * kPointVertexSource = R"(#version 330 core
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec4 positionRadius;
+layout(location = 2) in vec4 lightColor;
+uniform mat4 viewProj;
+flat out vec4 light;
+flat out vec3 color;
+void main() {
+    light = positionRadius;
+    color = lightColor.rgb;
+    vec3 world = positionRadius.xyz + pos * positionRadius.w;
+    gl_Position = viewProj * vec4(world, 1.0);
+}
+)";
+
+    static const char * kPointFragmentSource = R"(#version 330 core
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProj;
+uniform vec3 cameraPos;
+uniform vec2 screenSize;
+flat in vec4 light;
+flat in vec3 color;
+out vec4 outColor;
+void main() {
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    vec4 normal = texture(gNormal, uv);
+    if (normal.w == 0.0)
+        discard;
+
+    vec4 clip = vec4(uv, texture(gDepth, uv).r, 1.0) * 2.0 - 1.0;
+    vec4 world = inverseViewProj * clip;
+    vec3 position = world.xyz / world.w;
+
+    vec3 toLight = light.xyz - position;
+    float dist = length(toLight);
+    if (dist >= light.w)
+        discard;
+
+    // Inverse square with a window so the light reaches 0 at the radius
+    float fade = clamp(1.0 - pow(dist / light.w, 4.0), 0.0, 1.0);
+    float attenuation = fade * fade / (dist * dist + 1.0);
+
+    vec3 n = normalize(normal.xyz);
+    vec3 l = toLight / dist;
+    vec3 h = normalize(l + normalize(cameraPos - position));
+    float diffuse = max(dot(n, l), 0.0);
+    float specular = 0.0;
+    if (diffuse > 0.0)
+        specular = pow(max(dot(n, h), 0.0), 32.0) * 0.25;
+
+    vec3 albedo = texture(gAlbedo, uv).rgb;
+    outColor = vec4((albedo * diffuse + specular) * color * attenuation, 0.0);
+}
+)";
+
+    static const char * kCompositeFragmentSource = R"(#version 330 core
+uniform sampler2D lightTexture;
+uniform sampler2D gDepth;
+in vec2 uv;
+out vec4 color;
+void main() {
+    vec4 light = texture(lightTexture, uv);
+    // Alpha is only set where the geometry pass drew something
+    if (light.a == 0.0)
+        discard;
+    color = vec4(light.rgb, 1.0);
+    // Depth can not be blitted into a multisampled framebuffer
+    gl_FragDepth = texture(gDepth, uv).r;
+}
+)";
+
+    /// Icosahedron split once, 80 faces wound counter clockwise outwards
+    static void buildVolume(vector<vec3> & points, vector<GLushort> & indices) {
+        const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+        points = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+                  {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+                  {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+        for (auto & point : points) point = glm::normalize(point);
+
+        const GLushort faces[] = {
+            0, 11, 5,  0, 5,  1, 0, 1, 7, 0, 7,  10, 0, 10, 11,
+            1, 5,  9,  5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+            3, 9,  4,  3, 4,  2, 3, 2, 6, 3, 6,  8,  3, 8,  9,
+            4, 9,  5,  2, 4,  11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+
+        std::map<std::pair<GLushort, GLushort>, GLushort> midpoints;
+        auto midpoint = [&](GLushort a, GLushort b) {
+            auto key = std::minmax(a, b);
+            auto it = midpoints.find(key);
+            if (it != midpoints.end())
+                return it->second;
+            vec3 point = glm::normalize(points[a] + points[b]);
+            points.push_back(point);
+            GLushort index = points.size() - 1;
+            midpoints[key] = index;
+            return index;
+        };
+
+        indices.clear();
+        for (size_t i = 0; i < sizeof(faces) / sizeof(faces[0]); i += 3) {
+            GLushort a = faces[i], b = faces[i + 1], c = faces[i + 2];
+            GLushort ab = midpoint(a, b);
+            GLushort bc = midpoint(b, c);
+            GLushort ca = midpoint(c, a);
+            indices.insert(indices.end(),
+                           {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+        }
+
+        for (auto & point : points) point *= kVolumeScale;
+    }
+
+    DeferredRenderer::Stats::Stats() : pointLights(0), directionalLights(0) {}
+
+    DeferredRenderer::DeferredRenderer()
+        : viewport {0, 0, 0, 0},
+          target(0),
+          width(0),
+          height(0),
+          geometryBuffer(0),
+          albedoTexture(0),
+          normalTexture(0),
+          depthTexture(0),
+          lightBuffer(0),
+          lightTexture(0),
+          directionalProgram(0),
+          ambientLocation(-1),
+          lightCountLocation(-1),
+          lightDirectionsLocation(-1),
+          lightColorsLocation(-1),
+          pointProgram(0),
+          viewProjLocation(-1),
+          inverseViewProjLocation(-1),
+          cameraPosLocation(-1),
+          screenSizeLocation(-1),
+          compositeProgram(0),
+          emptyArray(0),
+          volumeArray(0),
+          volumeBuffer(0),
+          volumeIndices(0),
+          volumeIndexCount(0),
+          ambient(0.1f) {}
+
+    DeferredRenderer::DeferredRenderer(DeferredRenderer && other)
+        : DeferredRenderer() {
+        *this = move(other);
+    }
+
+    DeferredRenderer & DeferredRenderer::operator=(DeferredRenderer && other) {
+        release();
+        std::memcpy(viewport, other.viewport, sizeof(viewport));
+        target = other.target;
+        width = other.width;
+        height = other.height;
+        geometryBuffer = other.geometryBuffer;
+        albedoTexture = other.albedoTexture;
+        normalTexture = other.normalTexture;
+        depthTexture = other.depthTexture;
+        lightBuffer = other.lightBuffer;
+        lightTexture = other.lightTexture;
+        directionalProgram = other.directionalProgram;
+        ambientLocation = other.ambientLocation;
+        lightCountLocation = other.lightCountLocation;
+        lightDirectionsLocation = other.lightDirectionsLocation;
+        lightColorsLocation = other.lightColorsLocation;
+        pointProgram = other.pointProgram;
+        viewProjLocation = other.viewProjLocation;
+        inverseViewProjLocation = other.inverseViewProjLocation;
+        cameraPosLocation = other.cameraPosLocation;
+        screenSizeLocation = other.screenSizeLocation;
+        compositeProgram = other.compositeProgram;
+        emptyArray = other.emptyArray;
+        volumeArray = other.volumeArray;
+        volumeBuffer = other.volumeBuffer;
+        volumeIndices = other.volumeIndices;
+        volumeIndexCount = other.volumeIndexCount;
+        sceneLights = move(other.sceneLights);
+        instances = move(other.instances);
+        stats = other.stats;
+        ambient = other.ambient;
+
+        other.width = 0;
+        other.height = 0;
+        other.geometryBuffer = 0;
+        other.albedoTexture = 0;
+        other.normalTexture = 0;
+        other.depthTexture = 0;
+        other.lightBuffer = 0;
+        other.lightTexture = 0;
+        other.directionalProgram = 0;
+        other.pointProgram = 0;
+        other.compositeProgram = 0;
+        other.emptyArray = 0;
+        other.volumeArray = 0;
+        other.volumeBuffer = 0;
+        other.volumeIndices = 0;
+        return *this;
+    }
+
+    DeferredRenderer::~DeferredRenderer() {
+        release();
+    }
+
+    void DeferredRenderer::releaseTargets() {
+        if (geometryBuffer)
+            glDeleteFramebuffers(1, &geometryBuffer);
+        if (lightBuffer)
+            glDeleteFramebuffers(1, &lightBuffer);
+
+        GLuint textures[] = {albedoTexture, normalTexture, depthTexture,
+                             lightTexture};
+        for (auto texture : textures) {
+            if (texture)
+                glDeleteTextures(1, &texture);
+        }
+
+        geometryBuffer = 0;
+        lightBuffer = 0;
+        albedoTexture = 0;
+        normalTexture = 0;
+        depthTexture = 0;
+        lightTexture = 0;
+        width = 0;
+        height = 0;
+
+        // Deleted names may be handed out again
+        StateCache::current().invalidateBindings();
+    }
+
+    void DeferredRenderer::release() {
+        releaseTargets();
+        if (directionalProgram)
+            glDeleteProgram(directionalProgram);
+        if (pointProgram)
+            glDeleteProgram(pointProgram);
+        if (compositeProgram)
+            glDeleteProgram(compositeProgram);
+        if (emptyArray)
+            glDeleteVertexArrays(1, &emptyArray);
+        if (volumeArray)
+            glDeleteVertexArrays(1, &volumeArray);
+        if (volumeBuffer)
+            glDeleteBuffers(1, &volumeBuffer);
+        if (volumeIndices)
+            glDeleteBuffers(1, &volumeIndices);
+        directionalProgram = 0;
+        pointProgram = 0;
+        compositeProgram = 0;
+        emptyArray = 0;
+        volumeArray = 0;
+        volumeBuffer = 0;
+        volumeIndices = 0;
+    }
+
+    void DeferredRenderer::setup() {
+        auto & cache = StateCache::current();
+
+        directionalProgram =
+            GlUtil::linkProgram(GlUtil::FullscreenVertexSource,
+                                kDirectionalFragmentSource, "Deferred");
+        ambientLocation = glGetUniformLocation(directionalProgram, "ambient");
+        lightCountLocation =
+            glGetUniformLocation(directionalProgram, "lightCount");
+        lightDirectionsLocation =
+            glGetUniformLocation(directionalProgram, "lightDirections");
+        lightColorsLocation =
+            glGetUniformLocation(directionalProgram, "lightColors");
+        cache.useProgram(directionalProgram);
+        glUniform1i(glGetUniformLocation(directionalProgram, "gAlbedo"), 0);
+        glUniform1i(glGetUniformLocation(directionalProgram, "gNormal"), 1);
+
+        pointProgram = GlUtil::linkProgram(kPointVertexSource,
+                                           kPointFragmentSource, "Deferred");
+        viewProjLocation = glGetUniformLocation(pointProgram, "viewProj");
+        inverseViewProjLocation =
+            glGetUniformLocation(pointProgram, "inverseViewProj");
+        cameraPosLocation = glGetUniformLocation(pointProgram, "cameraPos");
+        screenSizeLocation = glGetUniformLocation(pointProgram, "screenSize");
+        cache.useProgram(pointProgram);
+        glUniform1i(glGetUniformLocation(pointProgram, "gAlbedo"), 0);
+        glUniform1i(glGetUniformLocation(pointProgram, "gNormal"), 1);
+        glUniform1i(glGetUniformLocation(pointProgram, "gDepth"), 2);
+
+        compositeProgram =
+            GlUtil::linkProgram(GlUtil::FullscreenVertexSource,
+                                kCompositeFragmentSource, "Deferred");
+        cache.useProgram(compositeProgram);
+        glUniform1i(glGetUniformLocation(compositeProgram, "lightTexture"), 0);
+        glUniform1i(glGetUniformLocation(compositeProgram, "gDepth"), 2);
+
+        // Core profile draws need a vertex array even without attributes
+        glGenVertexArrays(1, &emptyArray);
+
+        vector<vec3>     points;
+        vector<GLushort> indices;
+        buildVolume(points, indices);
+        volumeIndexCount = indices.size();
+
+        glGenVertexArrays(1, &volumeArray);
+        glGenBuffers(1, &volumeBuffer);
+        glGenBuffers(1, &volumeIndices);
+        cache.bindVertexArray(volumeArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, volumeBuffer);
+        glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(vec3),
+                     points.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), nullptr);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volumeIndices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+                     indices.data(), GL_STATIC_DRAW);
+
+        // Instance attributes point into the StreamBuffer, set per draw
+        glEnableVertexAttribArray(1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(1, 1);
+        glVertexAttribDivisor(2, 1);
+
+        cache.bindVertexArray(0);
+    }
+
+    void DeferredRenderer::resize(GLsizei width, GLsizei height) {
+        releaseTargets();
+        this->width = width;
+        this->height = height;
+
+        albedoTexture = GlUtil::createTarget(GL_RGBA8, GL_RGBA,
+                                             GL_UNSIGNED_BYTE, width, height);
+        normalTexture =
+            GlUtil::createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+        depthTexture =
+            GlUtil::createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL,
+                                 GL_UNSIGNED_INT_24_8, width, height);
+        lightTexture =
+            GlUtil::createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT, width, height);
+
+        glGenFramebuffers(1, &geometryBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, geometryBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, albedoTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                               GL_TEXTURE_2D, normalTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D, depthTexture, 0);
+        const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0,
+                                      GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+        GlUtil::checkFramebuffer("G-buffer");
+
+        glGenFramebuffers(1, &lightBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, lightBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, lightTexture, 0);
+        GlUtil::checkFramebuffer("Light");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        Logging::Graphics->debug("Deferred targets resized to {}x{}", width,
+                                 height);
+    }
+
+    void DeferredRenderer::beginGeometry() {
+        if (!directionalProgram)
+            setup();
+
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        if (viewport[2] != width || viewport[3] != height)
+            resize(viewport[2], viewport[3]);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, geometryBuffer);
+        glViewport(0, 0, width, height);
+
+        // The clear colour belongs to the target, alpha and w of 0 mark
+        // pixels nothing was drawn to
+        StateCache::current().depthMask(true);
+        glClearBufferfv(GL_COLOR, 0, kClearZero);
+        glClearBufferfv(GL_COLOR, 1, kClearZero);
+        glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+    }
+
+    void DeferredRenderer::shadeDirectional(const vector<Light> & lights) {
+        vec3 directions[MaxDirectional];
+        vec3 colors[MaxDirectional];
+        for (auto & light : lights) {
+            if (light.type != Light::Directional)
+                continue;
+            if (stats.directionalLights == MaxDirectional)
+                break;
+            directions[stats.directionalLights] =
+                glm::normalize(light.direction);
+            colors[stats.directionalLights] = light.color * light.intensity;
+            stats.directionalLights++;
+        }
+
+        auto & cache = StateCache::current();
+        cache.useProgram(directionalProgram);
+        glUniform3fv(ambientLocation, 1, glm::value_ptr(ambient));
+        glUniform1i(lightCountLocation, stats.directionalLights);
+        if (stats.directionalLights) {
+            glUniform3fv(lightDirectionsLocation, stats.directionalLights,
+                         glm::value_ptr(directions[0]));
+            glUniform3fv(lightColorsLocation, stats.directionalLights,
+                         glm::value_ptr(colors[0]));
+        }
+        cache.bindVertexArray(emptyArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    void DeferredRenderer::shadePoints(const RenderState &   state,
+                                       const vector<Light> & lights) {
+        instances.clear();
+        for (auto & light : lights) {
+            if (light.type != Light::Point || light.radius <= 0
+                || light.intensity <= 0)
+                continue;
+            instances.push_back({vec4(light.position, light.radius),
+                                 vec4(light.color * light.intensity, 0)});
+        }
+        stats.pointLights = instances.size();
+        if (instances.empty())
+            return;
+
+        auto & stream = StreamBuffer::current();
+        size_t bytes = instances.size() * sizeof(PointInstance);
+        auto allocation = stream.allocate(bytes, sizeof(PointInstance));
+        std::memcpy(allocation.data, instances.data(), bytes);
+        stream.commit(allocation);
+
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(volumeArray);
+        glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(PointInstance),
+                              (const void *)(allocation.offset
+                                             + offsetof(PointInstance,
+                                                        positionRadius)));
+        glVertexAttribPointer(
+            2, 4, GL_FLOAT, GL_FALSE, sizeof(PointInstance),
+            (const void *)(allocation.offset + offsetof(PointInstance, color)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Back faces so volumes still draw with the camera inside them, the
+        // fragment shader rejects pixels outside the radius
+        cache.setEnabled(GL_CULL_FACE, true);
+        cache.cullFace(GL_FRONT);
+        cache.frontFace(GL_CCW);
+        cache.setEnabled(GL_BLEND, true);
+        cache.blendFunc(GL_ONE, GL_ONE);
+
+        const mat4 & viewProj = state.getVP();
+        mat4         inverseViewProj = glm::inverse(viewProj);
+        vec3         cameraPos = vec3(glm::inverse(state.getView())[3]);
+        cache.useProgram(pointProgram);
+        glUniformMatrix4fv(viewProjLocation, 1, GL_FALSE,
+                           glm::value_ptr(viewProj));
+        glUniformMatrix4fv(inverseViewProjLocation, 1, GL_FALSE,
+                           glm::value_ptr(inverseViewProj));
+        glUniform3fv(cameraPosLocation, 1, glm::value_ptr(cameraPos));
+        glUniform2f(screenSizeLocation, width, height);
+        glDrawElementsInstanced(GL_TRIANGLES, volumeIndexCount,
+                                GL_UNSIGNED_SHORT, nullptr, instances.size());
+
+        cache.setEnabled(GL_BLEND, false);
+        cache.cullFace(GL_BACK);
+    }
+
+    void DeferredRenderer::composite() {
+        auto & cache = StateCache::current();
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+        // The shader writes G-buffer depth, which works whatever the sample
+        // count of target is
+        cache.setEnabled(GL_CULL_FACE, false);
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.depthFunc(GL_ALWAYS);
+        cache.depthMask(true);
+        cache.bindTexture(0, GL_TEXTURE_2D, lightTexture);
+        cache.useProgram(compositeProgram);
+        cache.bindVertexArray(emptyArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        cache.depthFunc(GL_LEQUAL);
+    }
+
+    void DeferredRenderer::shade(const RenderState &   state,
+                                 const vector<Light> & lights) {
+        GpuProfiler::Scope scope("Deferred Shading");
+        auto & cache = StateCache::current();
+        stats = Stats();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, lightBuffer);
+        glClearBufferfv(GL_COLOR, 0, kClearZero);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        cache.setEnabled(GL_DEPTH_TEST, false);
+        cache.depthMask(false);
+        cache.setEnabled(GL_BLEND, false);
+        cache.setEnabled(GL_CULL_FACE, false);
+
+        cache.bindTexture(0, GL_TEXTURE_2D, albedoTexture);
+        cache.bindTexture(1, GL_TEXTURE_2D, normalTexture);
+        cache.bindTexture(2, GL_TEXTURE_2D, depthTexture);
+
+        shadeDirectional(lights);
+        shadePoints(state, lights);
+        composite();
+
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.depthMask(true);
+        cache.setEnabled(GL_CULL_FACE, true);
+        cache.cullFace(GL_BACK);
+        cache.bindVertexArray(0);
+    }
+
+    void DeferredRenderer::draw(const Scene & scene,
+                                RenderState   state,
+                                RenderQueue & queue) {
+        // Grids do not write a normal, draw them after shading
+        state.setGridEnable(false);
+
+        beginGeometry();
+        {
+            GpuProfiler::Scope scope("Geometry");
+            scene.draw(state, queue);
+        }
+
+        sceneLights.clear();
+        scene.collectLights(sceneLights, state.getModel());
+        shade(state, sceneLights);
+    }
+
+    const DeferredRenderer::Stats & DeferredRenderer::getStats() const {
+        return stats;
+    }
+}
@@ -0,0 +1,110 @@
+#include "singe/Graphics/DepthProgram.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <string>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/InstancedModel.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using std::string;
+    using glm::vec3;
+
+    static const char * kDepthVertexSource = R"(
+layout(location = 0) in vec3 aPos;
+#ifdef INSTANCED
+layout(location = 3) in mat4 aInstance;
+#endif
+invariant gl_Position;
+uniform mat4 mvp;
+// w is 1 for Model::Packed
+uniform vec4 posOffset;
+uniform vec4 posScale;
+void main() {
+    bool packedVertex = posOffset.w != 0.0;
+    vec3 pos = packedVertex ? posOffset.xyz + aPos * posScale.xyz : aPos;
+#ifdef INSTANCED
+    gl_Position = mvp * aInstance * vec4(pos, 1.0);
+#else
+    gl_Position = mvp * vec4(pos, 1.0);
+#endif
+}
+)";
+
+    static const char * kDepthFragmentSource = R"(#version 330 core
+void main() {}
+)";
+
+    static GLuint linkProgram(bool instanced) {
+        string vertexSource = "#version 330 core\n";
+        if (instanced)
+            vertexSource += "#define INSTANCED\n";
+        vertexSource += kDepthVertexSource;
+        return GlUtil::linkProgram(vertexSource.c_str(), kDepthFragmentSource,
+                                   "Depth");
+    }
+
+    DepthProgram::DepthProgram()
+        : meshProgram {0, -1, -1, -1}, instancedProgram {0, -1, -1, -1} {}
+
+    DepthProgram::DepthProgram(DepthProgram && other) : DepthProgram() {
+        *this = move(other);
+    }
+
+    DepthProgram & DepthProgram::operator=(DepthProgram && other) {
+        release();
+        meshProgram = other.meshProgram;
+        instancedProgram = other.instancedProgram;
+        other.meshProgram.program = 0;
+        other.instancedProgram.program = 0;
+        return *this;
+    }
+
+    DepthProgram::~DepthProgram() {
+        release();
+    }
+
+    void DepthProgram::release() {
+        if (meshProgram.program)
+            glDeleteProgram(meshProgram.program);
+        if (instancedProgram.program)
+            glDeleteProgram(instancedProgram.program);
+        meshProgram.program = 0;
+        instancedProgram.program = 0;
+    }
+
+    void DepthProgram::setup() {
+        Program * programs[] = {&meshProgram, &instancedProgram};
+        for (size_t i = 0; i < 2; i++) {
+            Program & program = *programs[i];
+            program.program = linkProgram(i == 1);
+            program.mvp = glGetUniformLocation(program.program, "mvp");
+            program.posOffset =
+                glGetUniformLocation(program.program, "posOffset");
+            program.posScale =
+                glGetUniformLocation(program.program, "posScale");
+        }
+    }
+
+    void DepthProgram::draw(const Model & mesh, const mat4 & mvp) {
+        if (!meshProgram.program)
+            setup();
+
+        bool instanced = dynamic_cast<const InstancedModel *>(&mesh);
+        const Program & program = instanced ? instancedProgram : meshProgram;
+
+        RenderState decode;
+        mesh.applyFormat(decode);
+        const vec3 & posOffset = decode.getPositionOffset();
+        const vec3 & posScale = decode.getPositionScale();
+
+        StateCache::current().useProgram(program.program);
+        glUniformMatrix4fv(program.mvp, 1, GL_FALSE, glm::value_ptr(mvp));
+        glUniform4f(program.posOffset, posOffset.x, posOffset.y, posOffset.z,
+                    decode.getPacked() ? 1 : 0);
+        glUniform4f(program.posScale, posScale.x, posScale.y, posScale.z, 0);
+        mesh.drawMesh();
+    }
+}
@@ -0,0 +1,309 @@
+#include "singe/Graphics/DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+
+    /// Weight of a new frame time in the smoothed time
+    static constexpr double kSmoothing = 0.1;
+    /// Relative error from the target that is left alone
+    static constexpr double kDeadband = 0.1;
+
+    static const char * kUpscaleFragmentSource = R"(#version 330 core
+uniform sampler2D colorTexture;
+// Scaled size in pixels, the used corner of colorTexture
+uniform vec2 region;
+in vec2 uv;
+out vec4 color;
+void main() {
+    // Keep the filter footprint inside the corner that was drawn
+    vec2 texel = clamp(uv * region, vec2(0.5), region - 0.5);
+    color = texture(colorTexture, texel / vec2(textureSize(colorTexture, 0)));
+}
+)";
+
+    static float snapScale(float scale) {
+        return std::round(scale / DynamicResolution::ScaleStep)
+               * DynamicResolution::ScaleStep;
+    }
+
+    DynamicResolution::DynamicResolution(float targetTime,
+                                         float minScale,
+                                         float maxScale)
+        : targetTime(targetTime),
+          minScale(minScale),
+          maxScale(maxScale),
+          scale(maxScale),
+          gpuTime(0),
+          width(0),
+          height(0),
+          scaledWidth(0),
+          scaledHeight(0),
+          viewport {0, 0, 0, 0},
+          target(0),
+          frameBuffer(0),
+          colorTexture(0),
+          depthBuffer(0),
+          textureWidth(0),
+          textureHeight(0),
+          upscaleProgram(0),
+          regionLocation(-1),
+          emptyArray(0),
+          queries {0},
+          pending {false},
+          nextQuery(0),
+          timing(false),
+          settleFrames(0) {}
+
+    DynamicResolution::DynamicResolution(DynamicResolution && other)
+        : DynamicResolution(other.targetTime, other.minScale, other.maxScale) {
+        *this = move(other);
+    }
+
+    DynamicResolution &
+    DynamicResolution::operator=(DynamicResolution && other) {
+        release();
+        targetTime = other.targetTime;
+        minScale = other.minScale;
+        maxScale = other.maxScale;
+        scale = other.scale;
+        gpuTime = other.gpuTime;
+        width = other.width;
+        height = other.height;
+        scaledWidth = other.scaledWidth;
+        scaledHeight = other.scaledHeight;
+        std::copy(other.viewport, other.viewport + 4, viewport);
+        target = other.target;
+        frameBuffer = other.frameBuffer;
+        colorTexture = other.colorTexture;
+        depthBuffer = other.depthBuffer;
+        textureWidth = other.textureWidth;
+        textureHeight = other.textureHeight;
+        upscaleProgram = other.upscaleProgram;
+        regionLocation = other.regionLocation;
+        emptyArray = other.emptyArray;
+        std::copy(other.queries, other.queries + QueryCount, queries);
+        std::copy(other.pending, other.pending + QueryCount, pending);
+        nextQuery = other.nextQuery;
+        timing = other.timing;
+        settleFrames = other.settleFrames;
+
+        other.width = 0;
+        other.height = 0;
+        other.frameBuffer = 0;
+        other.colorTexture = 0;
+        other.depthBuffer = 0;
+        other.upscaleProgram = 0;
+        other.emptyArray = 0;
+        std::fill(other.queries, other.queries + QueryCount, 0);
+        std::fill(other.pending, other.pending + QueryCount, false);
+        return *this;
+    }
+
+    DynamicResolution::~DynamicResolution() {
+        release();
+    }
+
+    void DynamicResolution::releaseTarget() {
+        if (frameBuffer)
+            glDeleteFramebuffers(1, &frameBuffer);
+        if (colorTexture)
+            glDeleteTextures(1, &colorTexture);
+        if (depthBuffer)
+            glDeleteRenderbuffers(1, &depthBuffer);
+        if (colorTexture)
+            StateCache::current().invalidateBindings();
+
+        frameBuffer = 0;
+        colorTexture = 0;
+        depthBuffer = 0;
+        width = 0;
+        height = 0;
+    }
+
+    void DynamicResolution::setup() {
+        upscaleProgram = GlUtil::linkProgram(GlUtil::FullscreenVertexSource,
+                                             kUpscaleFragmentSource,
+                                             "Dynamic resolution");
+        regionLocation = glGetUniformLocation(upscaleProgram, "region");
+        StateCache::current().useProgram(upscaleProgram);
+        glUniform1i(glGetUniformLocation(upscaleProgram, "colorTexture"), 0);
+
+        glGenQueries(QueryCount, queries);
+        glGenVertexArrays(1, &emptyArray);
+    }
+
+    void DynamicResolution::release() {
+        releaseTarget();
+        if (upscaleProgram)
+            glDeleteProgram(upscaleProgram);
+        if (emptyArray)
+            glDeleteVertexArrays(1, &emptyArray);
+        upscaleProgram = 0;
+        emptyArray = 0;
+        if (queries[0])
+            glDeleteQueries(QueryCount, queries);
+        std::fill(queries, queries + QueryCount, 0);
+        std::fill(pending, pending + QueryCount, false);
+    }
+
+    void DynamicResolution::resize(GLsizei width, GLsizei height) {
+        releaseTarget();
+        this->width = width;
+        this->height = height;
+
+        textureWidth = std::ceil(width * maxScale);
+        textureHeight = std::ceil(height * maxScale);
+
+        colorTexture =
+            GlUtil::createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE,
+                                 textureWidth, textureHeight, GL_LINEAR);
+
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+                              textureWidth, textureHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &frameBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, depthBuffer);
+        GlUtil::checkFramebuffer("Dynamic resolution");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        Logging::Graphics->debug("Dynamic resolution target resized to {}x{}",
+                                 textureWidth, textureHeight);
+    }
+
+    void DynamicResolution::setTargetTime(float milliseconds) {
+        targetTime = milliseconds;
+    }
+
+    void DynamicResolution::setScaleBounds(float minScale, float maxScale) {
+        this->minScale = minScale;
+        // The target is allocated at the largest scale
+        if (maxScale != this->maxScale)
+            releaseTarget();
+        this->maxScale = maxScale;
+        scale = std::clamp(scale, minScale, maxScale);
+    }
+
+    float DynamicResolution::getScale() const {
+        return scale;
+    }
+
+    double DynamicResolution::getGpuTime() const {
+        return gpuTime;
+    }
+
+    void DynamicResolution::updateScale(double frameTime) {
+        // Frames still in flight were drawn at the old scale
+        if (settleFrames) {
+            settleFrames--;
+            return;
+        }
+
+        gpuTime = gpuTime == 0 ? frameTime
+                               : gpuTime + (frameTime - gpuTime) * kSmoothing;
+
+        double ratio = targetTime / gpuTime;
+        if (std::abs(ratio - 1) < kDeadband)
+            return;
+
+        // Drop quickly to catch up, rise slowly so it does not hunt
+        float wanted = scale * std::sqrt(ratio);
+        float rate = ratio < 1 ? 0.5f : 0.1f;
+        float next = snapScale(scale + (wanted - scale) * rate);
+        if (next == scale)
+            next = scale + (ratio < 1 ? -ScaleStep : ScaleStep);
+        next = std::clamp(next, minScale, maxScale);
+        if (next != scale) {
+            scale = next;
+            gpuTime = 0;
+            settleFrames = QueryCount;
+        }
+    }
+
+    void DynamicResolution::readQueries() {
+        // Queries finish in order, stop at the first that has not
+        for (size_t i = 0; i < QueryCount; i++) {
+            size_t index = (nextQuery + i) % QueryCount;
+            if (!pending[index])
+                continue;
+
+            GLint available = 0;
+            glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE,
+                               &available);
+            if (!available)
+                break;
+
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+            pending[index] = false;
+            updateScale(elapsed / 1e6);
+        }
+    }
+
+    void DynamicResolution::begin(GLsizei width, GLsizei height) {
+        if (!upscaleProgram)
+            setup();
+
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        if (width != this->width || height != this->height)
+            resize(width, height);
+
+        scaledWidth = std::max<GLsizei>(1, width * scale);
+        scaledHeight = std::max<GLsizei>(1, height * scale);
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        glViewport(0, 0, scaledWidth, scaledHeight);
+
+        StateCache::current().depthMask(true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT
+                | GL_STENCIL_BUFFER_BIT);
+
+        // Skip timing if the GPU is further behind than the queries
+        timing = !pending[nextQuery];
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, queries[nextQuery]);
+    }
+
+    void DynamicResolution::end() {
+        if (timing) {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[nextQuery] = true;
+            nextQuery = (nextQuery + 1) % QueryCount;
+        }
+
+        GpuProfiler::Scope scope("Upscale");
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+        auto & cache = StateCache::current();
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        cache.setEnabled(GL_DEPTH_TEST, false);
+        cache.setEnabled(GL_BLEND, false);
+        cache.setEnabled(GL_CULL_FACE, false);
+        cache.bindTexture(0, GL_TEXTURE_2D, colorTexture);
+        cache.useProgram(upscaleProgram);
+        glUniform2f(regionLocation, scaledWidth, scaledHeight);
+        cache.bindVertexArray(emptyArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.setEnabled(GL_CULL_FACE, true);
+        cache.bindVertexArray(0);
+
+        readQueries();
+    }
+}
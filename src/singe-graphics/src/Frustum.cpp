@@ -0,0 +1,156 @@
+#include "singe/Graphics/Frustum.hpp"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define SINGE_FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace singe {
+    using glm::vec3;
+
+    static vec4 normalizePlane(const vec4 & plane) {
+        float length = glm::length(vec3(plane));
+        if (length > 0)
+            return plane / length;
+        return plane;
+    }
+
+    Frustum::Frustum() {
+        // w of 1 with no normal is always inside
+        for (auto & plane : planes) plane = vec4(0, 0, 0, 1);
+    }
+
+    Frustum::Frustum(const mat4 & m) {
+        // Gribb / Hartmann plane extraction, glm is column major so row i is
+        // (m[0][i], m[1][i], m[2][i], m[3][i])
+        vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        planes[Left] = normalizePlane(row3 + row0);
+        planes[Right] = normalizePlane(row3 - row0);
+        planes[Bottom] = normalizePlane(row3 + row1);
+        planes[Top] = normalizePlane(row3 - row1);
+        planes[Near] = normalizePlane(row3 + row2);
+        planes[Far] = normalizePlane(row3 - row2);
+    }
+
+    const vec4 & Frustum::getPlane(Plane plane) const {
+        return planes[plane];
+    }
+
+    bool Frustum::intersects(const AABB & box) const {
+        if (box.empty())
+            return false;
+
+        vec3 c = box.center();
+        vec3 e = box.extent();
+        for (auto & plane : planes) {
+            float d = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+            float r = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y
+                      + std::abs(plane.z) * e.z;
+            if (d + r < 0)
+                return false;
+        }
+        return true;
+    }
+
+    Frustum::Containment Frustum::classify(const AABB & box) const {
+        if (box.empty())
+            return Outside;
+
+        vec3        c = box.center();
+        vec3        e = box.extent();
+        Containment result = Inside;
+        for (auto & plane : planes) {
+            float d = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+            float r = std::abs(plane.x) * e.x + std::abs(plane.y) * e.y
+                      + std::abs(plane.z) * e.z;
+            if (d + r < 0)
+                return Outside;
+            if (d - r < 0)
+                result = Intersects;
+        }
+        return result;
+    }
+
+    bool Frustum::intersects(const BoundingSphere & sphere) const {
+        for (auto & plane : planes) {
+            float d = glm::dot(vec3(plane), sphere.center) + plane.w;
+            if (d + sphere.radius < 0)
+                return false;
+        }
+        return true;
+    }
+
+    size_t Frustum::intersects(const AABB * boxes,
+                               size_t       count,
+                               uint8_t *    visible) const {
+        size_t nVisible = 0;
+        size_t i = 0;
+
+#ifdef SINGE_FRUSTUM_SSE
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+
+        for (; i + 4 <= count; i += 4) {
+            const AABB * b = boxes + i;
+
+            // Transpose 4 boxes to structure of arrays
+            __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+            __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+            __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+            __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+            __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+            __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+            __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+            __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+            __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+            __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+            __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+            __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+            // Empty boxes have a negative extent and are never visible
+            __m128 outside = _mm_or_ps(
+                _mm_cmplt_ps(ex, zero),
+                _mm_or_ps(_mm_cmplt_ps(ey, zero), _mm_cmplt_ps(ez, zero)));
+
+            for (auto & plane : planes) {
+                __m128 px = _mm_set1_ps(plane.x);
+                __m128 py = _mm_set1_ps(plane.y);
+                __m128 pz = _mm_set1_ps(plane.z);
+                __m128 pw = _mm_set1_ps(plane.w);
+
+                __m128 d = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+                    _mm_add_ps(_mm_mul_ps(pz, cz), pw));
+                __m128 r = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), ex),
+                               _mm_mul_ps(_mm_andnot_ps(signMask, py), ey)),
+                    _mm_mul_ps(_mm_andnot_ps(signMask, pz), ez));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for (int j = 0; j < 4; j++) {
+                uint8_t in = (mask >> j) & 1 ? 0 : 1;
+                visible[i + j] = in;
+                nVisible += in;
+            }
+        }
+#endif
+
+        for (; i < count; i++) {
+            visible[i] = intersects(boxes[i]) ? 1 : 0;
+            nVisible += visible[i];
+        }
+
+        return nVisible;
+    }
+}
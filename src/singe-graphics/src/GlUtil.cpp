@@ -0,0 +1,161 @@
+#include "singe/Graphics/GlUtil.hpp"
+
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe::GlUtil {
+    const char * const FullscreenVertexSource = R"(#version 330 core
+out vec2 uv;
+void main() {
+    // One triangle covering the viewport, no vertex buffer needed
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    uv = corner;
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+    GLuint compileStage(GLenum type, const char * source, const char * name) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+
+        GLint status;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (!status) {
+            char log[512];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            Logging::Graphics->error("{} shader failed to compile: {}", name,
+                                     log);
+        }
+        return shader;
+    }
+
+    GLuint linkProgram(const char * vertexSource,
+                       const char * fragmentSource,
+                       const char * name) {
+        GLuint vertex = compileStage(GL_VERTEX_SHADER, vertexSource, name);
+        GLuint fragment =
+            compileStage(GL_FRAGMENT_SHADER, fragmentSource, name);
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+
+        GLint status;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            char log[512];
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            Logging::Graphics->error("{} shader failed to link: {}", name, log);
+        }
+        return program;
+    }
+
+    GLuint createTarget(GLint   format,
+                        GLenum  layout,
+                        GLenum  type,
+                        GLsizei width,
+                        GLsizei height,
+                        GLint   filter) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, layout, type,
+                     nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    GLuint createMultisampleTarget(GLint   format,
+                                   GLsizei samples,
+                                   GLsizei width,
+                                   GLsizei height) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D_MULTISAMPLE,
+                                          texture);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, format,
+                                width, height, GL_TRUE);
+        return texture;
+    }
+
+    bool checkFramebuffer(const char * name) {
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            Logging::Graphics->error("{} framebuffer incomplete: {:#x}", name,
+                                     status);
+            return false;
+        }
+        return true;
+    }
+
+    GLint getSamples(GLuint framebuffer) {
+        GLint bound;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+        GLint samples;
+        glGetIntegerv(GL_SAMPLES, &samples);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, bound);
+        return samples;
+    }
+
+    GLenum getDepthFormat(GLuint framebuffer) {
+        GLint bound;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+
+        // The default framebuffer names its buffers differently
+        GLenum depthAttachment = framebuffer ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+        GLenum stencilAttachment =
+            framebuffer ? GL_STENCIL_ATTACHMENT : GL_STENCIL;
+        auto query = [](GLenum attachment, GLenum name) {
+            GLint value = 0;
+            glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER,
+                                                  attachment, name, &value);
+            return value;
+        };
+
+        GLint depthBits = 0;
+        GLint depthType = GL_NONE;
+        GLint stencilBits = 0;
+        if (query(depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE)
+            != GL_NONE) {
+            depthBits =
+                query(depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE);
+            depthType = query(depthAttachment,
+                              GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE);
+        }
+        if (query(stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE)
+            != GL_NONE) {
+            stencilBits = query(stencilAttachment,
+                                GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE);
+        }
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, bound);
+
+        bool floating = depthType == GL_FLOAT;
+        if (stencilBits == 8) {
+            if (depthBits == 24)
+                return GL_DEPTH24_STENCIL8;
+            if (depthBits == 32 && floating)
+                return GL_DEPTH32F_STENCIL8;
+        }
+        else if (stencilBits == 0) {
+            switch (depthBits) {
+                case 16:
+                    return GL_DEPTH_COMPONENT16;
+                case 24:
+                    return GL_DEPTH_COMPONENT24;
+                case 32:
+                    return floating ? GL_DEPTH_COMPONENT32F
+                                    : GL_DEPTH_COMPONENT32;
+            }
+        }
+        return GL_NONE;
+    }
+}
@@ -0,0 +1,166 @@
+#include "singe/Graphics/GpuProfiler.hpp"
+
+#include <algorithm>
+
+namespace singe {
+    using std::move;
+
+    GpuProfiler::Scope::Scope(const string & name, GpuProfiler & profiler)
+        : profiler(profiler) {
+        profiler.begin(name);
+    }
+
+    GpuProfiler::Scope::~Scope() {
+        profiler.end();
+    }
+
+    GpuProfiler::GpuProfiler()
+        : enabled(false), frames(), frameIndex(0), droppedFrames(0) {
+        for (auto & frame : frames) frame.usedQueries = 0;
+    }
+
+    GpuProfiler::GpuProfiler(GpuProfiler && other) : GpuProfiler() {
+        *this = move(other);
+    }
+
+    GpuProfiler & GpuProfiler::operator=(GpuProfiler && other) {
+        release();
+        enabled = other.enabled;
+        for (size_t i = 0; i < Frames; i++) {
+            frames[i] = move(other.frames[i]);
+            other.frames[i].queries.clear();
+            other.frames[i].markers.clear();
+            other.frames[i].usedQueries = 0;
+        }
+        frameIndex = other.frameIndex;
+        open = move(other.open);
+        timings = move(other.timings);
+        droppedFrames = other.droppedFrames;
+        return *this;
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        release();
+    }
+
+    GpuProfiler & GpuProfiler::current() {
+        // A context can only be current on one thread at a time
+        static thread_local GpuProfiler profiler;
+        return profiler;
+    }
+
+    void GpuProfiler::release() {
+        for (auto & frame : frames) {
+            if (!frame.queries.empty())
+                glDeleteQueries(frame.queries.size(), frame.queries.data());
+            frame.queries.clear();
+            frame.markers.clear();
+            frame.usedQueries = 0;
+        }
+        open.clear();
+    }
+
+    void GpuProfiler::setEnabled(bool enabled) {
+        if (!enabled) {
+            for (auto & frame : frames) {
+                frame.markers.clear();
+                frame.usedQueries = 0;
+            }
+            open.clear();
+            timings.clear();
+        }
+        this->enabled = enabled;
+    }
+
+    bool GpuProfiler::isEnabled() const {
+        return enabled;
+    }
+
+    GLuint GpuProfiler::nextQuery() {
+        Frame & frame = frames[frameIndex];
+        if (frame.usedQueries == frame.queries.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.queries[frame.usedQueries++];
+    }
+
+    bool GpuProfiler::read(Frame & frame) {
+        // Timestamps complete in order, the last one issued finishes the
+        // frame. Markers are in begin order, an outer scope ends after the
+        // inner ones so the last marker is not always the last query
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.usedQueries - 1],
+                           GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+
+        timings.clear();
+        for (auto & marker : frame.markers) {
+            GLuint64 begin = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(marker.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(marker.end, GL_QUERY_RESULT, &end);
+            double milliseconds = (end - begin) / 1e6;
+
+            auto it = std::find_if(timings.begin(), timings.end(),
+                                   [&](const Timing & timing) {
+                                       return timing.depth == marker.depth
+                                              && timing.name == marker.name;
+                                   });
+            if (it == timings.end()) {
+                timings.push_back({marker.name, marker.depth, 1, milliseconds});
+            }
+            else {
+                it->calls++;
+                it->milliseconds += milliseconds;
+            }
+        }
+        return true;
+    }
+
+    void GpuProfiler::beginFrame() {
+        if (!enabled)
+            return;
+
+        // Scopes left open belong to the frame that is ending
+        while (!open.empty()) end();
+
+        frameIndex = (frameIndex + 1) % Frames;
+        Frame & frame = frames[frameIndex];
+        if (!frame.markers.empty() && !read(frame))
+            droppedFrames++;
+        frame.markers.clear();
+        frame.usedQueries = 0;
+    }
+
+    void GpuProfiler::begin(const string & name) {
+        if (!enabled)
+            return;
+
+        Frame & frame = frames[frameIndex];
+        open.push_back(frame.markers.size());
+        frame.markers.push_back({name, open.size() - 1, nextQuery(), 0});
+        glQueryCounter(frame.markers.back().begin, GL_TIMESTAMP);
+    }
+
+    void GpuProfiler::end() {
+        if (!enabled || open.empty())
+            return;
+
+        Frame & frame = frames[frameIndex];
+        Marker & marker = frame.markers[open.back()];
+        open.pop_back();
+        marker.end = nextQuery();
+        glQueryCounter(marker.end, GL_TIMESTAMP);
+    }
+
+    const vector<GpuProfiler::Timing> & GpuProfiler::getTimings() const {
+        return timings;
+    }
+
+    size_t GpuProfiler::getDroppedFrames() const {
+        return droppedFrames;
+    }
+}
@@ -0,0 +1,95 @@
+#include "singe/Graphics/InstancedModel.hpp"
+
+#include <glm/glm.hpp>
+#include <memory>
+
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using glm::mat4;
+    using glm::vec4;
+
+    InstancedModel::InstancedModel() : instanceBuffer(0), instanceCount(0) {}
+
+    InstancedModel::InstancedModel(Model && model)
+        : Model(move(model)), instanceBuffer(0), instanceCount(0) {}
+
+    InstancedModel::InstancedModel(InstancedModel && other)
+        : Model(move(other)),
+          instanceBuffer(other.instanceBuffer),
+          instanceCount(other.instanceCount),
+          instances(move(other.instances)) {
+        other.instanceBuffer = 0;
+        other.instanceCount = 0;
+    }
+
+    InstancedModel & InstancedModel::operator=(InstancedModel && other) {
+        if (instanceBuffer)
+            glDeleteBuffers(1, &instanceBuffer);
+        Model::operator=(move(other));
+        instanceBuffer = other.instanceBuffer;
+        instanceCount = other.instanceCount;
+        instances = move(other.instances);
+        other.instanceBuffer = 0;
+        other.instanceCount = 0;
+        return *this;
+    }
+
+    InstancedModel::~InstancedModel() {
+        if (instanceBuffer)
+            glDeleteBuffers(1, &instanceBuffer);
+    }
+
+    void InstancedModel::updateInstances(Buffer::Usage usage) {
+        vector<mat4> matrices;
+        matrices.reserve(instances.size());
+        for (auto & instance : instances)
+            matrices.emplace_back(instance.toMatrix());
+
+        if (!instanceBuffer)
+            glGenBuffers(1, &instanceBuffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(mat4),
+                     matrices.data(),
+                     usage == Buffer::Dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+
+        // A mat4 attribute uses 4 consecutive vec4 locations. This is set
+        // every time as format may have changed the vertex array
+        bindVertexArray();
+        for (GLuint i = 0; i < 4; i++) {
+            GLuint location = InstanceAttribute + i;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(mat4),
+                                  (const void *)(i * sizeof(vec4)));
+            glVertexAttribDivisor(location, 1);
+        }
+        StateCache::current().bindVertexArray(0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        instanceCount = matrices.size();
+        updateBounds();
+    }
+
+    void InstancedModel::updateBounds() {
+        Model::updateBounds();
+
+        AABB mesh = bounds;
+        bounds = AABB();
+        for (auto & instance : instances)
+            bounds.expand(mesh.transformed(instance.toMatrix()));
+        sphere = BoundingSphere::fromAABB(bounds);
+    }
+
+    void InstancedModel::drawMesh() const {
+        if (instanceCount == 0)
+            return;
+        bindVertexArray();
+        if (indexCount)
+            glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, nullptr,
+                                    instanceCount);
+        else
+            glDrawArraysInstanced(GL_TRIANGLES, 0, points.size(), instanceCount);
+    }
+}
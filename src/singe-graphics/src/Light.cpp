@@ -0,0 +1,47 @@
+#include "singe/Graphics/Light.hpp"
+
+#include <algorithm>
+
+namespace singe {
+    Light::Light(Type type)
+        : type(type),
+          position(0),
+          direction(0, -1, 0),
+          color(1),
+          intensity(1),
+          radius(10) {}
+
+    Light Light::point(const vec3 & position,
+                       const vec3 & color,
+                       float        intensity,
+                       float        radius) {
+        Light light(Point);
+        light.position = position;
+        light.color = color;
+        light.intensity = intensity;
+        light.radius = radius;
+        return light;
+    }
+
+    Light Light::directional(const vec3 & direction,
+                             const vec3 & color,
+                             float        intensity) {
+        Light light(Directional);
+        light.direction = direction;
+        light.color = color;
+        light.intensity = intensity;
+        return light;
+    }
+
+    Light Light::transformed(const mat4 & matrix) const {
+        Light light = *this;
+        light.position = vec3(matrix * glm::vec4(position, 1));
+        light.direction = vec3(matrix * glm::vec4(direction, 0));
+
+        float scale = std::max({glm::length(vec3(matrix[0])),
+                                glm::length(vec3(matrix[1])),
+                                glm::length(vec3(matrix[2]))});
+        light.radius = radius * scale;
+        return light;
+    }
+}
@@ -1,10 +1,16 @@
 #include "singe/Graphics/Material.hpp"
 
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
 #include <memory>
 
+#include "singe/Graphics/StateCache.hpp"
+
 namespace singe {
     using std::move;
 
+    TextureLayer::TextureLayer() : array(0), layer(-1), rect(0, 0, 1, 1) {}
+
     Material::Material() {}
 
     Material::Material(Material && other)
@@ -17,7 +23,9 @@ namespace singe {
           alpha(other.alpha),
           texture(move(other.texture)),
           normalTexture(move(other.normalTexture)),
-          specularTexture(move(other.specularTexture)) {}
+          specularTexture(move(other.specularTexture)) {
+        std::copy(other.layers, other.layers + TextureUnits, layers);
+    }
 
     Material & Material::operator=(Material && other) {
         shader = other.shader;
@@ -30,6 +38,7 @@ namespace singe {
         texture = move(other.texture);
         normalTexture = move(other.normalTexture);
         specularTexture = move(other.specularTexture);
+        std::copy(other.layers, other.layers + TextureUnits, layers);
         return *this;
     }
 
@@ -39,19 +48,55 @@ namespace singe {
         if (shader)
             shader->bind();
 
-        if (texture) {
-            glActiveTexture(GL_TEXTURE0);
-            texture->bind();
-        }
+        bindTextures();
+    }
 
-        if (normalTexture) {
-            glActiveTexture(GL_TEXTURE1);
-            normalTexture->bind();
+    void Material::bindTextures() const {
+        auto &          cache = StateCache::current();
+        const Texture * textures[] = {texture.get(), normalTexture.get(),
+                                      specularTexture.get()};
+        for (GLuint unit = 0; unit < TextureUnits; unit++) {
+            GLuint array = layers[unit].array;
+            if (array)
+                cache.bindTexture(unit, GL_TEXTURE_2D_ARRAY, array);
+            else
+                cache.bindTexture(unit, textures[unit]);
         }
+        applyLayers();
+    }
 
-        if (specularTexture) {
-            glActiveTexture(GL_TEXTURE2);
-            specularTexture->bind();
+    void Material::applyLayers() const {
+        if (!shader)
+            return;
+
+        // Usually bound already, the cache skips it then
+        StateCache::current().useProgram(shader->program());
+        GLint alphaLocation = shader->location("materialAlpha");
+        if (alphaLocation >= 0)
+            glUniform1f(alphaLocation, alpha);
+
+        if (std::none_of(layers, layers + TextureUnits,
+                         [](auto & l) { return l.array != 0; }))
+            return;
+
+        GLint  layerLocation = shader->location("textureLayers");
+        GLint  rectLocation = shader->location("textureRects");
+        if (layerLocation >= 0) {
+            glUniform3f(layerLocation, layers[0].layer, layers[1].layer,
+                        layers[2].layer);
         }
+        if (rectLocation >= 0) {
+            vec4 rects[] = {layers[0].rect, layers[1].rect, layers[2].rect};
+            glUniform4fv(rectLocation, TextureUnits, glm::value_ptr(rects[0]));
+        }
+    }
+
+    const void * Material::boundTexture(size_t unit) const {
+        // Array names are small integers and never collide with pointers
+        if (GLuint array = layers[unit].array)
+            return reinterpret_cast<const void *>(uintptr_t(array));
+        const Texture * textures[] = {texture.get(), normalTexture.get(),
+                                      specularTexture.get()};
+        return textures[unit];
     }
 }
@@ -0,0 +1,193 @@
+#include "singe/Graphics/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string_view>
+#include <unordered_map>
+
+namespace singe {
+    /// Cache modelled by the Forsyth scores, larger than real hardware
+    static constexpr int   kCacheSize = 32;
+    static constexpr float kCacheDecayPower = 1.5f;
+    static constexpr float kLastTriangleScore = 0.75f;
+    static constexpr float kValenceBoostScale = 2.0f;
+    static constexpr float kValenceBoostPower = 0.5f;
+
+    static float vertexScore(int cachePosition, uint32_t remaining) {
+        if (remaining == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // The last triangle's vertices get a fixed score so the next
+            // triangle does not simply re-use the same edge
+            if (cachePosition < 3) {
+                score = kLastTriangleScore;
+            }
+            else {
+                float scaler = 1.0f / (kCacheSize - 3);
+                score = 1.0f - (cachePosition - 3) * scaler;
+                score = std::pow(score, kCacheDecayPower);
+            }
+        }
+
+        // Prefer vertices with few triangles left so they are finished early
+        score += kValenceBoostScale * std::pow(float(remaining), -kValenceBoostPower);
+        return score;
+    }
+
+    vector<uint32_t> MeshOptimizer::weld(vector<Vertex> & points) {
+        std::unordered_map<std::string_view, uint32_t> unique;
+        unique.reserve(points.size());
+
+        // Keys point into the original array which is kept until the end
+        vector<Vertex>   source = std::move(points);
+        vector<uint32_t> indices(source.size());
+        points.clear();
+        points.reserve(source.size());
+
+        for (size_t i = 0; i < source.size(); i++) {
+            std::string_view key(reinterpret_cast<const char *>(&source[i]),
+                                 sizeof(Vertex));
+            auto [it, inserted] = unique.emplace(key, points.size());
+            if (inserted)
+                points.push_back(source[i]);
+            indices[i] = it->second;
+        }
+
+        return indices;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(vector<uint32_t> & indices,
+                                            size_t             vertexCount) {
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // Triangles using each vertex, as offsets into one shared array
+        vector<uint32_t> remaining(vertexCount, 0);
+        for (auto index : indices) remaining[index]++;
+
+        vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] = offsets[v] + remaining[v];
+
+        vector<uint32_t> adjacency(indices.size());
+        vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int c = 0; c < 3; c++) adjacency[fill[indices[t * 3 + c]]++] = t;
+        }
+
+        vector<int>   cachePosition(vertexCount, -1);
+        vector<float> score(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            score[v] = vertexScore(-1, remaining[v]);
+
+        vector<bool> added(triangleCount, false);
+
+        vector<uint32_t> cache;
+        vector<uint32_t> nextCache;
+        cache.reserve(kCacheSize + 3);
+        nextCache.reserve(kCacheSize + 3);
+
+        vector<uint32_t> result;
+        result.reserve(indices.size());
+
+        size_t  cursor = 0;
+        int64_t best = -1;
+        for (size_t output = 0; output < triangleCount; output++) {
+            // Nothing in the cache has triangles left, continue from the
+            // first triangle not yet added
+            if (best < 0) {
+                while (added[cursor]) cursor++;
+                best = cursor;
+            }
+
+            uint32_t triangle = best;
+            added[triangle] = true;
+
+            // Add to the output and remove from each vertex's adjacency
+            for (int c = 0; c < 3; c++) {
+                uint32_t v = indices[triangle * 3 + c];
+                result.push_back(v);
+
+                uint32_t * begin = adjacency.data() + offsets[v];
+                uint32_t * end = begin + remaining[v];
+                *std::find(begin, end, triangle) = *(end - 1);
+                remaining[v]--;
+            }
+
+            // New triangle vertices move to the front of the cache
+            nextCache.clear();
+            for (int c = 0; c < 3; c++) nextCache.push_back(indices[triangle * 3 + c]);
+            for (auto v : cache) {
+                if (std::find(nextCache.begin(), nextCache.begin() + 3, v)
+                    == nextCache.begin() + 3)
+                    nextCache.push_back(v);
+            }
+
+            // Vertices pushed out of the cache lose their position score
+            for (size_t i = 0; i < nextCache.size(); i++) {
+                uint32_t v = nextCache[i];
+                cachePosition[v] = i < size_t(kCacheSize) ? i : -1;
+                score[v] = vertexScore(cachePosition[v], remaining[v]);
+            }
+            if (nextCache.size() > size_t(kCacheSize))
+                nextCache.resize(kCacheSize);
+            cache.swap(nextCache);
+
+            // Rescore triangles around cached vertices and pick the best
+            best = -1;
+            float bestScore = -1.0f;
+            for (auto v : cache) {
+                for (uint32_t i = 0; i < remaining[v]; i++) {
+                    uint32_t t = adjacency[offsets[v] + i];
+                    float    s = score[indices[t * 3]] + score[indices[t * 3 + 1]]
+                              + score[indices[t * 3 + 2]];
+                    if (s > bestScore) {
+                        bestScore = s;
+                        best = t;
+                    }
+                }
+            }
+        }
+
+        indices.swap(result);
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(vector<Vertex> &   points,
+                                            vector<uint32_t> & indices) {
+        constexpr uint32_t unused = ~uint32_t(0);
+
+        vector<uint32_t> remap(points.size(), unused);
+        vector<Vertex>   ordered;
+        ordered.reserve(points.size());
+
+        for (auto & index : indices) {
+            if (remap[index] == unused) {
+                remap[index] = ordered.size();
+                ordered.push_back(points[index]);
+            }
+            index = remap[index];
+        }
+
+        points.swap(ordered);
+    }
+
+    float MeshOptimizer::acmr(const vector<uint32_t> & indices, size_t cacheSize) {
+        if (indices.size() < 3)
+            return 0.0f;
+
+        vector<uint32_t> fifo(cacheSize, ~uint32_t(0));
+        size_t           head = 0;
+        size_t           misses = 0;
+        for (auto index : indices) {
+            if (std::find(fifo.begin(), fifo.end(), index) != fifo.end())
+                continue;
+            fifo[head] = index;
+            head = (head + 1) % cacheSize;
+            misses++;
+        }
+        return float(misses) / float(indices.size() / 3);
+    }
+}
@@ -0,0 +1,314 @@
+#include "singe/Graphics/MeshSimplifier.hpp"
+
+#include "singe/Graphics/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace singe {
+    using glm::vec3;
+
+    /// Weight of border planes relative to surface planes
+    static constexpr double kBorderWeight = 100.0;
+
+    static uint64_t edgeKey(uint32_t a, uint32_t b) {
+        if (a > b)
+            std::swap(a, b);
+        return (uint64_t(a) << 32) | b;
+    }
+
+    struct PositionKey {
+        uint32_t bits[3];
+
+        bool operator==(const PositionKey & other) const {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1]
+                   && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const PositionKey & key) const {
+            size_t h = key.bits[0];
+            h = h * 73856093u ^ key.bits[1];
+            h = h * 19349663u ^ key.bits[2];
+            return h;
+        }
+    };
+
+    MeshSimplifier::Quadric::Quadric() {
+        std::fill(a, a + 10, 0.0);
+    }
+
+    void MeshSimplifier::Quadric::addPlane(
+        double x, double y, double z, double d, double weight) {
+        a[0] += weight * x * x;
+        a[1] += weight * x * y;
+        a[2] += weight * x * z;
+        a[3] += weight * x * d;
+        a[4] += weight * y * y;
+        a[5] += weight * y * z;
+        a[6] += weight * y * d;
+        a[7] += weight * z * z;
+        a[8] += weight * z * d;
+        a[9] += weight * d * d;
+    }
+
+    void MeshSimplifier::Quadric::add(const Quadric & other) {
+        for (int i = 0; i < 10; i++) a[i] += other.a[i];
+    }
+
+    double MeshSimplifier::Quadric::error(const vec3 & p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z
+               + 2 * a[3] * x + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+               + a[7] * z * z + 2 * a[8] * z + a[9];
+    }
+
+    MeshSimplifier::MeshSimplifier(const vector<Vertex> &   points,
+                                   const vector<uint32_t> & indices) {
+        // Corners with equal attributes share a wedge
+        if (indices.empty()) {
+            wedges = points;
+        }
+        else {
+            wedges.reserve(indices.size());
+            for (auto index : indices) wedges.push_back(points[index]);
+        }
+        vector<uint32_t> corners = MeshOptimizer::weld(wedges);
+
+        // Weld wedges by exact position so seams stay connected
+        std::unordered_map<PositionKey, uint32_t, PositionHash> welded;
+        welded.reserve(wedges.size());
+
+        vector<uint32_t> wedgePosition(wedges.size());
+        for (size_t w = 0; w < wedges.size(); w++) {
+            PositionKey key;
+            std::memcpy(key.bits, &wedges[w].pos, sizeof(key.bits));
+            auto [it, inserted] = welded.emplace(key, positions.size());
+            if (inserted) {
+                positions.push_back(wedges[w].pos);
+                positionWedge.push_back(w);
+                seam.push_back(false);
+            }
+            else {
+                seam[it->second] = true;
+            }
+            wedgePosition[w] = it->second;
+        }
+
+        for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+            std::array<uint32_t, 3> wedge {corners[i], corners[i + 1],
+                                           corners[i + 2]};
+            std::array<uint32_t, 3> tri {wedgePosition[wedge[0]],
+                                         wedgePosition[wedge[1]],
+                                         wedgePosition[wedge[2]]};
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                continue;
+            triangles.push_back(tri);
+            triangleWedges.push_back(wedge);
+        }
+
+        // Area weighted plane of each triangle
+        quadrics.resize(positions.size());
+        vector<vec3> normals(triangles.size(), vec3(0));
+        for (size_t t = 0; t < triangles.size(); t++) {
+            auto & tri = triangles[t];
+            vec3   p0 = positions[tri[0]];
+            vec3   n = glm::cross(positions[tri[1]] - p0, positions[tri[2]] - p0);
+            float  length = glm::length(n);
+            if (length == 0)
+                continue;
+            n /= length;
+            normals[t] = n;
+            double d = -glm::dot(n, p0);
+            for (auto v : tri) quadrics[v].addPlane(n.x, n.y, n.z, d, length * 0.5);
+        }
+
+        // Edges used by only one triangle are borders, constrain them with a
+        // plane perpendicular to the triangle through the edge
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        for (auto & tri : triangles) {
+            for (int c = 0; c < 3; c++) edgeUses[edgeKey(tri[c], tri[(c + 1) % 3])]++;
+        }
+        for (size_t t = 0; t < triangles.size(); t++) {
+            auto & tri = triangles[t];
+            for (int c = 0; c < 3; c++) {
+                uint32_t a = tri[c];
+                uint32_t b = tri[(c + 1) % 3];
+                if (edgeUses[edgeKey(a, b)] != 1)
+                    continue;
+                vec3  edge = positions[b] - positions[a];
+                vec3  n = glm::cross(edge, normals[t]);
+                float length = glm::length(n);
+                if (length == 0)
+                    continue;
+                n /= length;
+                double d = -glm::dot(n, positions[a]);
+                double weight = kBorderWeight * glm::dot(edge, edge);
+                quadrics[a].addPlane(n.x, n.y, n.z, d, weight);
+                quadrics[b].addPlane(n.x, n.y, n.z, d, weight);
+            }
+        }
+    }
+
+    size_t MeshSimplifier::triangleCount() const {
+        return triangles.size();
+    }
+
+    vector<Vertex> MeshSimplifier::simplify(float ratio) const {
+        ratio = std::clamp(ratio, 0.0f, 1.0f);
+        size_t target = size_t(triangles.size() * ratio);
+
+        auto             tris = triangles;
+        auto             triWedges = triangleWedges;
+        auto             q = quadrics;
+        vector<bool>     deadTri(tris.size(), false);
+        vector<bool>     removed(positions.size(), false);
+        vector<uint32_t> version(positions.size(), 0);
+
+        vector<vector<uint32_t>> vertexTris(positions.size());
+        for (uint32_t t = 0; t < tris.size(); t++) {
+            for (auto v : tris[t]) vertexTris[v].push_back(t);
+        }
+
+        struct Candidate {
+            double   cost;
+            uint32_t from;
+            uint32_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            bool operator>(const Candidate & other) const {
+                return cost > other.cost;
+            }
+        };
+
+        std::priority_queue<Candidate, vector<Candidate>, std::greater<Candidate>>
+            heap;
+
+        // Collapse onto whichever end point has the lower error, seam
+        // vertices never move
+        auto pushEdge = [&](uint32_t a, uint32_t b) {
+            if (seam[a] && seam[b])
+                return;
+            Quadric sum = q[a];
+            sum.add(q[b]);
+            double toB = sum.error(positions[b]);
+            double toA = sum.error(positions[a]);
+            if (seam[b] || (!seam[a] && toB <= toA))
+                heap.push({toB, a, b, version[a], version[b]});
+            else
+                heap.push({toA, b, a, version[b], version[a]});
+        };
+
+        for (auto & tri : tris) {
+            for (int c = 0; c < 3; c++) {
+                if (tri[c] < tri[(c + 1) % 3])
+                    pushEdge(tri[c], tri[(c + 1) % 3]);
+            }
+        }
+
+        size_t live = tris.size();
+        while (live > target && !heap.empty()) {
+            Candidate c = heap.top();
+            heap.pop();
+
+            if (removed[c.from] || removed[c.to] || version[c.from] != c.fromVersion
+                || version[c.to] != c.toVersion)
+                continue;
+
+            // Reject collapses that flip a remaining triangle
+            bool flips = false;
+            for (auto t : vertexTris[c.from]) {
+                auto & tri = tris[t];
+                if (deadTri[t] || std::find(tri.begin(), tri.end(), c.to) != tri.end())
+                    continue;
+                vec3 p[3], moved[3];
+                for (int i = 0; i < 3; i++) {
+                    p[i] = positions[tri[i]];
+                    moved[i] = tri[i] == c.from ? positions[c.to] : p[i];
+                }
+                vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) <= 0) {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips)
+                continue;
+
+            // The moved corners take the wedge of c.to on their side of any
+            // seam through c.to, the one used by the collapsing triangles
+            uint32_t toWedge = positionWedge[c.to];
+            if (seam[c.to]) {
+                bool found = false;
+                bool mixed = false;
+                for (auto t : vertexTris[c.from]) {
+                    auto & tri = tris[t];
+                    auto   at = std::find(tri.begin(), tri.end(), c.to);
+                    if (deadTri[t] || at == tri.end())
+                        continue;
+                    uint32_t wedge = triWedges[t][at - tri.begin()];
+                    mixed |= found && wedge != toWedge;
+                    toWedge = wedge;
+                    found = true;
+                }
+                if (!found || mixed)
+                    continue;
+            }
+
+            for (auto t : vertexTris[c.from]) {
+                if (deadTri[t])
+                    continue;
+                auto & tri = tris[t];
+                if (std::find(tri.begin(), tri.end(), c.to) != tri.end()) {
+                    deadTri[t] = true;
+                    live--;
+                }
+                else {
+                    for (int i = 0; i < 3; i++) {
+                        if (tri[i] == c.from) {
+                            tri[i] = c.to;
+                            triWedges[t][i] = toWedge;
+                        }
+                    }
+                    vertexTris[c.to].push_back(t);
+                }
+            }
+            removed[c.from] = true;
+            vertexTris[c.from].clear();
+            q[c.to].add(q[c.from]);
+            version[c.to]++;
+
+            // Drop dead triangles and re-queue every edge around the kept
+            // vertex with its new quadric
+            auto & around = vertexTris[c.to];
+            around.erase(std::remove_if(around.begin(), around.end(),
+                                        [&](uint32_t t) { return deadTri[t]; }),
+                         around.end());
+            vector<uint32_t> neighbours;
+            for (auto t : around) {
+                for (auto v : tris[t]) {
+                    if (v != c.to
+                        && std::find(neighbours.begin(), neighbours.end(), v)
+                               == neighbours.end())
+                        neighbours.push_back(v);
+                }
+            }
+            for (auto v : neighbours) pushEdge(c.to, v);
+        }
+
+        vector<Vertex> result;
+        result.reserve(live * 3);
+        for (size_t t = 0; t < tris.size(); t++) {
+            if (deadTri[t])
+                continue;
+            for (auto w : triWedges[t]) result.push_back(wedges[w]);
+        }
+        return result;
+    }
+}
@@ -1,50 +1,436 @@
 #include "singe/Graphics/Model.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/MeshOptimizer.hpp"
+#include "singe/Graphics/MeshSimplifier.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/VertexPacker.hpp"
 
 namespace singe {
     using std::move;
 
-    Model::Model() : material(nullptr) {}
+    Model::Model()
+        : indexBuffer(0),
+          indexType(GL_UNSIGNED_INT),
+          indexCount(0),
+          boundsVersion(TransformCache::Unversioned),
+          lodLevel(0),
+          packedArray(0),
+          packedBuffer(0),
+          quantOffset(0),
+          quantScale(1),
+          indexBytes(0),
+          streamed(false),
+          streamArray(0),
+          material(nullptr),
+          format(Float),
+          lodHysteresis(0.1f) {}
 
     Model::Model(const vector<Vertex> & points)
-        : points(points), material(nullptr) {
+        : indexBuffer(0),
+          indexType(GL_UNSIGNED_INT),
+          indexCount(0),
+          boundsVersion(TransformCache::Unversioned),
+          lodLevel(0),
+          packedArray(0),
+          packedBuffer(0),
+          quantOffset(0),
+          quantScale(1),
+          indexBytes(0),
+          streamed(false),
+          streamArray(0),
+          points(points),
+          material(nullptr),
+          format(Float),
+          lodHysteresis(0.1f) {
         update();
     }
 
     Model::Model(vector<Vertex> && points)
-        : points(move(points)), material(nullptr) {
+        : indexBuffer(0),
+          indexType(GL_UNSIGNED_INT),
+          indexCount(0),
+          boundsVersion(TransformCache::Unversioned),
+          lodLevel(0),
+          packedArray(0),
+          packedBuffer(0),
+          quantOffset(0),
+          quantScale(1),
+          indexBytes(0),
+          streamed(false),
+          streamArray(0),
+          points(move(points)),
+          material(nullptr),
+          format(Float),
+          lodHysteresis(0.1f) {
         update();
     }
 
     Model::Model(Model && other)
         : points(move(other.points)),
+          indices(move(other.indices)),
           array(move(other.array)),
+          indexBuffer(other.indexBuffer),
+          indexType(other.indexType),
+          indexCount(other.indexCount),
+          bounds(other.bounds),
+          sphere(other.sphere),
+          boundsVersion(other.boundsVersion),
+          lodLevel(other.lodLevel),
+          packedArray(other.packedArray),
+          packedBuffer(other.packedBuffer),
+          quantOffset(other.quantOffset),
+          quantScale(other.quantScale),
+          indexBytes(other.indexBytes),
+          streamed(other.streamed),
+          streamArray(other.streamArray),
+          streamAllocation(other.streamAllocation),
           material(other.material),
-          transform(other.transform) {}
+          transform(other.transform),
+          format(other.format),
+          lods(move(other.lods)),
+          lodSizes(move(other.lodSizes)),
+          lodHysteresis(other.lodHysteresis) {
+        other.indexBuffer = 0;
+        other.indexCount = 0;
+        other.packedArray = 0;
+        other.packedBuffer = 0;
+        other.indexBytes = 0;
+        other.streamed = false;
+        other.streamArray = 0;
+        transformCache.takeBinding(other.transformCache, transform);
+    }
 
     Model & Model::operator=(Model && other) {
+        if (indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+        if (packedBuffer)
+            glDeleteBuffers(1, &packedBuffer);
+        if (packedArray)
+            glDeleteVertexArrays(1, &packedArray);
+        if (streamArray)
+            glDeleteVertexArrays(1, &streamArray);
         points = move(other.points);
+        indices = move(other.indices);
         array = move(other.array);
+        indexBuffer = other.indexBuffer;
+        indexType = other.indexType;
+        indexCount = other.indexCount;
+        other.indexBuffer = 0;
+        other.indexCount = 0;
+        packedArray = other.packedArray;
+        packedBuffer = other.packedBuffer;
+        quantOffset = other.quantOffset;
+        quantScale = other.quantScale;
+        indexBytes = other.indexBytes;
+        streamed = other.streamed;
+        streamArray = other.streamArray;
+        transformCache.takeBinding(other.transformCache, transform);
+        streamAllocation = other.streamAllocation;
+        other.packedArray = 0;
+        other.packedBuffer = 0;
+        other.indexBytes = 0;
+        other.streamed = false;
+        other.streamArray = 0;
+        bounds = other.bounds;
+        sphere = other.sphere;
+        boundsVersion = other.boundsVersion;
+        lodLevel = other.lodLevel;
         material = other.material;
         transform = other.transform;
+        format = other.format;
+        lods = move(other.lods);
+        lodSizes = move(other.lodSizes);
+        lodHysteresis = other.lodHysteresis;
         return *this;
     }
 
-    Model::~Model() {}
+    Model::~Model() {
+        if (indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+        if (packedBuffer)
+            glDeleteBuffers(1, &packedBuffer);
+        if (packedArray)
+            glDeleteVertexArrays(1, &packedArray);
+        if (streamArray)
+            glDeleteVertexArrays(1, &streamArray);
+    }
 
     void Model::update(Buffer::Usage usage) {
-        array.bufferData(points, usage);
-        array.unbind();
+        GLenum glUsage = usage == Buffer::Dynamic ? GL_DYNAMIC_DRAW
+                                                  : GL_STATIC_DRAW;
+
+        streamed = usage == Buffer::Dynamic && format == Float;
+        if (format == Packed) {
+            updatePacked(glUsage);
+            // Only the packed buffer is drawn, drop the float copy
+            array.bufferData({}, usage);
+            array.unbind();
+        }
+        else if (streamed) {
+            streamPoints();
+        }
+        else {
+            array.bufferData(points, usage);
+            array.unbind();
+        }
+
+        indexCount = indices.size();
+        if (!indices.empty()) {
+            if (!indexBuffer)
+                glGenBuffers(1, &indexBuffer);
+
+            bool   shortIndices = points.size() <= 0x10000;
+            size_t bytes = indices.size()
+                           * (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t));
+            vector<uint16_t> packed;
+            const void *     data = indices.data();
+            if (shortIndices) {
+                packed.assign(indices.begin(), indices.end());
+                data = packed.data();
+            }
+            indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+            // The element buffer binding is part of the vertex array state.
+            // Dynamic indices of the same size are written in place rather
+            // than reallocating the buffer
+            bindVertexArray();
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+            if (usage == Buffer::Dynamic && bytes == indexBytes)
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, bytes, data);
+            else
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, bytes, data, glUsage);
+            indexBytes = bytes;
+            StateCache::current().bindVertexArray(0);
+        }
+
+        updateBounds();
+    }
+
+    void Model::streamPoints() const {
+        auto & stream = StreamBuffer::current();
+        size_t bytes = points.size() * sizeof(Vertex);
+        streamAllocation = stream.allocate(bytes, sizeof(Vertex));
+        std::memcpy(streamAllocation.data, points.data(), bytes);
+        stream.commit(streamAllocation);
+
+        if (!streamArray)
+            glGenVertexArrays(1, &streamArray);
+
+        // The points move around the ring, so the attributes point at the
+        // allocation rather than drawing with a base vertex
+        StateCache::current().bindVertexArray(streamArray);
+        glBindBuffer(GL_ARRAY_BUFFER, streamAllocation.buffer);
+        auto attribute = [&](GLuint location, GLint size, size_t offset) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(
+                location, size, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                (const void *)(streamAllocation.offset + offset));
+        };
+        // Same locations as glpp::extra::VertexBufferArray
+        attribute(0, 3, offsetof(Vertex, pos));
+        attribute(1, 3, offsetof(Vertex, norm));
+        attribute(2, 2, offsetof(Vertex, uv));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Model::updatePacked(GLenum usage) {
+        AABB box;
+        for (auto & point : points) box.expand(point.pos);
+        VertexPacker packer(box);
+        quantOffset = packer.getOffset();
+        quantScale = packer.getScale();
+
+        vector<PackedVertex> packed;
+        packed.reserve(points.size());
+        for (auto & point : points) packed.push_back(packer.pack(point));
+
+        bool setup = packedArray == 0;
+        if (setup) {
+            glGenVertexArrays(1, &packedArray);
+            glGenBuffers(1, &packedBuffer);
+        }
+
+        StateCache::current().bindVertexArray(packedArray);
+        glBindBuffer(GL_ARRAY_BUFFER, packedBuffer);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex),
+                     packed.data(), usage);
+
+        if (setup) {
+            // Same locations as glpp::extra::VertexBufferArray
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                                  sizeof(PackedVertex),
+                                  (const void *)offsetof(PackedVertex, pos));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex),
+                                  (const void *)offsetof(PackedVertex, normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE,
+                                  sizeof(PackedVertex),
+                                  (const void *)offsetof(PackedVertex, uv));
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        StateCache::current().bindVertexArray(0);
+    }
+
+    void Model::bindVertexArray() const {
+        if (format == Packed) {
+            StateCache::current().bindVertexArray(packedArray);
+        }
+        else if (streamed) {
+            if (!StreamBuffer::current().valid(streamAllocation))
+                streamPoints();
+            StateCache::current().bindVertexArray(streamArray);
+        }
+        else {
+            array.bind();
+            StateCache::current().invalidateVertexArray();
+        }
+    }
+
+    void Model::applyFormat(RenderState & state) const {
+        state.setVertexDecode(format == Packed, quantOffset, quantScale);
+    }
+
+    void Model::optimize() {
+        if (indices.empty())
+            indices = MeshOptimizer::weld(points);
+        MeshOptimizer::optimizeVertexCache(indices, points.size());
+        MeshOptimizer::optimizeVertexFetch(points, indices);
+    }
+
+    void Model::updateBounds() {
+        boundsVersion = TransformCache::nextVersion();
+        bounds = AABB();
+        for (auto & point : points) bounds.expand(point.pos);
+
+        // Radius from the box center to the furthest point is tighter than
+        // the half diagonal of the box
+        sphere = BoundingSphere(bounds.center(), 0);
+        float radius2 = 0;
+        for (auto & point : points) {
+            vec3 d = point.pos - sphere.center;
+            radius2 = std::max(radius2, glm::dot(d, d));
+        }
+        sphere.radius = std::sqrt(radius2);
+    }
+
+    const mat4 & Model::getLocalMatrix() const {
+        return transformCache.getLocal(transform);
+    }
+
+    const mat4 & Model::getWorldMatrix(const mat4 & parent,
+                                       uint64_t     parentVersion) const {
+        return transformCache.getWorld(transform, parent, parentVersion);
+    }
+
+    void Model::bindTransformStore(TransformStore * store,
+                                   uint32_t         node) const {
+        transformCache.bind(store, node, transform);
+    }
+
+    uint64_t Model::getWorldVersion() const {
+        return transformCache.getVersion();
+    }
+
+    const AABB & Model::getBounds() const {
+        return bounds;
+    }
+
+    uint64_t Model::getBoundsVersion() const {
+        return boundsVersion;
+    }
+
+    size_t Model::getDrawCount() const {
+        return indexCount ? indexCount : points.size();
+    }
+
+    const BoundingSphere & Model::getBoundingSphere() const {
+        return sphere;
+    }
+
+    void Model::generateLods(const vector<float> & ratios,
+                             const vector<float> & sizes) {
+        MeshSimplifier simplifier(points, indices);
+
+        lods.clear();
+        lodSizes.clear();
+        lodLevel = 0;
+        for (size_t i = 0; i < ratios.size() && i < sizes.size(); i++) {
+            auto lod = std::make_shared<Model>();
+            lod->format = format;
+            lod->points = simplifier.simplify(ratios[i]);
+            size_t triangles = lod->points.size() / 3;
+            lod->optimize();
+            lod->update();
+            lod->material = material;
+            Logging::Graphics->debug("Lod {} has {} of {} triangles", i + 1,
+                                     triangles, simplifier.triangleCount());
+            lods.emplace_back(lod);
+            lodSizes.push_back(sizes[i]);
+        }
+    }
+
+    float Model::screenSize(const mat4 & world,
+                            const mat4 & projection,
+                            const mat4 & view) const {
+        BoundingSphere s = sphere.transformed(world);
+        float distance = glm::length(glm::vec3(view * glm::vec4(s.center, 1.0f)));
+        if (distance <= s.radius)
+            return std::numeric_limits<float>::infinity();
+        // projection[1][1] is cot(fov / 2) which maps view height to [-1, 1]
+        return s.radius * projection[1][1] / distance;
+    }
+
+    const Model & Model::selectLod(const mat4 & world,
+                                   const mat4 & projection,
+                                   const mat4 & view) const {
+        if (lods.empty())
+            return *this;
+
+        float  size = screenSize(world, projection, view);
+        size_t level = std::min(lodLevel, lods.size());
+
+        // Lower detail once clearly below the next size, higher detail once
+        // clearly above the current size
+        while (level < lods.size()
+               && size < lodSizes[level] * (1.0f - lodHysteresis))
+            level++;
+        while (level > 0 && size > lodSizes[level - 1] * (1.0f + lodHysteresis))
+            level--;
+
+        lodLevel = level;
+        return level == 0 ? *this : *lods[level - 1];
     }
 
     void Model::draw(RenderState state) const {
-        state.pushTransform(transform);
+        state.setModel(getWorldMatrix(state.getModel(), state.getModelVersion()),
+                       getLocalMatrix(), getWorldVersion());
+        auto & mesh =
+            selectLod(state.getModel(), state.getProjection(), state.getView());
+        mesh.applyFormat(state);
         if (material) {
             material->bind();
             if (material->shader)
                 material->shader->bind(state);
         }
-        array.drawArrays(Buffer::Triangles, 0, points.size());
+        mesh.drawMesh();
+    }
+
+    void Model::drawMesh() const {
+        bindVertexArray();
+        if (indexCount)
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, nullptr);
+        else
+            glDrawArrays(GL_TRIANGLES, 0, points.size());
     }
 }
@@ -0,0 +1,271 @@
+#include "singe/Graphics/OcclusionCuller.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+#include <memory>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using glm::vec4;
+
+    static const char * kVertexSource = R"(#version 330 core
+layout(location = 0) in vec3 pos;
+uniform mat4 mvp;
+void main() {
+    gl_Position = mvp * vec4(pos, 1.0);
+}
+)";
+
+    static const char * kFragmentSource = R"(#version 330 core
+out vec4 color;
+void main() {
+    color = vec4(1.0);
+}
+)";
+
+    /// Corners of a cube from -1 to 1, index bits are x, y, z
+    static const GLfloat kCubeCorners[] = {
+        -1, -1, -1, 1, -1, -1, -1, 1, -1, 1, 1, -1,
+        -1, -1, 1,  1, -1, 1,  -1, 1, 1,  1, 1, 1,
+    };
+
+    /// Counter clockwise triangles facing out of the cube
+    static const GLubyte kCubeIndices[] = {
+        0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5, 0, 1, 5, 0, 5, 4,
+        2, 6, 7, 2, 7, 3, 0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6,
+    };
+
+    OcclusionCuller::Stats::Stats() : queries(0), rejected(0), conditional(0) {}
+
+    OcclusionCuller::OcclusionCuller()
+        : frame(0),
+          cameraPos(0),
+          program(0),
+          mvpLocation(-1),
+          vertexArray(0),
+          vertexBuffer(0),
+          indexBuffer(0) {}
+
+    OcclusionCuller::OcclusionCuller(OcclusionCuller && other)
+        : objects(move(other.objects)),
+          slots(move(other.slots)),
+          candidates(move(other.candidates)),
+          frame(other.frame),
+          cameraPos(other.cameraPos),
+          stats(other.stats),
+          program(other.program),
+          mvpLocation(other.mvpLocation),
+          vertexArray(other.vertexArray),
+          vertexBuffer(other.vertexBuffer),
+          indexBuffer(other.indexBuffer) {
+        other.program = 0;
+        other.vertexArray = 0;
+        other.vertexBuffer = 0;
+        other.indexBuffer = 0;
+    }
+
+    OcclusionCuller & OcclusionCuller::operator=(OcclusionCuller && other) {
+        release();
+        objects = move(other.objects);
+        slots = move(other.slots);
+        candidates = move(other.candidates);
+        frame = other.frame;
+        cameraPos = other.cameraPos;
+        stats = other.stats;
+        program = other.program;
+        mvpLocation = other.mvpLocation;
+        vertexArray = other.vertexArray;
+        vertexBuffer = other.vertexBuffer;
+        indexBuffer = other.indexBuffer;
+        other.program = 0;
+        other.vertexArray = 0;
+        other.vertexBuffer = 0;
+        other.indexBuffer = 0;
+        return *this;
+    }
+
+    OcclusionCuller::~OcclusionCuller() {
+        release();
+    }
+
+    void OcclusionCuller::release() {
+        clear();
+        if (program)
+            glDeleteProgram(program);
+        if (vertexArray)
+            glDeleteVertexArrays(1, &vertexArray);
+        GLuint buffers[] = {vertexBuffer, indexBuffer};
+        glDeleteBuffers(2, buffers);
+        program = 0;
+        vertexArray = 0;
+        vertexBuffer = 0;
+        indexBuffer = 0;
+    }
+
+    void OcclusionCuller::setup() {
+        program =
+            GlUtil::linkProgram(kVertexSource, kFragmentSource, "Occlusion");
+        mvpLocation = glGetUniformLocation(program, "mvp");
+
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+
+        auto & cache = StateCache::current();
+        cache.bindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(kCubeCorners), kCubeCorners,
+                     GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat),
+                              nullptr);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(kCubeIndices),
+                     kCubeIndices, GL_STATIC_DRAW);
+        cache.bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void OcclusionCuller::clear() {
+        for (auto & object : objects) glDeleteQueries(1, &object.query);
+        objects.clear();
+        slots.clear();
+        candidates.clear();
+    }
+
+    void OcclusionCuller::beginFrame(const RenderState & state) {
+        frame++;
+        stats = Stats();
+        candidates.clear();
+        cameraPos = vec3(glm::inverse(state.getView())[3]);
+
+        for (auto & object : objects) {
+            if (!object.pending)
+                continue;
+            GLuint available = 0;
+            glGetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE,
+                                &available);
+            if (!available)
+                continue;
+            GLuint passed = 0;
+            glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &passed);
+            object.visible = passed != 0;
+            object.pending = false;
+        }
+    }
+
+    uint32_t OcclusionCuller::acquire(const Model & model, const mat4 & world) {
+        Slot & slot = slots[&model];
+        if (slot.frame != frame) {
+            slot.frame = frame;
+            slot.used = 0;
+        }
+
+        if (slot.used == slot.objects.size()) {
+            Object object {};
+            glGenQueries(1, &object.query);
+            object.visible = true;
+            slot.objects.push_back(objects.size());
+            objects.push_back(object);
+        }
+
+        uint32_t id = slot.objects[slot.used++];
+        Object & object = objects[id];
+        object.model = &model;
+        object.world = world;
+
+        // The box is clipped by the near plane when the camera is inside it
+        // so the query would fail, always draw these instead
+        AABB box = model.getBounds().transformed(world);
+        vec3 pad = (box.max - box.min) * 0.05f + vec3(0.1f);
+        object.inside = AABB(box.min - pad, box.max + pad).contains(
+            AABB(cameraPos, cameraPos));
+
+        candidates.push_back(id);
+        return id;
+    }
+
+    bool OcclusionCuller::beginDraw(uint32_t id) {
+        Object & object = objects[id];
+        if (object.inside)
+            return true;
+
+        if (!object.pending) {
+            if (!object.visible)
+                stats.rejected++;
+            return object.visible;
+        }
+
+        // The result is not back yet, let the GPU skip the draw if it is
+        glBeginConditionalRender(object.query, GL_QUERY_NO_WAIT);
+        object.conditional = true;
+        stats.conditional++;
+        return true;
+    }
+
+    void OcclusionCuller::endDraw(uint32_t id) {
+        Object & object = objects[id];
+        if (object.conditional) {
+            glEndConditionalRender();
+            object.conditional = false;
+        }
+    }
+
+    void OcclusionCuller::endFrame(const RenderState & state) {
+        if (candidates.empty())
+            return;
+        if (!program)
+            setup();
+
+        auto & cache = StateCache::current();
+        cache.useProgram(program);
+        cache.bindVertexArray(vertexArray);
+        cache.depthMask(false);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+        mat4 vp = state.getProjection() * state.getView();
+        for (uint32_t id : candidates) {
+            Object & object = objects[id];
+            if (object.inside) {
+                object.visible = true;
+                continue;
+            }
+            // Waiting on the last query, a new one would lose its result
+            if (object.pending)
+                continue;
+
+            // Scale and move the unit cube to the model bounds
+            const AABB & bounds = object.model->getBounds();
+            if (bounds.empty())
+                continue;
+            vec3 center = bounds.center();
+            vec3 extent = bounds.extent();
+            mat4 box(1);
+            box[0][0] = extent.x;
+            box[1][1] = extent.y;
+            box[2][2] = extent.z;
+            box[3] = vec4(center, 1.0f);
+
+            mat4 mvp = vp * object.world * box;
+            glUniformMatrix4fv(mvpLocation, 1, GL_FALSE, glm::value_ptr(mvp));
+
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, object.query);
+            glDrawElements(GL_TRIANGLES, sizeof(kCubeIndices), GL_UNSIGNED_BYTE,
+                           nullptr);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+            object.pending = true;
+            stats.queries++;
+        }
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        cache.depthMask(true);
+        cache.bindVertexArray(0);
+    }
+
+    const OcclusionCuller::Stats & OcclusionCuller::getStats() const {
+        return stats;
+    }
+}
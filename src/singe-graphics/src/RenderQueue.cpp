@@ -0,0 +1,413 @@
+#include "singe/Graphics/RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <singe/Support/Profiler.hpp>
+
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/UniformBuffers.hpp"
+
+namespace singe {
+    using std::move;
+
+    // Key layout, most significant bits first
+    //
+    // Opaque:  pass(2) shader(10) textureSet(14) material(14) depth(24)
+    // Blended: pass(2) ~depth(24) shader(10) textureSet(14) material(14)
+    //
+    // Texture sets sort before materials so materials sharing texture
+    // arrays are drawn together without rebinding
+    static constexpr int kPassBits = 2;
+    static constexpr int kShaderBits = 10;
+    static constexpr int kMaterialBits = 14;
+    static constexpr int kTextureSetBits = 14;
+    static constexpr int kDepthBits = 24;
+
+    static constexpr uint64_t mask(int bits) {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    /**
+     * Quantize a positive distance to kDepthBits. The bit pattern of a
+     * positive float increases with its value so the top bits can be used
+     * directly without knowing the far plane.
+     */
+    static uint64_t depthBits(float depth) {
+        if (!(depth > 0))
+            depth = 0;
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> (31 - kDepthBits)) & mask(kDepthBits);
+    }
+
+    RenderQueue::Stats::Stats()
+        : draws(0),
+          vertices(0),
+          shaderBinds(0),
+          materialBinds(0),
+          textureBinds(0),
+          culled(0),
+          prepassDraws(0) {}
+
+    RenderQueue::RenderQueue()
+        : sorted(true), sortBlended(true), depthPrepass(false) {}
+
+    RenderQueue::RenderQueue(RenderQueue && other)
+        : items(move(other.items)),
+          entries(move(other.entries)),
+          scratch(move(other.scratch)),
+          occlusionIds(move(other.occlusionIds)),
+          meshes(move(other.meshes)),
+          drawOffsets(move(other.drawOffsets)),
+          sorted(other.sorted),
+          sortBlended(other.sortBlended),
+          depthPrepass(other.depthPrepass),
+          depthProgram(move(other.depthProgram)),
+          stats(other.stats),
+          shaderIds(move(other.shaderIds)),
+          materialIds(move(other.materialIds)),
+          textureSetIds(move(other.textureSetIds)) {}
+
+    RenderQueue & RenderQueue::operator=(RenderQueue && other) {
+        items = move(other.items);
+        entries = move(other.entries);
+        scratch = move(other.scratch);
+        occlusionIds = move(other.occlusionIds);
+        meshes = move(other.meshes);
+        drawOffsets = move(other.drawOffsets);
+        sorted = other.sorted;
+        sortBlended = other.sortBlended;
+        depthPrepass = other.depthPrepass;
+        depthProgram = move(other.depthProgram);
+        stats = other.stats;
+        shaderIds = move(other.shaderIds);
+        materialIds = move(other.materialIds);
+        textureSetIds = move(other.textureSetIds);
+        return *this;
+    }
+
+    RenderQueue::~RenderQueue() {}
+
+    uint32_t RenderQueue::shaderId(const Shader * shader) {
+        auto it = shaderIds.find(shader);
+        if (it != shaderIds.end())
+            return it->second;
+        uint32_t id = shaderIds.size();
+        shaderIds[shader] = id;
+        return id;
+    }
+
+    uint32_t RenderQueue::materialId(const Material * material) {
+        auto it = materialIds.find(material);
+        if (it != materialIds.end())
+            return it->second;
+        uint32_t id = materialIds.size();
+        materialIds[material] = id;
+        return id;
+    }
+
+    uint32_t RenderQueue::textureSetId(const Material * material) {
+        std::array<const void *, 3> set {nullptr, nullptr, nullptr};
+        if (material) {
+            for (size_t unit = 0; unit < set.size(); unit++)
+                set[unit] = material->boundTexture(unit);
+        }
+        auto it = textureSetIds.find(set);
+        if (it != textureSetIds.end())
+            return it->second;
+        uint32_t id = textureSetIds.size();
+        textureSetIds[set] = id;
+        return id;
+    }
+
+    void RenderQueue::clear() {
+        items.clear();
+        entries.clear();
+        sorted = true;
+        stats = Stats();
+    }
+
+    size_t RenderQueue::size() const {
+        return items.size();
+    }
+
+    void RenderQueue::setSortBlended(bool sort) {
+        sortBlended = sort;
+    }
+
+    bool RenderQueue::getSortBlended() const {
+        return sortBlended;
+    }
+
+    void RenderQueue::setDepthPrepass(bool prepass) {
+        depthPrepass = prepass;
+    }
+
+    bool RenderQueue::getDepthPrepass() const {
+        return depthPrepass;
+    }
+
+    void RenderQueue::addCulled(size_t count) {
+        stats.culled += count;
+    }
+
+    void RenderQueue::push(const Model & model, const RenderState & state) {
+        push(model, state.getModel(), state.getLocal(), state.getView());
+    }
+
+    void RenderQueue::push(const Model & model,
+                           const mat4 &  world,
+                           const mat4 &  local,
+                           const mat4 &  view) {
+        const Material * material = model.material.get();
+        const Shader *   shader = material ? material->shader.get() : nullptr;
+
+        Pass pass = material && material->alpha < 1.0f ? Blended : Opaque;
+
+        // Distance along the view direction to the model origin
+        glm::vec4 origin = view * world[3];
+        float     depth = -origin.z;
+
+        uint32_t textureSet = textureSetId(material);
+        uint64_t key;
+        if (pass == Blended && !sortBlended) {
+            // Opaque layout with the blended pass bits, grouped by state
+            key = makeKey(Opaque, shaderId(shader), materialId(material),
+                          textureSet, depth)
+                  | uint64_t(Blended) << (64 - kPassBits);
+        }
+        else {
+            key = makeKey(pass, shaderId(shader), materialId(material),
+                          textureSet, depth);
+        }
+
+        entries.push_back({key, static_cast<uint32_t>(items.size())});
+        items.push_back({&model, world, local, textureSet});
+        sorted = false;
+    }
+
+    void RenderQueue::sort() {
+        if (sorted)
+            return;
+        SINGE_PROFILE_SCOPE("RenderQueue::sort");
+
+        // LSD radix sort, 8 bits per pass
+        scratch.resize(entries.size());
+        for (int shift = 0; shift < 64; shift += 8) {
+            size_t count[256] = {0};
+            for (auto & entry : entries) count[(entry.key >> shift) & 0xff]++;
+
+            // All keys share this byte so the pass would not change the order
+            if (count[(entries.front().key >> shift) & 0xff] == entries.size())
+                continue;
+
+            size_t offset = 0;
+            for (auto & c : count) {
+                size_t n = c;
+                c = offset;
+                offset += n;
+            }
+
+            for (auto & entry : entries)
+                scratch[count[(entry.key >> shift) & 0xff]++] = entry;
+
+            entries.swap(scratch);
+        }
+
+        sorted = true;
+    }
+
+    void RenderQueue::submit(const RenderState & state,
+                             OcclusionCuller *   occlusion) {
+        sort();
+        submitRange(state, 0, entries.size(), occlusion);
+    }
+
+    void RenderQueue::submit(const RenderState & state, Pass pass) {
+        sort();
+
+        // The pass is the top of the key so each pass is one sorted run
+        auto passOf = [](const SortEntry & entry) {
+            return Pass(entry.key >> (64 - kPassBits));
+        };
+        auto first = std::partition_point(
+            entries.begin(), entries.end(),
+            [&](const SortEntry & entry) { return passOf(entry) < pass; });
+        auto last = std::partition_point(
+            first, entries.end(),
+            [&](const SortEntry & entry) { return passOf(entry) == pass; });
+        submitRange(state, first - entries.begin(), last - entries.begin(),
+                    nullptr);
+    }
+
+    void RenderQueue::submitRange(const RenderState & state,
+                                  size_t              first,
+                                  size_t              last,
+                                  OcclusionCuller *   occlusion) {
+        SINGE_PROFILE_SCOPE("RenderQueue::submit");
+        // Acquire in push order which is stable between frames, unlike the
+        // sorted order which changes with depth
+        if (occlusion) {
+            occlusion->beginFrame(state);
+            occlusionIds.resize(items.size());
+            for (size_t i = 0; i < items.size(); i++)
+                occlusionIds[i] = occlusion->acquire(*items[i].model,
+                                                     items[i].world);
+        }
+
+        // Choose lods and stage the Draw block of every item using it, so
+        // the whole frame is uploaded in one call
+        auto & uniforms = UniformBuffers::current();
+        uniforms.setFrame(state);
+        meshes.resize(entries.size());
+        drawOffsets.assign(entries.size(), -1);
+        for (size_t i = first; i < last; i++) {
+            const Item & item = items[entries[i].index];
+            meshes[i] = &item.model->selectLod(item.world, state.getProjection(),
+                                               state.getView());
+
+            const Material * material = item.model->material.get();
+            if (!material || !material->shader
+                || !material->shader->usesDrawBlock())
+                continue;
+
+            RenderState itemState = state;
+            itemState.setModel(item.world, item.local,
+                               TransformCache::Unversioned);
+            meshes[i]->applyFormat(itemState);
+            drawOffsets[i] = uniforms.addDraw(itemState);
+        }
+        GLintptr drawBase = uniforms.uploadDraws();
+        size_t   drawStride = uniforms.getDrawStride();
+
+        // Opaque entries sort first so they are a run at the start
+        size_t opaqueEnd = first;
+        while (opaqueEnd < last
+               && entries[opaqueEnd].key >> (64 - kPassBits) == Opaque)
+            opaqueEnd++;
+
+        auto & cache = StateCache::current();
+        bool   prepass = depthPrepass && opaqueEnd > first;
+        if (prepass) {
+            GpuProfiler::Scope scope("Depth Prepass");
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            cache.depthMask(true);
+            cache.depthFunc(GL_LEQUAL);
+            for (size_t i = first; i < opaqueEnd; i++) {
+                const Item & item = items[entries[i].index];
+                // Same product as RenderState::getMVP() so depth matches
+                depthProgram.draw(*meshes[i], state.getVP() * item.world);
+                stats.prepassDraws++;
+            }
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            // Depth is final, only shade the front most fragment
+            cache.depthFunc(GL_EQUAL);
+            cache.depthMask(false);
+        }
+
+        const Shader *   lastShader = nullptr;
+        const Material * lastMaterial = nullptr;
+        uint32_t         lastTextureSet = ~uint32_t(0);
+
+        for (size_t i = first; i < last; i++) {
+            const SortEntry & entry = entries[i];
+            const Item &      item = items[entry.index];
+            const Material *  material = item.model->material.get();
+
+            if (prepass && i == opaqueEnd) {
+                cache.depthFunc(GL_LEQUAL);
+                cache.depthMask(true);
+            }
+
+            if (occlusion && !occlusion->beginDraw(occlusionIds[entry.index]))
+                continue;
+
+            // Copy so projection * view is not multiplied again per item
+            RenderState itemState = state;
+            itemState.setModel(item.world, item.local,
+                               TransformCache::Unversioned);
+
+            const Model & mesh = *meshes[i];
+            mesh.applyFormat(itemState);
+            if (drawOffsets[i] >= 0)
+                itemState.setDrawOffset(drawBase + drawOffsets[i] * drawStride);
+
+            if (material) {
+                const Shader * shader = material->shader.get();
+
+                if (material != lastMaterial) {
+                    stats.materialBinds++;
+                    lastMaterial = material;
+
+                    if (item.textureSet != lastTextureSet) {
+                        material->bindTextures();
+                        stats.textureBinds++;
+                        lastTextureSet = item.textureSet;
+                    }
+                    else {
+                        material->applyLayers();
+                    }
+                }
+
+                if (shader) {
+                    if (shader != lastShader) {
+                        shader->bind(itemState);
+                        stats.shaderBinds++;
+                        lastShader = shader;
+                    }
+                    else {
+                        shader->apply(itemState);
+                    }
+                }
+            }
+
+            mesh.drawMesh();
+            stats.draws++;
+            stats.vertices += mesh.getDrawCount();
+
+            if (occlusion)
+                occlusion->endDraw(occlusionIds[entry.index]);
+        }
+
+        if (prepass && opaqueEnd == last) {
+            cache.depthFunc(GL_LEQUAL);
+            cache.depthMask(true);
+        }
+
+        if (occlusion)
+            occlusion->endFrame(state);
+    }
+
+    const RenderQueue::Stats & RenderQueue::getStats() const {
+        return stats;
+    }
+
+    uint64_t RenderQueue::makeKey(Pass     pass,
+                                  uint32_t shader,
+                                  uint32_t material,
+                                  uint32_t textureSet,
+                                  float    depth) {
+        uint64_t state = (uint64_t(shader) & mask(kShaderBits))
+                             << (kTextureSetBits + kMaterialBits)
+                         | (uint64_t(textureSet) & mask(kTextureSetBits))
+                               << kMaterialBits
+                         | (uint64_t(material) & mask(kMaterialBits));
+        uint64_t key = uint64_t(pass) << (64 - kPassBits);
+
+        if (pass == Blended) {
+            // Back-to-front, depth is more significant than state
+            uint64_t far = mask(kDepthBits) - depthBits(depth);
+            key |= far << (kShaderBits + kMaterialBits + kTextureSetBits);
+            key |= state;
+        }
+        else {
+            // Group by state, then front-to-back
+            key |= state << kDepthBits;
+            key |= depthBits(depth);
+        }
+
+        return key;
+    }
+}
@@ -2,7 +2,18 @@
 
 namespace singe {
     RenderState::RenderState()
-        : projection(1), view(1), model(1), local(1), drawGrid(false) {}
+        : projection(1),
+          view(1),
+          vp(1),
+          model(1),
+          local(1),
+          modelVersion(TransformCache::Unversioned),
+          drawGrid(false),
+          cull(false),
+          packed(false),
+          positionOffset(0),
+          positionScale(1),
+          drawOffset(-1) {}
 
     RenderState::RenderState(const mat4 & projection,
                              const mat4 & view,
@@ -11,9 +22,16 @@ namespace singe {
                              bool         drawGrid)
         : projection(projection),
           view(view),
+          vp(projection * view),
           model(model),
           local(local),
-          drawGrid(drawGrid) {}
+          modelVersion(TransformCache::Unversioned),
+          drawGrid(drawGrid),
+          cull(false),
+          packed(false),
+          positionOffset(0),
+          positionScale(1),
+          drawOffset(-1) {}
 
     RenderState::RenderState(const Camera & camera,
                              const mat4 &   model,
@@ -21,9 +39,16 @@ namespace singe {
                              bool           drawGrid)
         : projection(camera.projMatrix()),
           view(camera.viewMatrix()),
+          vp(projection * view),
           model(model),
           local(local),
-          drawGrid(drawGrid) {}
+          modelVersion(TransformCache::Unversioned),
+          drawGrid(drawGrid),
+          cull(false),
+          packed(false),
+          positionOffset(0),
+          positionScale(1),
+          drawOffset(-1) {}
 
     RenderState::~RenderState() {}
 
@@ -35,12 +60,61 @@ namespace singe {
         drawGrid = enabled;
     }
 
-    mat4 RenderState::getVP() const {
-        return projection * view;
+    bool RenderState::getCullEnable() const {
+        return cull;
+    }
+
+    void RenderState::setCullEnable(bool enabled) {
+        cull = enabled;
+    }
+
+    bool RenderState::getPacked() const {
+        return packed;
+    }
+
+    const vec3 & RenderState::getPositionOffset() const {
+        return positionOffset;
+    }
+
+    const vec3 & RenderState::getPositionScale() const {
+        return positionScale;
+    }
+
+    void RenderState::setVertexDecode(bool         packed,
+                                      const vec3 & offset,
+                                      const vec3 & scale) {
+        this->packed = packed;
+        positionOffset = offset;
+        positionScale = scale;
+        drawOffset = -1;
+    }
+
+    int64_t RenderState::getDrawOffset() const {
+        return drawOffset;
+    }
+
+    void RenderState::setDrawOffset(int64_t offset) {
+        drawOffset = offset;
+    }
+
+    Frustum RenderState::getFrustum() const {
+        return Frustum(vp);
+    }
+
+    const mat4 & RenderState::getProjection() const {
+        return projection;
+    }
+
+    const mat4 & RenderState::getView() const {
+        return view;
+    }
+
+    const mat4 & RenderState::getVP() const {
+        return vp;
     }
 
     mat4 RenderState::getMVP() const {
-        return getVP() * model;
+        return vp * model;
     }
 
     const mat4 & RenderState::getModel() const {
@@ -51,6 +125,19 @@ namespace singe {
         return local;
     }
 
+    uint64_t RenderState::getModelVersion() const {
+        return modelVersion;
+    }
+
+    void RenderState::setModel(const mat4 & model,
+                               const mat4 & local,
+                               uint64_t     version) {
+        this->model = model;
+        this->local = local;
+        modelVersion = version;
+        drawOffset = -1;
+    }
+
     void RenderState::pushTransform(const Transform & transform) {
         pushTransform(transform.toMatrix());
     }
@@ -58,5 +145,7 @@ namespace singe {
     void RenderState::pushTransform(const mat4 & matrix) {
         model *= matrix;
         local = matrix;
+        modelVersion = TransformCache::Unversioned;
+        drawOffset = -1;
     }
 }
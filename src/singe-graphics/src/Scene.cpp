@@ -1,24 +1,45 @@
 #include "singe/Graphics/Scene.hpp"
 
+#include <algorithm>
 #include <memory>
+#include <singe/Support/Profiler.hpp>
+
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/StateCache.hpp"
 
 namespace singe {
     using std::make_shared;
     using std::move;
 
-    Scene::Scene() {}
+    Scene::Scene()
+        : depthPrepass(false),
+          boundsVersion(TransformCache::Unversioned),
+          boundsItems(0) {}
 
     Scene::Scene(Scene && other)
         : children(move(other.children)),
           models(move(other.models)),
+          lights(move(other.lights)),
           transform(move(other.transform)),
-          grid(move(other.grid)) {}
+          grid(move(other.grid)),
+          depthPrepass(other.depthPrepass),
+          worldBounds(other.worldBounds),
+          boundsVersion(other.boundsVersion),
+          boundsItems(other.boundsItems) {
+        transformCache.takeBinding(other.transformCache, transform);
+    }
 
     Scene & Scene::operator=(Scene && other) {
         children = move(other.children);
         models = move(other.models);
+        lights = move(other.lights);
         transform = move(other.transform);
         grid = move(other.grid);
+        depthPrepass = other.depthPrepass;
+        worldBounds = other.worldBounds;
+        boundsVersion = other.boundsVersion;
+        boundsItems = other.boundsItems;
+        transformCache.takeBinding(other.transformCache, transform);
         return *this;
     }
 
@@ -32,11 +53,143 @@ namespace singe {
         return models.emplace_back(make_shared<Model>());
     }
 
-    void Scene::draw(RenderState state) const {
-        state.pushTransform(transform);
-        if (grid && state.getGridEnable())
+    const mat4 & Scene::getLocalMatrix() const {
+        return transformCache.getLocal(transform);
+    }
+
+    const mat4 & Scene::getWorldMatrix(const mat4 & parent,
+                                       uint64_t     parentVersion) const {
+        return transformCache.getWorld(transform, parent, parentVersion);
+    }
+
+    void Scene::bindTransformStore(TransformStore * store,
+                                   uint32_t         node) const {
+        transformCache.bind(store, node, transform);
+    }
+
+    uint64_t Scene::getWorldVersion() const {
+        return transformCache.getVersion();
+    }
+
+    const AABB & Scene::getBounds() const {
+        return worldBounds;
+    }
+
+    uint64_t Scene::updateBounds(const mat4 & parent,
+                                 uint64_t     parentVersion) const {
+        const mat4 & world = getWorldMatrix(parent, parentVersion);
+        uint64_t     version = getWorldVersion();
+
+        // Versions only grow, so the newest one in the subtree changes
+        // whenever anything below this scene moved or was updated. Removing
+        // a model or child is caught by the count
+        uint64_t newest = version;
+        for (auto & model : models) {
+            model->getWorldMatrix(world, version);
+            newest = std::max({newest, model->getWorldVersion(),
+                               model->getBoundsVersion()});
+        }
+        for (auto & child : children)
+            newest = std::max(newest, child->updateBounds(world, version));
+
+        size_t items = models.size() + children.size();
+        if (newest == boundsVersion && items == boundsItems)
+            return newest;
+        boundsVersion = newest;
+        boundsItems = items;
+
+        worldBounds = AABB();
+        for (auto & model : models) {
+            worldBounds.expand(model->getBounds().transformed(
+                model->getWorldMatrix(world, version)));
+        }
+        for (auto & child : children) worldBounds.expand(child->worldBounds);
+        return newest;
+    }
+
+    void Scene::enqueue(RenderQueue & queue, RenderState state) const {
+        if (state.getCullEnable())
+            updateBounds(state.getModel(), state.getModelVersion());
+        enqueueVisible(queue, state);
+    }
+
+    void Scene::enqueueVisible(RenderQueue & queue, RenderState state) const {
+        state.setModel(getWorldMatrix(state.getModel(), state.getModelVersion()),
+                       getLocalMatrix(), getWorldVersion());
+        const mat4 & world = state.getModel();
+        uint64_t     version = state.getModelVersion();
+
+        if (grid && state.getGridEnable()) {
+            GpuProfiler::Scope scope("Grid");
             grid->draw(state.getMVP());
-        for (auto & model : models) model->draw(state);
-        for (auto & child : children) child->draw(state);
+            // Grid binds it's own shader and vertex array
+            StateCache::current().invalidateBindings();
+        }
+
+        if (!state.getCullEnable()) {
+            for (auto & model : models) {
+                queue.push(*model, model->getWorldMatrix(world, version),
+                           model->getLocalMatrix(), state.getView());
+            }
+            for (auto & child : children) child->enqueueVisible(queue, state);
+            return;
+        }
+
+        Frustum frustum = state.getFrustum();
+
+        // Scratch space is reused between scenes and frames, it is only used
+        // before recursing into children
+        thread_local vector<AABB>    boxes;
+        thread_local vector<uint8_t> visible;
+
+        boxes.clear();
+        for (auto & model : models) {
+            boxes.push_back(model->getBounds().transformed(
+                model->getWorldMatrix(world, version)));
+        }
+        visible.resize(boxes.size());
+        size_t nVisible = frustum.intersects(boxes.data(), boxes.size(),
+                                             visible.data());
+        queue.addCulled(models.size() - nVisible);
+
+        for (size_t i = 0; i < models.size(); i++) {
+            if (!visible[i])
+                continue;
+            // Cached by the bounds pass above
+            queue.push(*models[i], models[i]->getWorldMatrix(world, version),
+                       models[i]->getLocalMatrix(), state.getView());
+        }
+
+        // Child bounds were updated by Scene::enqueue(). Empty bounds only
+        // contain grids or lights so they are never culled.
+        for (auto & child : children) {
+            if (child->worldBounds.empty()
+                || frustum.intersects(child->worldBounds))
+                child->enqueueVisible(queue, state);
+            else
+                queue.addCulled(1);
+        }
+    }
+
+    void Scene::collectLights(vector<Light> & lights,
+                              const mat4 &    parent) const {
+        const mat4 & world = getWorldMatrix(parent);
+        for (auto & light : this->lights)
+            lights.push_back(light.transformed(world));
+        for (auto & child : children) child->collectLights(lights, world);
+    }
+
+    void Scene::draw(RenderState state, RenderQueue & queue) const {
+        SINGE_PROFILE_SCOPE("Scene::draw");
+        queue.clear();
+        enqueue(queue, state);
+        queue.sort();
+        queue.setDepthPrepass(depthPrepass);
+        queue.submit(state);
+    }
+
+    void Scene::draw(RenderState state) const {
+        RenderQueue queue;
+        draw(state, queue);
     }
 }
@@ -1,11 +1,86 @@
 #include "singe/Graphics/Shader.hpp"
 
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
 #include <memory>
 
+#include "singe/Graphics/ShaderBindings.hpp"
+#include "singe/Graphics/StateCache.hpp"
+#include "singe/Graphics/UniformBuffers.hpp"
+
 namespace singe {
     using std::move;
 
-    Shader::Shader(glpp::Shader && shader) : m_shader(move(shader)) {}
+    Shader::Shader(glpp::Shader && shader)
+        : m_shader(move(shader)),
+          m_program(0),
+          m_extrasVersion(std::make_shared<uint64_t>(0)),
+          m_sentExtras(0),
+          m_frameBlock(false),
+          m_drawBlock(false) {
+        // glpp does not expose the program name, read it back once so binds
+        // can go through the StateCache
+        GLint previous = 0;
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        m_shader.bind();
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        glUseProgram(previous);
+        m_program = program;
+
+        // Reflect every active uniform once instead of asking the driver by
+        // name on each lookup. Uniforms in blocks have no location
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        string name(std::max(maxLength, 1), '\0');
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint   size = 0;
+            GLenum  type = 0;
+            glGetActiveUniform(m_program, i, name.size(), &length, &size, &type,
+                               name.data());
+            string uniformName(name.data(), length);
+            GLint  location =
+                glGetUniformLocation(m_program, uniformName.data());
+            if (location < 0)
+                continue;
+            m_locations[uniformName] = location;
+            auto array = uniformName.rfind("[0]");
+            if (array != string::npos && array + 3 == uniformName.size())
+                m_locations[uniformName.substr(0, array)] = location;
+        }
+
+        // Blocks that are not declared, or optimised out, are left to the
+        // plain uniforms
+        GLuint frame =
+            glGetUniformBlockIndex(m_program, UniformBuffers::FrameBlock);
+        if (frame != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_program, frame,
+                                  UniformBuffers::FrameBinding);
+            m_frameBlock = true;
+        }
+        GLuint draw = glGetUniformBlockIndex(m_program, UniformBuffers::DrawBlock);
+        if (draw != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_program, draw, UniformBuffers::DrawBinding);
+            m_drawBlock = true;
+        }
+        // Blocks and samplers of passes like ClusteredLights and
+        // ShadowCascades, the samplers sit on fixed units above the material
+        // textures
+        for (auto & block : ShaderBindings::getBlocks()) {
+            GLuint index = glGetUniformBlockIndex(m_program, block.name);
+            if (index != GL_INVALID_INDEX)
+                glUniformBlockBinding(m_program, index, block.index);
+        }
+        StateCache::current().useProgram(m_program);
+        for (auto & sampler : ShaderBindings::getSamplers()) {
+            GLint samplerLocation = location(sampler.name);
+            if (samplerLocation >= 0)
+                glUniform1i(samplerLocation, sampler.index);
+        }
+    }
 
     Shader::~Shader() {}
 
@@ -13,33 +88,78 @@ namespace singe {
         return m_shader;
     }
 
+    GLuint Shader::program() const {
+        return m_program;
+    }
+
+    bool Shader::usesFrameBlock() const {
+        return m_frameBlock;
+    }
+
+    bool Shader::usesDrawBlock() const {
+        return m_drawBlock;
+    }
+
+    GLint Shader::location(const string & name) const {
+        auto it = m_locations.find(name);
+        return it != m_locations.end() ? it->second : -1;
+    }
+
     glpp::Uniform Shader::uniform(const string & name) const {
         return m_shader.uniform(name.data());
     }
 
     void Shader::addExtra(const shared_ptr<UniformExtra> & extra) {
+        extra->attach(m_extrasVersion);
         m_extras.emplace_back(extra);
     }
 
+    void Shader::sendExtras() const {
+        // Every change increments the shared version, so most binds skip
+        // the loop entirely
+        if (*m_extrasVersion == m_sentExtras)
+            return;
+        for (auto & extra : m_extras) extra->send();
+        m_sentExtras = *m_extrasVersion;
+    }
+
     void Shader::bind() const {
-        m_shader.bind();
+        StateCache::current().useProgram(m_program);
     }
 
     void Shader::bind(RenderState & state) const {
-        m_shader.bind();
-        for (auto & extra : m_extras) {
-            extra->send();
+        bind();
+        if (m_frameBlock)
+            UniformBuffers::current().setFrame(state);
+        sendExtras();
+        apply(state);
+    }
+
+    void Shader::apply(RenderState & state) const {
+        if (!m_drawBlock)
+            return;
+
+        auto & uniforms = UniformBuffers::current();
+        if (state.getDrawOffset() < 0) {
+            uniforms.addDraw(state);
+            state.setDrawOffset(uniforms.uploadDraws());
         }
+        uniforms.bindDraw(state.getDrawOffset());
     }
 
     void Shader::unbind() const {
-        m_shader.unbind();
+        StateCache::current().useProgram(0);
     }
 }
 
 namespace singe {
     MVPShader::MVPShader(glpp::Shader && shader)
-        : Shader(move(shader)), m_mvp(m_shader.uniform("mvp")) {}
+        : Shader(move(shader)),
+          m_mvp(m_shader.uniform("mvp")),
+          m_model(location("model")),
+          m_packed(location("packedVertex")),
+          m_positionOffset(location("posOffset")),
+          m_positionScale(location("posScale")) {}
 
     const glpp::Uniform & MVPShader::mvp() const {
         return m_mvp;
@@ -47,6 +167,26 @@ namespace singe {
 
     void MVPShader::bind(RenderState & state) const {
         Shader::bind(state);
+    }
+
+    void MVPShader::apply(RenderState & state) const {
+        if (m_drawBlock) {
+            Shader::apply(state);
+            return;
+        }
+
         m_mvp.setMat4(state.getMVP());
+        if (m_model >= 0)
+            glUniformMatrix4fv(m_model, 1, GL_FALSE,
+                               glm::value_ptr(state.getModel()));
+
+        if (m_packed >= 0)
+            glUniform1i(m_packed, state.getPacked());
+        if (m_positionOffset >= 0)
+            glUniform3fv(m_positionOffset, 1,
+                         glm::value_ptr(state.getPositionOffset()));
+        if (m_positionScale >= 0)
+            glUniform3fv(m_positionScale, 1,
+                         glm::value_ptr(state.getPositionScale()));
     }
 }
@@ -0,0 +1,32 @@
+#include "singe/Graphics/ShaderBindings.hpp"
+
+namespace singe {
+    // Function statics, passes register before main() in any order
+    vector<ShaderBindings::Binding> & ShaderBindings::blocks() {
+        static vector<Binding> registered;
+        return registered;
+    }
+
+    vector<ShaderBindings::Binding> & ShaderBindings::samplers() {
+        static vector<Binding> registered;
+        return registered;
+    }
+
+    bool ShaderBindings::addBlock(const char * name, GLuint binding) {
+        blocks().push_back({name, binding});
+        return true;
+    }
+
+    bool ShaderBindings::addSampler(const char * name, GLuint unit) {
+        samplers().push_back({name, unit});
+        return true;
+    }
+
+    const vector<ShaderBindings::Binding> & ShaderBindings::getBlocks() {
+        return blocks();
+    }
+
+    const vector<ShaderBindings::Binding> & ShaderBindings::getSamplers() {
+        return samplers();
+    }
+}
@@ -0,0 +1,405 @@
+#include "singe/Graphics/ShadowCascades.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/Model.hpp"
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/ShaderBindings.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using glm::vec2;
+
+    static const bool kBindingsRegistered =
+        ShaderBindings::addBlock(ShadowCascades::ShadowBlock,
+                                 ShadowCascades::ShadowBinding)
+        && ShaderBindings::addSampler(ShadowCascades::ShadowSampler,
+                                      ShadowCascades::ShadowUnit);
+
+    /// Maps clip space xyz from -1 to 1 onto texture coordinates and depth
+    static const mat4 kBias(glm::translate(mat4(1), vec3(0.5f))
+                            * glm::scale(mat4(1), vec3(0.5f)));
+
+    static GLuint createDepthArray(GLsizei size, GLsizei layers, bool compare) {
+        GLuint array;
+        glGenTextures(1, &array);
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size,
+                     layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+        if (compare) {
+            // Linear filtering of a compare sampler is a 2x2 PCF
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                            GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                            GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                            GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC,
+                            GL_LEQUAL);
+        }
+        else {
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                            GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                            GL_NEAREST);
+        }
+        return array;
+    }
+
+    /// Find the newest world or bounds version and count the models and
+    /// scenes below scene, updating world matrices on the way
+    static void collectVersions(const Scene & scene,
+                                const mat4 &  parent,
+                                uint64_t      parentVersion,
+                                uint64_t &    newest,
+                                size_t &      items) {
+        const mat4 & world = scene.getWorldMatrix(parent, parentVersion);
+        uint64_t     version = scene.getWorldVersion();
+        newest = std::max(newest, version);
+        items += 1 + scene.models.size();
+        for (auto & model : scene.models) {
+            model->getWorldMatrix(world, version);
+            newest = std::max({newest, model->getWorldVersion(),
+                               model->getBoundsVersion()});
+        }
+        for (auto & child : scene.children)
+            collectVersions(*child, world, version, newest, items);
+    }
+
+    static GLuint createDepthBuffer() {
+        GLuint buffer;
+        glGenFramebuffers(1, &buffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, buffer);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        return buffer;
+    }
+
+    ShadowCascades::Stats::Stats()
+        : staticCascades(0), staticCasters(0), dynamicCasters(0) {}
+
+    ShadowCascades::ShadowCascades(GLsizei size,
+                                   float   distance,
+                                   float   splitLambda)
+        : size(size),
+          distance(distance),
+          splitLambda(glm::clamp(splitLambda, 0.0f, 1.0f)),
+          depthMargin(50),
+          block(),
+          staticVersion(1),
+          staticScene(nullptr),
+          staticNewest(TransformCache::Unversioned),
+          staticItems(0),
+          staticArray(0),
+          shadowArray(0),
+          staticBuffer(0),
+          shadowBuffer(0),
+          blockBuffer(0) {
+        for (auto & cascade : cascades) {
+            cascade.viewProjection = mat4(1);
+            cascade.cachedMatrix = mat4(0);
+            cascade.cachedVersion = 0;
+        }
+    }
+
+    ShadowCascades::ShadowCascades(ShadowCascades && other)
+        : ShadowCascades(other.size, other.distance, other.splitLambda) {
+        *this = move(other);
+    }
+
+    ShadowCascades & ShadowCascades::operator=(ShadowCascades && other) {
+        release();
+        size = other.size;
+        distance = other.distance;
+        splitLambda = other.splitLambda;
+        depthMargin = other.depthMargin;
+        std::copy(other.cascades, other.cascades + Cascades, cascades);
+        block = other.block;
+        staticVersion = other.staticVersion;
+        stats = other.stats;
+        staticScene = other.staticScene;
+        staticNewest = other.staticNewest;
+        staticItems = other.staticItems;
+        staticArray = other.staticArray;
+        shadowArray = other.shadowArray;
+        staticBuffer = other.staticBuffer;
+        shadowBuffer = other.shadowBuffer;
+        blockBuffer = other.blockBuffer;
+        casterProgram = move(other.casterProgram);
+
+        other.staticArray = 0;
+        other.shadowArray = 0;
+        other.staticBuffer = 0;
+        other.shadowBuffer = 0;
+        other.blockBuffer = 0;
+        return *this;
+    }
+
+    ShadowCascades::~ShadowCascades() {
+        release();
+    }
+
+    void ShadowCascades::release() {
+        if (staticArray)
+            glDeleteTextures(1, &staticArray);
+        if (shadowArray)
+            glDeleteTextures(1, &shadowArray);
+        if (staticBuffer)
+            glDeleteFramebuffers(1, &staticBuffer);
+        if (shadowBuffer)
+            glDeleteFramebuffers(1, &shadowBuffer);
+        if (blockBuffer)
+            glDeleteBuffers(1, &blockBuffer);
+        if (shadowArray)
+            StateCache::current().invalidateBindings();
+
+        staticArray = 0;
+        shadowArray = 0;
+        staticBuffer = 0;
+        shadowBuffer = 0;
+        blockBuffer = 0;
+    }
+
+    void ShadowCascades::setup() {
+        staticArray = createDepthArray(size, Cascades, false);
+        shadowArray = createDepthArray(size, Cascades, true);
+
+        GLint target = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        staticBuffer = createDepthBuffer();
+        shadowBuffer = createDepthBuffer();
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  shadowArray, 0, 0);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+            Logging::Graphics->error("Shadow framebuffer incomplete: {:#x}",
+                                     status);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+
+        glGenBuffers(1, &blockBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, blockBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowData), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void ShadowCascades::setDepthMargin(float margin) {
+        depthMargin = margin;
+    }
+
+    void ShadowCascades::invalidateStatic() {
+        staticVersion++;
+    }
+
+    void ShadowCascades::checkStatic(const Scene *       casters,
+                                     const RenderState & state) {
+        uint64_t newest = TransformCache::Unversioned;
+        size_t   items = 0;
+        if (casters) {
+            collectVersions(*casters, state.getModel(),
+                            state.getModelVersion(), newest, items);
+        }
+        if (casters == staticScene && newest == staticNewest
+            && items == staticItems)
+            return;
+        staticScene = casters;
+        staticNewest = newest;
+        staticItems = items;
+        invalidateStatic();
+    }
+
+    void ShadowCascades::updateCascades(const RenderState & state,
+                                        const vec3 &        direction) {
+        // glpp::Camera does not expose its planes, read them back from the
+        // glm::perspective projection it builds
+        const mat4 & projection = state.getProjection();
+        float        zNear = projection[3][2] / (projection[2][2] - 1);
+        float        zFar =
+            std::min(projection[3][2] / (projection[2][2] + 1), distance);
+
+        // Blend of logarithmic and even splits
+        float splits[Cascades + 1];
+        splits[0] = zNear;
+        for (size_t i = 1; i <= Cascades; i++) {
+            float p = float(i) / Cascades;
+            float logarithmic = zNear * std::pow(zFar / zNear, p);
+            float even = zNear + (zFar - zNear) * p;
+            splits[i] = splitLambda * logarithmic + (1 - splitLambda) * even;
+            block.splits[i - 1] = splits[i];
+        }
+
+        vec3 light = glm::normalize(direction);
+        vec3 up = std::abs(light.y) > 0.99f ? vec3(1, 0, 0) : vec3(0, 1, 0);
+        mat4 lightView = glm::lookAt(vec3(0), light, up);
+        block.light = vec4(light, 0);
+
+        mat4 inverseView = glm::inverse(state.getView());
+        vec2 scale(projection[0][0], projection[1][1]);
+        vec2 offset(projection[2][0], projection[2][1]);
+        for (size_t c = 0; c < Cascades; c++) {
+            vec3 corners[8];
+            vec3 center(0);
+            for (size_t i = 0; i < 8; i++) {
+                float depth = splits[c + (i >> 2)];
+                vec2  ndc(i & 1 ? 1 : -1, i & 2 ? 1 : -1);
+                vec2  view = depth * (ndc + offset) / scale;
+                corners[i] = vec3(inverseView * vec4(view, -depth, 1));
+                center += corners[i] / 8.0f;
+            }
+            float radius = 0;
+            for (auto & corner : corners)
+                radius = std::max(radius, glm::length(corner - center));
+            // Only the projection changes the radius, round off the noise
+            radius = std::ceil(radius * 16) / 16;
+
+            // Grow by one cache step and keep the step a whole number of
+            // texels, so static casters stay cached while the centre moves
+            // within a step and edges do not shimmer when it moves
+            float grown = radius * (1 + 2 / CacheSteps);
+            float texel = 2 * grown / size;
+            float steps = std::floor(2 * radius / CacheSteps / texel);
+            float step = texel * std::max(1.0f, steps);
+            vec3 lightCenter = vec3(lightView * vec4(center, 1));
+            lightCenter = glm::floor(lightCenter / step + 0.5f) * step;
+
+            mat4 lightProjection = glm::ortho(
+                lightCenter.x - grown, lightCenter.x + grown,
+                lightCenter.y - grown, lightCenter.y + grown,
+                -lightCenter.z - grown - depthMargin, -lightCenter.z + grown);
+
+            Cascade & cascade = cascades[c];
+            cascade.viewProjection = lightProjection * lightView;
+            cascade.frustum = Frustum(cascade.viewProjection);
+            block.matrices[c] = kBias * cascade.viewProjection;
+        }
+    }
+
+    void ShadowCascades::drawCaster(const Model &       model,
+                                    const mat4 &        world,
+                                    const Cascade &     cascade,
+                                    const RenderState & camera) {
+        auto & mesh =
+            model.selectLod(world, camera.getProjection(), camera.getView());
+        casterProgram.draw(mesh, cascade.viewProjection * world);
+    }
+
+    size_t ShadowCascades::drawCasters(const Scene &       scene,
+                                       const mat4 &        parent,
+                                       uint64_t            parentVersion,
+                                       const Cascade &     cascade,
+                                       const RenderState & camera) {
+        const mat4 & world = scene.getWorldMatrix(parent, parentVersion);
+        uint64_t     version = scene.getWorldVersion();
+        size_t       drawn = 0;
+        for (auto & model : scene.models) {
+            const mat4 & modelWorld = model->getWorldMatrix(world, version);
+            if (!cascade.frustum.intersects(
+                    model->getBounds().transformed(modelWorld)))
+                continue;
+            drawCaster(*model, modelWorld, cascade, camera);
+            drawn++;
+        }
+        for (auto & child : scene.children)
+            drawn += drawCasters(*child, world, version, cascade, camera);
+        return drawn;
+    }
+
+    void ShadowCascades::render(const RenderState & state,
+                                const vec3 &        direction,
+                                const Scene *       staticCasters,
+                                const Scene *       dynamicCasters) {
+        GpuProfiler::Scope scope("Shadows");
+        if (!blockBuffer)
+            setup();
+
+        stats = Stats();
+        updateCascades(state, direction);
+        checkStatic(staticCasters, state);
+
+        GLint viewport[4];
+        GLint target = 0;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+        auto & cache = StateCache::current();
+        glViewport(0, 0, size, size);
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.depthFunc(GL_LEQUAL);
+        cache.depthMask(true);
+        cache.setEnabled(GL_BLEND, false);
+        // Both sides cast, open meshes like planes have no back
+        cache.setEnabled(GL_CULL_FACE, false);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2, 4);
+
+        const mat4 & root = state.getModel();
+        uint64_t     rootVersion = state.getModelVersion();
+        for (size_t c = 0; c < Cascades; c++) {
+            Cascade & cascade = cascades[c];
+            if (staticCasters
+                && (cascade.cachedMatrix != cascade.viewProjection
+                    || cascade.cachedVersion != staticVersion)) {
+                glBindFramebuffer(GL_FRAMEBUFFER, staticBuffer);
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                          staticArray, 0, c);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                stats.staticCasters +=
+                    drawCasters(*staticCasters, root, rootVersion, cascade,
+                                state);
+                stats.staticCascades++;
+                cascade.cachedMatrix = cascade.viewProjection;
+                cascade.cachedVersion = staticVersion;
+            }
+
+            glBindFramebuffer(GL_FRAMEBUFFER, shadowBuffer);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                      shadowArray, 0, c);
+            if (staticCasters) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, staticBuffer);
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER,
+                                          GL_DEPTH_ATTACHMENT, staticArray, 0,
+                                          c);
+                glBlitFramebuffer(0, 0, size, size, 0, 0, size, size,
+                                  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, shadowBuffer);
+            }
+            else {
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+
+            if (dynamicCasters) {
+                stats.dynamicCasters +=
+                    drawCasters(*dynamicCasters, root, rootVersion, cascade,
+                                state);
+            }
+        }
+
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, blockBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShadowData), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void ShadowCascades::bind() const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, ShadowBinding, blockBuffer);
+        StateCache::current().bindTexture(ShadowUnit, GL_TEXTURE_2D_ARRAY,
+                                          shadowArray);
+    }
+
+    const ShadowCascades::Stats & ShadowCascades::getStats() const {
+        return stats;
+    }
+}
@@ -0,0 +1,179 @@
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    StateCache::Stats::Stats() : issued(0), skipped(0) {}
+
+    StateCache::StateCache() {
+        invalidate();
+    }
+
+    StateCache::~StateCache() {}
+
+    StateCache & StateCache::current() {
+        // A context can only be current on one thread at a time
+        static thread_local StateCache cache;
+        return cache;
+    }
+
+    void StateCache::invalidate() {
+        invalidateBindings();
+
+        blendCap.valid = false;
+        depthTestCap.valid = false;
+        cullFaceCap.valid = false;
+
+        blendFuncValid = false;
+        depthFuncValid = false;
+        depthMaskValid = false;
+        cullModeValid = false;
+        frontFaceValid = false;
+    }
+
+    void StateCache::invalidateBindings() {
+        programValid = false;
+        vertexArrayValid = false;
+        activeUnitValid = false;
+        for (auto & unit : units) unit.valid = false;
+    }
+
+    void StateCache::invalidateVertexArray() {
+        vertexArrayValid = false;
+    }
+
+    bool StateCache::skip(bool unchanged) {
+        if (unchanged)
+            stats.skipped++;
+        else
+            stats.issued++;
+        return unchanged;
+    }
+
+    StateCache::Capability * StateCache::capability(GLenum cap) {
+        switch (cap) {
+            case GL_BLEND:
+                return &blendCap;
+            case GL_DEPTH_TEST:
+                return &depthTestCap;
+            case GL_CULL_FACE:
+                return &cullFaceCap;
+            default:
+                return nullptr;
+        }
+    }
+
+    void StateCache::useProgram(GLuint program) {
+        if (skip(programValid && this->program == program))
+            return;
+        glUseProgram(program);
+        this->program = program;
+        programValid = true;
+    }
+
+    void StateCache::bindVertexArray(GLuint vertexArray) {
+        if (skip(vertexArrayValid && this->vertexArray == vertexArray))
+            return;
+        glBindVertexArray(vertexArray);
+        this->vertexArray = vertexArray;
+        vertexArrayValid = true;
+    }
+
+    void StateCache::activeTexture(GLuint unit) {
+        if (skip(activeUnitValid && activeUnit == unit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+        activeUnitValid = true;
+    }
+
+    void StateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+        if (unit < MaxTextureUnits) {
+            auto & slot = units[unit];
+            if (skip(slot.valid && !slot.object && slot.target == target
+                     && slot.name == texture))
+                return;
+            slot = {true, target, texture, nullptr};
+        }
+        activeTexture(unit);
+        glBindTexture(target, texture);
+    }
+
+    void StateCache::bindTexture(GLuint unit, const Texture * texture) {
+        if (!texture)
+            return;
+        if (unit < MaxTextureUnits) {
+            auto & slot = units[unit];
+            if (skip(slot.valid && slot.object == texture))
+                return;
+            slot = {true, GL_TEXTURE_2D, 0, texture};
+        }
+        activeTexture(unit);
+        texture->bind();
+    }
+
+    void StateCache::setEnabled(GLenum cap, bool enabled) {
+        Capability * state = capability(cap);
+        if (state && skip(state->valid && state->enabled == enabled))
+            return;
+        if (!state)
+            stats.issued++;
+
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+
+        if (state) {
+            state->valid = true;
+            state->enabled = enabled;
+        }
+    }
+
+    void StateCache::blendFunc(GLenum src, GLenum dst) {
+        if (skip(blendFuncValid && blendSrc == src && blendDst == dst))
+            return;
+        glBlendFunc(src, dst);
+        blendSrc = src;
+        blendDst = dst;
+        blendFuncValid = true;
+    }
+
+    void StateCache::depthFunc(GLenum func) {
+        if (skip(depthFuncValid && depthFn == func))
+            return;
+        glDepthFunc(func);
+        depthFn = func;
+        depthFuncValid = true;
+    }
+
+    void StateCache::depthMask(bool write) {
+        if (skip(depthMaskValid && depthWrite == write))
+            return;
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+        depthWrite = write;
+        depthMaskValid = true;
+    }
+
+    void StateCache::cullFace(GLenum mode) {
+        if (skip(cullModeValid && cullMode == mode))
+            return;
+        glCullFace(mode);
+        cullMode = mode;
+        cullModeValid = true;
+    }
+
+    void StateCache::frontFace(GLenum mode) {
+        if (skip(frontFaceValid && frontFaceMode == mode))
+            return;
+        glFrontFace(mode);
+        frontFaceMode = mode;
+        frontFaceValid = true;
+    }
+
+    const StateCache::Stats & StateCache::getStats() const {
+        return stats;
+    }
+
+    void StateCache::resetStats() {
+        stats = Stats();
+    }
+}
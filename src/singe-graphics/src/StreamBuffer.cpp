@@ -0,0 +1,163 @@
+#include "singe/Graphics/StreamBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <singe/Support/log.hpp>
+
+namespace singe {
+    /// Size of each segment before the ring first grows
+    static constexpr size_t kInitialSegment = 1 << 20;
+
+    /// Marks a segment not written since the buffer was created
+    static constexpr uint64_t kUnused = ~uint64_t(0);
+
+    /// Time to wait for a fence before checking again, in nanoseconds
+    static constexpr GLuint64 kFenceTimeout = 1000000;
+
+    StreamBuffer::Allocation::Allocation()
+        : data(nullptr), buffer(0), offset(0), size(0), segment(0) {}
+
+    StreamBuffer::StreamBuffer()
+        : buffer(0),
+          mapped(nullptr),
+          persistent(false),
+          segmentSize(0),
+          head(0),
+          segment(0),
+          frame(0) {
+        for (size_t i = 0; i < Frames; i++) {
+            segmentFrames[i] = kUnused;
+            fences[i] = nullptr;
+        }
+    }
+
+    StreamBuffer::~StreamBuffer() {}
+
+    StreamBuffer & StreamBuffer::current() {
+        // A context can only be current on one thread at a time
+        static thread_local StreamBuffer stream;
+        return stream;
+    }
+
+    void StreamBuffer::create(size_t size) {
+        // Draws already recorded this frame may still bind the old buffer
+        if (buffer)
+            retired.push_back(buffer);
+        for (auto & fence : fences) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        segmentSize = (size + 255) / 256 * 256;
+        size_t total = segmentSize * Frames;
+
+        persistent = GLEW_ARB_buffer_storage;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+                               | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, total, nullptr, flags);
+            mapped = static_cast<uint8_t *>(
+                glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags));
+            shadow.clear();
+            shadow.shrink_to_fit();
+        }
+        else {
+            glBufferData(GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW);
+            shadow.resize(total);
+            mapped = shadow.data();
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        Logging::Graphics->debug("Stream buffer of {} x {} bytes, {}", Frames,
+                                 segmentSize,
+                                 persistent ? "persistent" : "glBufferSubData");
+
+        // Skip a whole ring so allocations in the old buffer are invalid
+        segment += Frames;
+        head = 0;
+        std::fill(segmentFrames, segmentFrames + Frames, kUnused);
+        segmentFrames[segment % Frames] = frame;
+    }
+
+    void StreamBuffer::advance() {
+        fences[segment % Frames] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        segment++;
+        head = 0;
+
+        size_t index = segment % Frames;
+        if (GLsync fence = fences[index]) {
+            GLenum result;
+            do {
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                          kFenceTimeout);
+            } while (result == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fence);
+            fences[index] = nullptr;
+        }
+        segmentFrames[index] = frame;
+    }
+
+    StreamBuffer::Allocation StreamBuffer::allocate(size_t size,
+                                                    size_t alignment) {
+        if (!buffer)
+            create(kInitialSegment);
+        alignment = std::max<size_t>(alignment, 1);
+
+        auto place = [&]() {
+            size_t base = (segment % Frames) * segmentSize;
+            return (base + head + alignment - 1) / alignment * alignment;
+        };
+
+        size_t offset = place();
+        if (offset + size > (segment % Frames + 1) * segmentSize) {
+            // Move on early unless the next segment holds this frame's data
+            size_t next = (segment + 1) % Frames;
+            if (size + alignment <= segmentSize && segmentFrames[next] != frame)
+                advance();
+            else
+                create(std::max(segmentSize * 2, size + alignment));
+            offset = place();
+        }
+        head = offset + size - (segment % Frames) * segmentSize;
+
+        Allocation allocation;
+        allocation.data = mapped + offset;
+        allocation.buffer = buffer;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.segment = segment;
+        return allocation;
+    }
+
+    void StreamBuffer::commit(const Allocation & allocation) {
+        if (persistent || allocation.size == 0 || !valid(allocation))
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, allocation.buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.offset,
+                        allocation.size, allocation.data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    bool StreamBuffer::valid(const Allocation & allocation) const {
+        return allocation.data && segment - allocation.segment < Frames;
+    }
+
+    bool StreamBuffer::isPersistent() const {
+        return persistent;
+    }
+
+    void StreamBuffer::endFrame() {
+        if (!buffer)
+            return;
+        frame++;
+        advance();
+
+        if (!retired.empty()) {
+            glDeleteBuffers(retired.size(), retired.data());
+            retired.clear();
+        }
+    }
+}
@@ -0,0 +1,368 @@
+#include "singe/Graphics/TextureArrays.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <singe/Support/log.hpp>
+#include <tuple>
+
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+
+    /// Texels around each atlas region, filled with copies of its edge so
+    /// filtering and mipmaps do not pull in other regions
+    static constexpr GLint kAtlasPadding = 4;
+
+    /// Mip levels of atlas layers, level 2 still has a texel of padding so
+    /// lower levels would mix neighbouring regions
+    static constexpr GLsizei kAtlasLevels = 3;
+
+    /// Copy a rectangle of an array layer to another place in the layer
+    static void copyWithin(GLuint array,
+                           GLint  layer,
+                           GLint  x,
+                           GLint  y,
+                           GLint  toX,
+                           GLint  toY,
+                           GLint  width,
+                           GLint  height) {
+        glCopyImageSubData(array, GL_TEXTURE_2D_ARRAY, 0, x, y, layer, array,
+                           GL_TEXTURE_2D_ARRAY, 0, toX, toY, layer, width,
+                           height, 1);
+    }
+
+    /// Storage formats need a size, map the common unsized ones
+    static GLint sizedFormat(GLint format) {
+        switch (format) {
+            case GL_RGBA: return GL_RGBA8;
+            case GL_RGB: return GL_RGB8;
+            case GL_RG: return GL_RG8;
+            case GL_RED: return GL_R8;
+            default: return format;
+        }
+    }
+
+    TextureArrays::Stats::Stats()
+        : textures(0), layered(0), atlased(0), arrays(0) {}
+
+    TextureArrays::TextureArrays(GLsizei atlasSize, GLsizei atlasThreshold)
+        : atlasSize(atlasSize),
+          atlasThreshold(
+              std::min(atlasThreshold, atlasSize - 2 * kAtlasPadding)) {}
+
+    TextureArrays::TextureArrays(TextureArrays && other)
+        : atlasSize(other.atlasSize),
+          atlasThreshold(other.atlasThreshold),
+          materials(move(other.materials)),
+          arrays(move(other.arrays)),
+          layers(move(other.layers)),
+          stats(other.stats) {
+        other.arrays.clear();
+    }
+
+    TextureArrays & TextureArrays::operator=(TextureArrays && other) {
+        release();
+        atlasSize = other.atlasSize;
+        atlasThreshold = other.atlasThreshold;
+        materials = move(other.materials);
+        arrays = move(other.arrays);
+        layers = move(other.layers);
+        stats = other.stats;
+        other.arrays.clear();
+        return *this;
+    }
+
+    TextureArrays::~TextureArrays() {
+        release();
+    }
+
+    void TextureArrays::release() {
+        for (auto & material : materials) {
+            auto begin = material->layers;
+            std::fill(begin, begin + Material::TextureUnits, TextureLayer());
+        }
+        if (!arrays.empty())
+            glDeleteTextures(arrays.size(), arrays.data());
+        arrays.clear();
+        layers.clear();
+    }
+
+    void TextureArrays::add(const Material::Ptr & material) {
+        if (material
+            && std::find(materials.begin(), materials.end(), material)
+                   == materials.end())
+            materials.push_back(material);
+    }
+
+    void TextureArrays::add(const Scene & scene) {
+        for (auto & model : scene.models) {
+            add(model->material);
+            for (auto & lod : model->lods) add(lod->material);
+        }
+        for (auto & child : scene.children) add(*child);
+    }
+
+    GLuint TextureArrays::createArray(GLint   format,
+                                      GLsizei width,
+                                      GLsizei height,
+                                      GLsizei count,
+                                      GLsizei levels) {
+        GLuint array;
+        glGenTextures(1, &array);
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+        if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, sizedFormat(format),
+                           width, height, count);
+        }
+        else {
+            // Mutable storage, each level is allocated and the unused ones
+            // are cut off so the texture is complete
+            for (GLsizei level = 0; level < levels; level++) {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, level, sizedFormat(format),
+                             std::max(width >> level, 1),
+                             std::max(height >> level, 1), count, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, nullptr);
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                            levels - 1);
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        arrays.push_back(array);
+        stats.arrays++;
+        return array;
+    }
+
+    void TextureArrays::copy(const Source & source,
+                             GLuint         array,
+                             GLint          x,
+                             GLint          y,
+                             GLint          layer,
+                             GLint          padding) {
+        GLint width = source.width;
+        GLint height = source.height;
+        if (GLEW_ARB_copy_image) {
+            glCopyImageSubData(source.name, GL_TEXTURE_2D, 0, 0, 0, 0, array,
+                               GL_TEXTURE_2D_ARRAY, 0, x, y, layer, width,
+                               height, 1);
+
+            // Columns first, then whole rows so the corners are filled too
+            for (GLint i = 1; i <= padding; i++) {
+                copyWithin(array, layer, x, y, x - i, y, 1, height);
+                copyWithin(array, layer, x + width - 1, y, x + width - 1 + i,
+                           y, 1, height);
+            }
+            for (GLint i = 1; i <= padding; i++) {
+                copyWithin(array, layer, x - padding, y, x - padding, y - i,
+                           width + 2 * padding, 1);
+                copyWithin(array, layer, x - padding, y + height - 1,
+                           x - padding, y + height - 1 + i,
+                           width + 2 * padding, 1);
+            }
+            return;
+        }
+
+        // Without copy image go through the CPU as 8-bit RGBA, which covers
+        // the textures loaded by ResourceManager
+        vector<uint8_t> pixels(size_t(width) * height * 4);
+        auto &          cache = StateCache::current();
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        cache.bindTexture(0, GL_TEXTURE_2D, source.name);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                      pixels.data());
+
+        // Clamp reads into the source to extend its edges over the padding
+        GLint           paddedWidth = width + 2 * padding;
+        GLint           paddedHeight = height + 2 * padding;
+        vector<uint8_t> padded(size_t(paddedWidth) * paddedHeight * 4);
+        for (GLint row = 0; row < paddedHeight; row++) {
+            GLint fromRow = std::clamp(row - padding, 0, height - 1);
+            for (GLint column = 0; column < paddedWidth; column++) {
+                GLint fromColumn = std::clamp(column - padding, 0, width - 1);
+                std::copy_n(&pixels[(size_t(fromRow) * width + fromColumn) * 4],
+                            4,
+                            &padded[(size_t(row) * paddedWidth + column) * 4]);
+            }
+        }
+
+        cache.bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x - padding, y - padding,
+                        layer, paddedWidth, paddedHeight, 1, GL_RGBA,
+                        GL_UNSIGNED_BYTE, padded.data());
+    }
+
+    void TextureArrays::packLayers(const vector<Source> & group) {
+        const Source & first = group.front();
+        GLsizei        levels =
+            1 + GLsizei(std::log2(std::max(first.width, first.height)));
+        GLuint array = createArray(first.format, first.width, first.height,
+                                   group.size(), levels);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        for (size_t i = 0; i < group.size(); i++) {
+            copy(group[i], array, 0, 0, i, 0);
+            TextureLayer & layer = layers[group[i].texture];
+            layer.array = array;
+            layer.layer = i;
+            layer.rect = vec4(0, 0, 1, 1);
+        }
+
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        stats.layered += group.size();
+    }
+
+    void TextureArrays::packAtlas(vector<Source> group) {
+        std::sort(group.begin(), group.end(), [](auto & a, auto & b) {
+            return a.height > b.height;
+        });
+
+        // Shelves left to right, top to bottom, then the next layer. Each
+        // region has its own padding on every side
+        struct Placement {
+            GLint x, y, layer;
+        };
+        vector<Placement> placements;
+        GLint             x = kAtlasPadding, y = kAtlasPadding;
+        GLint             shelf = 0, layerCount = 1;
+        for (auto & source : group) {
+            if (x + source.width + kAtlasPadding > atlasSize) {
+                x = kAtlasPadding;
+                y += shelf + 2 * kAtlasPadding;
+                shelf = 0;
+            }
+            if (y + source.height + kAtlasPadding > atlasSize) {
+                x = kAtlasPadding;
+                y = kAtlasPadding;
+                shelf = 0;
+                layerCount++;
+            }
+            placements.push_back({x, y, layerCount - 1});
+            x += source.width + 2 * kAtlasPadding;
+            shelf = std::max(shelf, source.height);
+        }
+
+        GLuint array = createArray(group.front().format, atlasSize, atlasSize,
+                                   layerCount, kAtlasLevels);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                        kAtlasLevels - 1);
+
+        // Texels outside the padded regions stay undefined, no mip level
+        // of a region reaches past its padding
+        float size = atlasSize;
+        for (size_t i = 0; i < group.size(); i++) {
+            auto & source = group[i];
+            auto & place = placements[i];
+            copy(source, array, place.x, place.y, place.layer, kAtlasPadding);
+
+            // Inset by half a texel so linear filtering stays inside
+            TextureLayer & layer = layers[source.texture];
+            layer.array = array;
+            layer.layer = place.layer;
+            layer.rect = vec4((place.x + 0.5f) / size, (place.y + 0.5f) / size,
+                              (source.width - 1) / size,
+                              (source.height - 1) / size);
+        }
+
+        StateCache::current().bindTexture(0, GL_TEXTURE_2D_ARRAY, array);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        stats.atlased += group.size();
+    }
+
+    void TextureArrays::build() {
+        release();
+        stats = Stats();
+
+        auto & cache = StateCache::current();
+
+        // glpp does not expose the texture name or size, bind each texture
+        // once and read them back
+        vector<Source>            sources;
+        std::set<const Texture *> seen;
+        for (auto & material : materials) {
+            const Texture * textures[] = {material->texture.get(),
+                                          material->normalTexture.get(),
+                                          material->specularTexture.get()};
+            for (auto texture : textures) {
+                if (!texture || !seen.insert(texture).second)
+                    continue;
+
+                Source source {texture, 0, 0, 0, 0};
+                GLint  name = 0;
+                GLint  compressed = GL_FALSE;
+                cache.activeTexture(0);
+                texture->bind();
+                glGetIntegerv(GL_TEXTURE_BINDING_2D, &name);
+                source.name = name;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH,
+                                         &source.width);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT,
+                                         &source.height);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,
+                                         GL_TEXTURE_INTERNAL_FORMAT,
+                                         &source.format);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,
+                                         GL_TEXTURE_COMPRESSED, &compressed);
+                stats.textures++;
+                if (!compressed && source.width > 0 && source.height > 0)
+                    sources.push_back(source);
+            }
+        }
+        cache.invalidateBindings();
+
+        // Same size and format share an array, the rest go to an atlas per
+        // format if they are small enough
+        map<std::tuple<GLint, GLint, GLint>, vector<Source>> sized;
+        for (auto & source : sources) {
+            auto key = std::make_tuple(source.format, source.width,
+                                       source.height);
+            sized[key].push_back(source);
+        }
+
+        map<GLint, vector<Source>> small;
+        for (auto & [key, group] : sized) {
+            if (group.size() > 1) {
+                packLayers(group);
+            }
+            else if (group[0].width <= atlasThreshold
+                     && group[0].height <= atlasThreshold) {
+                small[group[0].format].push_back(group[0]);
+            }
+        }
+        for (auto & [format, group] : small) {
+            if (group.size() > 1)
+                packAtlas(move(group));
+        }
+
+        for (auto & material : materials) {
+            const Texture * textures[] = {material->texture.get(),
+                                          material->normalTexture.get(),
+                                          material->specularTexture.get()};
+            for (size_t unit = 0; unit < Material::TextureUnits; unit++) {
+                auto it = layers.find(textures[unit]);
+                material->layers[unit] =
+                    it != layers.end() ? it->second : TextureLayer();
+            }
+        }
+
+        cache.invalidateBindings();
+        Logging::Graphics->debug(
+            "Packed {} textures into {} arrays, {} as layers and {} in atlases",
+            stats.textures, stats.arrays, stats.layered, stats.atlased);
+    }
+
+    const TextureArrays::Stats & TextureArrays::getStats() const {
+        return stats;
+    }
+}
@@ -0,0 +1,97 @@
+#include "singe/Graphics/TransformCache.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+#include "singe/Graphics/TransformStore.hpp"
+
+namespace singe {
+    static_assert(std::is_trivially_copyable_v<Transform>,
+                  "Transform is compared by memory");
+
+    TransformCache::TransformCache()
+        : local(1),
+          parent(1),
+          world(1),
+          parentVersion(Unversioned),
+          version(Unversioned),
+          localValid(false),
+          store(nullptr),
+          node(0) {}
+
+    TransformCache::~TransformCache() {
+        if (store)
+            store->detach(node);
+    }
+
+    const mat4 & TransformCache::getLocal(const Transform & transform) {
+        if (store)
+            return store->getLocal(node);
+
+        // Padding may differ between equal transforms, that only costs an
+        // extra update
+        if (!localValid
+            || std::memcmp(&snapshot, &transform, sizeof(Transform)) != 0) {
+            snapshot = transform;
+            local = transform.toMatrix();
+            localValid = true;
+            version = Unversioned;
+        }
+        return local;
+    }
+
+    const mat4 & TransformCache::getWorld(const Transform & transform,
+                                          const mat4 &      parent,
+                                          uint64_t          parentVersion) {
+        if (store)
+            return store->getWorld(node);
+
+        getLocal(transform);
+
+        bool parentChanged = parentVersion == Unversioned
+                                 ? parent != this->parent
+                                 : parentVersion != this->parentVersion;
+        if (version == Unversioned || parentChanged) {
+            this->parent = parent;
+            this->parentVersion = parentVersion;
+            world = parent * local;
+            version = nextVersion();
+        }
+        return world;
+    }
+
+    uint64_t TransformCache::getVersion() const {
+        return store ? store->getVersion(node) : version;
+    }
+
+    void TransformCache::invalidate() {
+        localValid = false;
+        version = Unversioned;
+    }
+
+    void TransformCache::bind(TransformStore *  store,
+                              uint32_t          node,
+                              const Transform & transform) {
+        if (this->store)
+            this->store->detach(this->node);
+        this->store = store;
+        this->node = node;
+        if (store)
+            store->attach(node, *this, transform);
+        invalidate();
+    }
+
+    void TransformCache::takeBinding(TransformCache &  other,
+                                     const Transform & transform) {
+        TransformStore * store = other.store;
+        uint32_t         node = other.node;
+        other.store = nullptr;
+        bind(store, node, transform);
+    }
+
+    uint64_t TransformCache::nextVersion() {
+        static std::atomic<uint64_t> counter(Unversioned);
+        return ++counter;
+    }
+}
@@ -0,0 +1,272 @@
+#include "singe/Graphics/TransformStore.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include "singe/Graphics/Model.hpp"
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/TransformCache.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#define SINGE_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace singe {
+    /// out = a * b, out may not alias a or b
+    static inline void multiply(const mat4 & a, const mat4 & b, mat4 & out) {
+#ifdef SINGE_TRANSFORM_SSE
+        // Each column of out is the columns of a weighted by a column of b
+        __m128 a0 = _mm_loadu_ps(&a[0][0]);
+        __m128 a1 = _mm_loadu_ps(&a[1][0]);
+        __m128 a2 = _mm_loadu_ps(&a[2][0]);
+        __m128 a3 = _mm_loadu_ps(&a[3][0]);
+        for (int c = 0; c < 4; c++) {
+            const float * col = &b[c][0];
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(col[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(col[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(col[3])));
+            _mm_storeu_ps(&out[c][0], r);
+        }
+#else
+        out = a * b;
+#endif
+    }
+
+    /// Translation * rotation * scale without building each matrix
+    static inline void compose(const vec3 & t,
+                               const quat & q,
+                               const vec3 & s,
+                               mat4 &       out) {
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        out[0] = glm::vec4(1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0)
+                 * s.x;
+        out[1] = glm::vec4(2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0)
+                 * s.y;
+        out[2] = glm::vec4(2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0)
+                 * s.z;
+        out[3] = glm::vec4(t, 1);
+    }
+
+    TransformStore::TransformStore()
+        : version(TransformCache::Unversioned), sorted(true) {}
+
+    TransformStore::~TransformStore() {
+        clear();
+    }
+
+    uint32_t TransformStore::addNode(uint32_t parent) {
+        uint32_t level = parent == None ? 0 : levels[slots[parent]] + 1;
+        if (!levels.empty() && level < levels.back())
+            sorted = false;
+
+        uint32_t handle = slots.size();
+        slots.push_back(parents.size());
+        handles.push_back(handle);
+        parents.push_back(parent == None ? None : slots[parent]);
+        levels.push_back(level);
+        positions.emplace_back(0);
+        rotations.emplace_back(1, 0, 0, 0);
+        scales.emplace_back(1);
+        sources.push_back(nullptr);
+        caches.push_back(nullptr);
+        detached.push_back(false);
+        locals.emplace_back(1);
+        worlds.emplace_back(1);
+        versions.push_back(TransformCache::Unversioned);
+        return handle;
+    }
+
+    uint32_t TransformStore::add(uint32_t     parent,
+                                 const vec3 & position,
+                                 const quat & rotation,
+                                 const vec3 & scale) {
+        uint32_t node = addNode(parent);
+        setTransform(node, position, rotation, scale);
+        return node;
+    }
+
+    uint32_t TransformStore::add(const Scene & scene, uint32_t parent) {
+        uint32_t node = addNode(parent);
+        scene.bindTransformStore(this, node);
+
+        for (auto & model : scene.models) add(*model, node);
+        for (auto & child : scene.children) add(*child, node);
+        return node;
+    }
+
+    uint32_t TransformStore::add(const Model & model, uint32_t parent) {
+        uint32_t node = addNode(parent);
+        model.bindTransformStore(this, node);
+        return node;
+    }
+
+    void TransformStore::attach(uint32_t          node,
+                                TransformCache &  cache,
+                                const Transform & transform) {
+        uint32_t slot = slots[node];
+        if (caches[slot] && caches[slot] != &cache)
+            caches[slot]->bind(nullptr, 0, transform);
+        sources[slot] = &transform;
+        caches[slot] = &cache;
+        detached[slot] = false;
+    }
+
+    void TransformStore::detach(uint32_t node) {
+        uint32_t slot = slots[node];
+        sources[slot] = nullptr;
+        caches[slot] = nullptr;
+        detached[slot] = true;
+    }
+
+    void TransformStore::clear() {
+        // Each cache detaches itself, which clears its entry
+        for (size_t i = 0; i < caches.size(); i++) {
+            if (caches[i])
+                caches[i]->bind(nullptr, 0, *sources[i]);
+        }
+
+        parents.clear();
+        levels.clear();
+        positions.clear();
+        rotations.clear();
+        scales.clear();
+        sources.clear();
+        caches.clear();
+        detached.clear();
+        locals.clear();
+        worlds.clear();
+        versions.clear();
+        handles.clear();
+        slots.clear();
+        levelStarts.clear();
+        sorted = true;
+    }
+
+    size_t TransformStore::size() const {
+        return parents.size();
+    }
+
+    size_t TransformStore::getLevelCount() const {
+        return levelStarts.empty() ? 0 : levelStarts.size() - 1;
+    }
+
+    void TransformStore::setTransform(uint32_t     node,
+                                      const vec3 & position,
+                                      const quat & rotation,
+                                      const vec3 & scale) {
+        uint32_t slot = slots[node];
+        positions[slot] = position;
+        rotations[slot] = rotation;
+        scales[slot] = scale;
+    }
+
+    const mat4 & TransformStore::getLocal(uint32_t node) const {
+        return locals[slots[node]];
+    }
+
+    const mat4 & TransformStore::getWorld(uint32_t node) const {
+        return worlds[slots[node]];
+    }
+
+    uint64_t TransformStore::getVersion() const {
+        return version;
+    }
+
+    uint64_t TransformStore::getVersion(uint32_t node) const {
+        return versions[slots[node]];
+    }
+
+    template<typename T>
+    static void permute(vector<T> & values, const vector<uint32_t> & order) {
+        vector<T> result;
+        result.reserve(order.size());
+        for (auto slot : order) result.push_back(values[slot]);
+        values.swap(result);
+    }
+
+    void TransformStore::sort() {
+        // Stable so siblings keep the order they were added in
+        vector<uint32_t> order(parents.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return levels[a] < levels[b];
+                         });
+
+        vector<uint32_t> newSlot(order.size());
+        for (uint32_t i = 0; i < order.size(); i++) newSlot[order[i]] = i;
+
+        permute(parents, order);
+        for (auto & parent : parents) {
+            if (parent != None)
+                parent = newSlot[parent];
+        }
+        permute(levels, order);
+        permute(positions, order);
+        permute(rotations, order);
+        permute(scales, order);
+        permute(sources, order);
+        permute(caches, order);
+        permute(detached, order);
+        permute(locals, order);
+        permute(worlds, order);
+        permute(versions, order);
+        permute(handles, order);
+        for (uint32_t i = 0; i < handles.size(); i++) slots[handles[i]] = i;
+
+        sorted = true;
+    }
+
+    void TransformStore::update(ThreadPool & pool) {
+        if (!sorted)
+            sort();
+
+        levelStarts.clear();
+        for (uint32_t i = 0; i < levels.size(); i++) {
+            if (i == 0 || levels[i] != levels[i - 1])
+                levelStarts.push_back(i);
+        }
+        levelStarts.push_back(levels.size());
+
+        // Changed nodes all get this version, unchanged nodes keep theirs
+        uint64_t next = TransformCache::nextVersion();
+
+        // Parents are always in an earlier level, so every node in a level
+        // can be calculated at once
+        for (size_t l = 0; l + 1 < levelStarts.size(); l++) {
+            uint32_t first = levelStarts[l];
+            uint32_t count = levelStarts[l + 1] - first;
+            pool.parallelFor(count, Grain, [&](size_t begin, size_t end) {
+                mat4 local;
+                for (size_t i = first + begin; i < first + end; i++) {
+                    if (sources[i])
+                        local = sources[i]->toMatrix();
+                    else if (detached[i])
+                        local = locals[i];
+                    else
+                        compose(positions[i], rotations[i], scales[i], local);
+
+                    bool parentChanged =
+                        parents[i] != None && versions[parents[i]] == next;
+                    if (versions[i] != TransformCache::Unversioned
+                        && !parentChanged && local == locals[i])
+                        continue;
+
+                    locals[i] = local;
+                    if (parents[i] == None)
+                        worlds[i] = locals[i];
+                    else
+                        multiply(worlds[parents[i]], locals[i], worlds[i]);
+                    versions[i] = next;
+                }
+            });
+        }
+
+        version = next;
+    }
+}
@@ -0,0 +1,345 @@
+#include "singe/Graphics/TransparencyRenderer.hpp"
+
+#include <algorithm>
+#include <string>
+#include <singe/Support/log.hpp>
+
+#include "singe/Graphics/GlUtil.hpp"
+#include "singe/Graphics/GpuProfiler.hpp"
+#include "singe/Graphics/Scene.hpp"
+#include "singe/Graphics/StateCache.hpp"
+
+namespace singe {
+    using std::move;
+
+    static const GLfloat kClearAccum[] = {0, 0, 0, 0};
+    static const GLfloat kClearReveal[] = {1, 1, 1, 1};
+
+    // Compiled with MULTISAMPLE defined when the targets are multisampled
+    static const char * kCompositeFragmentSource = R"(
+#ifdef MULTISAMPLE
+uniform sampler2DMS accumTexture;
+uniform sampler2DMS revealTexture;
+uniform int samples;
+#else
+uniform sampler2D accumTexture;
+uniform sampler2D revealTexture;
+const int samples = 1;
+#endif
+out vec4 color;
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    vec3 covered = vec3(0.0);
+    float reveal = 0.0;
+    // Resolve each sample on its own, so opaque edges only hide the
+    // samples they cover. The last argument is the level when not
+    // multisampled, which is 0
+    for (int i = 0; i < samples; ++i) {
+        float sampleReveal = texelFetch(revealTexture, coord, i).r;
+        vec4 accum = texelFetch(accumTexture, coord, i);
+        // Large weights can overflow half floats
+        if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b))))
+            accum.rgb = vec3(accum.a);
+        covered += accum.rgb / max(accum.a, 1e-5) * (1.0 - sampleReveal);
+        reveal += sampleReveal;
+    }
+    reveal /= float(samples);
+    // Nothing transparent covers this pixel
+    if (reveal == 1.0)
+        discard;
+    color = vec4(covered / float(samples) / (1.0 - reveal), reveal);
+}
+)";
+
+    TransparencyRenderer::TransparencyRenderer()
+        : viewport {0, 0, 0, 0},
+          target(0),
+          sampledTarget(-1),
+          copyDepth(false),
+          indexedBlend(false),
+          samples(0),
+          depthFormat(GL_DEPTH24_STENCIL8),
+          width(0),
+          height(0),
+          transparencyBuffer(0),
+          accumTexture(0),
+          revealTexture(0),
+          depthBuffer(0),
+          compositeProgram(0),
+          emptyArray(0) {}
+
+    TransparencyRenderer::TransparencyRenderer(TransparencyRenderer && other)
+        : TransparencyRenderer() {
+        *this = move(other);
+    }
+
+    TransparencyRenderer &
+    TransparencyRenderer::operator=(TransparencyRenderer && other) {
+        release();
+        std::copy(other.viewport, other.viewport + 4, viewport);
+        target = other.target;
+        sampledTarget = other.sampledTarget;
+        copyDepth = other.copyDepth;
+        indexedBlend = other.indexedBlend;
+        samples = other.samples;
+        depthFormat = other.depthFormat;
+        width = other.width;
+        height = other.height;
+        transparencyBuffer = other.transparencyBuffer;
+        accumTexture = other.accumTexture;
+        revealTexture = other.revealTexture;
+        depthBuffer = other.depthBuffer;
+        compositeProgram = other.compositeProgram;
+        emptyArray = other.emptyArray;
+
+        other.width = 0;
+        other.height = 0;
+        other.transparencyBuffer = 0;
+        other.accumTexture = 0;
+        other.revealTexture = 0;
+        other.depthBuffer = 0;
+        other.compositeProgram = 0;
+        other.emptyArray = 0;
+        return *this;
+    }
+
+    TransparencyRenderer::~TransparencyRenderer() {
+        release();
+    }
+
+    void TransparencyRenderer::releaseTargets() {
+        if (transparencyBuffer)
+            glDeleteFramebuffers(1, &transparencyBuffer);
+
+        GLuint textures[] = {accumTexture, revealTexture};
+        for (auto texture : textures) {
+            if (texture)
+                glDeleteTextures(1, &texture);
+        }
+        if (depthBuffer)
+            glDeleteRenderbuffers(1, &depthBuffer);
+
+        transparencyBuffer = 0;
+        accumTexture = 0;
+        revealTexture = 0;
+        depthBuffer = 0;
+        width = 0;
+        height = 0;
+
+        // Deleted names may be handed out again
+        StateCache::current().invalidateBindings();
+    }
+
+    void TransparencyRenderer::release() {
+        releaseTargets();
+        if (compositeProgram)
+            glDeleteProgram(compositeProgram);
+        if (emptyArray)
+            glDeleteVertexArrays(1, &emptyArray);
+        compositeProgram = 0;
+        emptyArray = 0;
+    }
+
+    void TransparencyRenderer::setup() {
+        if (compositeProgram)
+            glDeleteProgram(compositeProgram);
+
+        std::string source = "#version 330 core\n";
+        if (samples > 0)
+            source += "#define MULTISAMPLE\n";
+        source += kCompositeFragmentSource;
+        compositeProgram =
+            GlUtil::linkProgram(GlUtil::FullscreenVertexSource,
+                                source.c_str(), "Transparency");
+        StateCache::current().useProgram(compositeProgram);
+        glUniform1i(glGetUniformLocation(compositeProgram, "accumTexture"), 0);
+        glUniform1i(glGetUniformLocation(compositeProgram, "revealTexture"), 1);
+        if (samples > 0)
+            glUniform1i(glGetUniformLocation(compositeProgram, "samples"),
+                        samples);
+
+        if (!emptyArray) {
+            glGenVertexArrays(1, &emptyArray);
+
+            indexedBlend = GLEW_VERSION_4_0 || GLEW_ARB_draw_buffers_blend;
+            if (!indexedBlend)
+                Logging::Graphics->error(
+                    "Transparency needs OpenGL 4.0 or "
+                    "ARB_draw_buffers_blend, revealage will be wrong");
+        }
+    }
+
+    void TransparencyRenderer::match(GLint framebuffer) {
+        GLsizei targetSamples = GlUtil::getSamples(framebuffer);
+        GLenum targetFormat = GlUtil::getDepthFormat(framebuffer);
+
+        copyDepth = targetFormat != GL_NONE;
+        if (!copyDepth) {
+            Logging::Graphics->warning(
+                "Transparency target has no depth buffer, opaque geometry "
+                "will not hide transparent surfaces");
+            targetFormat = GL_DEPTH24_STENCIL8;
+        }
+        if (targetSamples > 0
+            && !(GLEW_VERSION_3_2 || GLEW_ARB_texture_multisample)) {
+            Logging::Graphics->warning(
+                "Transparency target is multisampled without "
+                "ARB_texture_multisample, opaque geometry will not hide "
+                "transparent surfaces");
+            copyDepth = false;
+            targetSamples = 0;
+        }
+
+        if (targetSamples == samples && targetFormat == depthFormat)
+            return;
+        // The composite program samples differently with and without
+        // multisampling
+        bool rebuild = (targetSamples > 0) != (samples > 0);
+        samples = targetSamples;
+        depthFormat = targetFormat;
+        releaseTargets();
+        if (rebuild)
+            setup();
+        Logging::Graphics->debug("Transparency targets match {} samples",
+                                 samples);
+    }
+
+    void TransparencyRenderer::resize(GLsizei width, GLsizei height) {
+        releaseTargets();
+        this->width = width;
+        this->height = height;
+
+        // Sums of weighted colours need more range than 8 bits
+        GLenum textureType = GL_TEXTURE_2D;
+        if (samples > 0) {
+            textureType = GL_TEXTURE_2D_MULTISAMPLE;
+            accumTexture = GlUtil::createMultisampleTarget(GL_RGBA16F, samples,
+                                                           width, height);
+            revealTexture = GlUtil::createMultisampleTarget(GL_R8, samples,
+                                                            width, height);
+        }
+        else {
+            accumTexture = GlUtil::createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT,
+                                                width, height);
+            revealTexture = GlUtil::createTarget(
+                GL_R8, GL_RED, GL_UNSIGNED_BYTE, width, height);
+        }
+        // Same samples and format as the target so depth can be blitted
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, depthFormat,
+                                         width, height);
+        bool stencil = depthFormat == GL_DEPTH24_STENCIL8
+                    || depthFormat == GL_DEPTH32F_STENCIL8;
+
+        glGenFramebuffers(1, &transparencyBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, transparencyBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               textureType, accumTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+                               textureType, revealTexture, 0);
+        glFramebufferRenderbuffer(
+            GL_FRAMEBUFFER,
+            stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+            GL_RENDERBUFFER, depthBuffer);
+        const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0,
+                                      GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, drawBuffers);
+
+        GlUtil::checkFramebuffer("Transparency");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+        Logging::Graphics->debug("Transparency targets resized to {}x{}",
+                                 width, height);
+    }
+
+    void TransparencyRenderer::begin() {
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+        if (target != sampledTarget) {
+            sampledTarget = target;
+            match(target);
+        }
+        if (!compositeProgram)
+            setup();
+
+        // The targets cover the viewport at the same position, multisampled
+        // blits can not move pixels
+        GLsizei right = viewport[0] + viewport[2];
+        GLsizei top = viewport[1] + viewport[3];
+        if (right != width || top != height)
+            resize(right, top);
+
+        if (copyDepth) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, transparencyBuffer);
+            glBlitFramebuffer(viewport[0], viewport[1], right, top,
+                              viewport[0], viewport[1], right, top,
+                              GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, transparencyBuffer);
+
+        glClearBufferfv(GL_COLOR, 0, kClearAccum);
+        glClearBufferfv(GL_COLOR, 1, kClearReveal);
+        if (!copyDepth)
+            glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+
+        auto & cache = StateCache::current();
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.depthMask(false);
+        cache.setEnabled(GL_BLEND, true);
+        // Sets every draw buffer, then revealage is overridden to multiply
+        // by one minus alpha. end() sets all buffers again so the cache
+        // stays correct
+        cache.blendFunc(GL_ONE, GL_ONE);
+        if (GLEW_VERSION_4_0)
+            glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+        else if (indexedBlend)
+            glBlendFunciARB(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    }
+
+    void TransparencyRenderer::end() {
+        auto & cache = StateCache::current();
+        glBindFramebuffer(GL_FRAMEBUFFER, target);
+
+        // Blend the average colour over the target by the revealage
+        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        cache.setEnabled(GL_DEPTH_TEST, false);
+        cache.blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+        cache.setEnabled(GL_CULL_FACE, false);
+        GLenum textureType =
+            samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        cache.bindTexture(0, textureType, accumTexture);
+        cache.bindTexture(1, textureType, revealTexture);
+        cache.useProgram(compositeProgram);
+        cache.bindVertexArray(emptyArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        cache.setEnabled(GL_DEPTH_TEST, true);
+        cache.depthMask(true);
+        cache.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        cache.setEnabled(GL_CULL_FACE, true);
+        cache.bindVertexArray(0);
+    }
+
+    void TransparencyRenderer::draw(const Scene & scene,
+                                    RenderState   state,
+                                    RenderQueue & queue) {
+        // Keys are built on push, blended items only need grouping
+        bool sortBlended = queue.getSortBlended();
+        queue.setSortBlended(false);
+        queue.clear();
+        scene.enqueue(queue, state);
+        queue.sort();
+        queue.setSortBlended(sortBlended);
+
+        {
+            GpuProfiler::Scope scope("Opaque");
+            queue.submit(state, RenderQueue::Opaque);
+        }
+        GpuProfiler::Scope scope("Transparency");
+        begin();
+        queue.submit(state, RenderQueue::Blended);
+        end();
+    }
+}
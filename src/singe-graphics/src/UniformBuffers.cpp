@@ -0,0 +1,111 @@
+#include "singe/Graphics/UniformBuffers.hpp"
+
+#include <cstring>
+
+#include "singe/Graphics/StreamBuffer.hpp"
+
+namespace singe {
+    UniformBuffers::UniformBuffers()
+        : frameBuffer(0),
+          frameValid(false),
+          time(0),
+          drawBuffer(0),
+          drawAlignment(0),
+          drawStride(0),
+          stagedDraws(0) {}
+
+    UniformBuffers::~UniformBuffers() {}
+
+    UniformBuffers & UniformBuffers::current() {
+        // A context can only be current on one thread at a time
+        static thread_local UniformBuffers buffers;
+        return buffers;
+    }
+
+    void UniformBuffers::init() {
+        if (frameBuffer)
+            return;
+
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        drawAlignment = alignment;
+        drawStride = (sizeof(DrawData) + alignment - 1) / alignment * alignment;
+
+        glGenBuffers(1, &frameBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr,
+                     GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void UniformBuffers::setTime(float seconds) {
+        time = seconds;
+    }
+
+    float UniformBuffers::getTime() const {
+        return time;
+    }
+
+    void UniformBuffers::setFrame(const RenderState & state) {
+        init();
+
+        FrameData data = {};
+        data.view = state.getView();
+        data.projection = state.getProjection();
+        data.viewProj = state.getVP();
+        data.cameraPos = glm::inverse(state.getView())[3];
+        data.time = time;
+
+        // Every shader binds the frame, only the first bind of a camera
+        // uploads
+        if (!frameValid || std::memcmp(&data, &frame, sizeof(FrameData)) != 0) {
+            frame = data;
+            frameValid = true;
+            glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frame);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glBindBufferBase(GL_UNIFORM_BUFFER, FrameBinding, frameBuffer);
+    }
+
+    size_t UniformBuffers::getDrawStride() {
+        init();
+        return drawStride;
+    }
+
+    size_t UniformBuffers::addDraw(const RenderState & state) {
+        size_t stride = getDrawStride();
+        staging.resize((stagedDraws + 1) * stride);
+
+        DrawData data;
+        data.model = state.getModel();
+        data.mvp = state.getMVP();
+        data.posOffset = vec4(state.getPositionOffset(), state.getPacked());
+        data.posScale = vec4(state.getPositionScale(), 0);
+        std::memcpy(staging.data() + stagedDraws * stride, &data, sizeof(data));
+        return stagedDraws++;
+    }
+
+    GLintptr UniformBuffers::uploadDraws() {
+        init();
+
+        size_t size = stagedDraws * drawStride;
+        stagedDraws = 0;
+        if (size == 0)
+            return 0;
+
+        // The stream fences each frame, so the draws are not written over
+        // while the GPU still reads them
+        auto & stream = StreamBuffer::current();
+        auto   allocation = stream.allocate(size, drawAlignment);
+        std::memcpy(allocation.data, staging.data(), size);
+        stream.commit(allocation);
+        drawBuffer = allocation.buffer;
+        return allocation.offset;
+    }
+
+    void UniformBuffers::bindDraw(GLintptr offset) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, DrawBinding, drawBuffer, offset,
+                          sizeof(DrawData));
+    }
+}
@@ -1,77 +1,180 @@
 #include "singe/Graphics/UniformExtra.hpp"
 
+#include <glm/gtc/type_ptr.hpp>
+
+#include "singe/Graphics/StateCache.hpp"
+
 namespace singe {
-    UniformExtra::UniformExtra(glpp::Uniform uniform) : uniform(uniform) {}
+    UniformExtra::UniformExtra(GLuint       program,
+                               GLint        location,
+                               SendFunction sendFunction)
+        : program(program),
+          location(location),
+          version(1),
+          sentVersion(0),
+          sendFunction(sendFunction) {}
 
     UniformExtra::~UniformExtra() {}
 
-    BoolUniformExtra::BoolUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(false) {}
+    void UniformExtra::touch() {
+        version++;
+        if (programVersion)
+            (*programVersion)++;
+    }
 
-    void BoolUniformExtra::send() const {
-        uniform.setBool(value);
+    GLuint UniformExtra::getProgram() const {
+        return program;
     }
 
-    IntUniformExtra::IntUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    GLint UniformExtra::getLocation() const {
+        return location;
+    }
 
-    void IntUniformExtra::send() const {
-        uniform.setInt(value);
+    uint64_t UniformExtra::getVersion() const {
+        return version;
     }
 
-    UIntUniformExtra::UIntUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    bool UniformExtra::isDirty() const {
+        return version != sentVersion;
+    }
 
-    void UIntUniformExtra::send() const {
-        uniform.setUInt(value);
+    void UniformExtra::attach(shared_ptr<uint64_t> programVersion) {
+        this->programVersion = programVersion;
+        // A new Shader has not seen the value yet
+        sentVersion = 0;
+        if (programVersion)
+            (*programVersion)++;
     }
 
-    FloatUniformExtra::FloatUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    void UniformExtra::send() {
+        if (version == sentVersion)
+            return;
+        if (location >= 0)
+            sendFunction(*this);
+        sentVersion = version;
+    }
 
-    void FloatUniformExtra::send() const {
-        uniform.setFloat(value);
+    /**
+     * Check if the value can be uploaded without binding program, otherwise
+     * bind it through StateCache for glUniform.
+     */
+    static bool direct(GLuint program) {
+        // glProgramUniform needs OpenGL 4.1 or ARB_separate_shader_objects,
+        // the window only asks for 3.0
+        static const bool supported =
+            GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects;
+        if (!supported)
+            StateCache::current().useProgram(program);
+        return supported;
     }
 
-    Vec2UniformExtra::Vec2UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    static void upload(GLuint program, GLint location, bool value) {
+        if (direct(program))
+            glProgramUniform1i(program, location, value);
+        else
+            glUniform1i(location, value);
+    }
 
-    void Vec2UniformExtra::send() const {
-        uniform.setVec2(value);
+    static void upload(GLuint program, GLint location, int value) {
+        if (direct(program))
+            glProgramUniform1i(program, location, value);
+        else
+            glUniform1i(location, value);
     }
 
-    Vec3UniformExtra::Vec3UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    static void upload(GLuint program, GLint location, unsigned int value) {
+        if (direct(program))
+            glProgramUniform1ui(program, location, value);
+        else
+            glUniform1ui(location, value);
+    }
 
-    void Vec3UniformExtra::send() const {
-        uniform.setVec3(value);
+    static void upload(GLuint program, GLint location, float value) {
+        if (direct(program))
+            glProgramUniform1f(program, location, value);
+        else
+            glUniform1f(location, value);
     }
 
-    Vec4UniformExtra::Vec4UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    static void upload(GLuint program, GLint location, const vec2 & value) {
+        if (direct(program))
+            glProgramUniform2fv(program, location, 1, glm::value_ptr(value));
+        else
+            glUniform2fv(location, 1, glm::value_ptr(value));
+    }
 
-    void Vec4UniformExtra::send() const {
-        uniform.setVec4(value);
+    static void upload(GLuint program, GLint location, const vec3 & value) {
+        if (direct(program))
+            glProgramUniform3fv(program, location, 1, glm::value_ptr(value));
+        else
+            glUniform3fv(location, 1, glm::value_ptr(value));
     }
 
-    Mat2UniformExtra::Mat2UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    static void upload(GLuint program, GLint location, const vec4 & value) {
+        if (direct(program))
+            glProgramUniform4fv(program, location, 1, glm::value_ptr(value));
+        else
+            glUniform4fv(location, 1, glm::value_ptr(value));
+    }
 
-    void Mat2UniformExtra::send() const {
-        uniform.setMat2(value);
+    static void upload(GLuint program, GLint location, const mat2 & value) {
+        if (direct(program))
+            glProgramUniformMatrix2fv(program, location, 1, GL_FALSE,
+                                      glm::value_ptr(value));
+        else
+            glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
     }
 
-    Mat3UniformExtra::Mat3UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    static void upload(GLuint program, GLint location, const mat3 & value) {
+        if (direct(program))
+            glProgramUniformMatrix3fv(program, location, 1, GL_FALSE,
+                                      glm::value_ptr(value));
+        else
+            glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    }
 
-    void Mat3UniformExtra::send() const {
-        uniform.setMat3(value);
+    static void upload(GLuint program, GLint location, const mat4 & value) {
+        if (direct(program))
+            glProgramUniformMatrix4fv(program, location, 1, GL_FALSE,
+                                      glm::value_ptr(value));
+        else
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
     }
 
-    Mat4UniformExtra::Mat4UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+    template <typename T>
+    TypedUniformExtra<T>::TypedUniformExtra(GLuint    program,
+                                            GLint     location,
+                                            const T & value)
+        : UniformExtra(program, location, &TypedUniformExtra<T>::sendValue),
+          value(value) {}
+
+    template <typename T>
+    void TypedUniformExtra<T>::sendValue(const UniformExtra & extra) {
+        auto & typed = static_cast<const TypedUniformExtra<T> &>(extra);
+        upload(typed.program, typed.location, typed.value);
+    }
 
-    void Mat4UniformExtra::send() const {
-        uniform.setMat4(value);
+    template <typename T>
+    const T & TypedUniformExtra<T>::get() const {
+        return value;
     }
+
+    template <typename T>
+    void TypedUniformExtra<T>::set(const T & value) {
+        if (this->value == value)
+            return;
+        this->value = value;
+        touch();
+    }
+
+    template class TypedUniformExtra<bool>;
+    template class TypedUniformExtra<int>;
+    template class TypedUniformExtra<unsigned int>;
+    template class TypedUniformExtra<float>;
+    template class TypedUniformExtra<vec2>;
+    template class TypedUniformExtra<vec3>;
+    template class TypedUniformExtra<vec4>;
+    template class TypedUniformExtra<mat2>;
+    template class TypedUniformExtra<mat3>;
+    template class TypedUniformExtra<mat4>;
 }
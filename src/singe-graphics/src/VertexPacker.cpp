@@ -0,0 +1,73 @@
+#include "singe/Graphics/VertexPacker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace singe {
+    static int16_t toSnorm16(float v) {
+        return int16_t(std::round(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    static float fromSnorm16(int16_t v) {
+        return std::max(v / 32767.0f, -1.0f);
+    }
+
+    /// Project the unit sphere onto an octahedron and unfold it into a square
+    static glm::vec2 octEncode(const vec3 & n) {
+        float     sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        glm::vec2 p = sum > 0 ? glm::vec2(n.x, n.y) / sum : glm::vec2(0);
+        if (n.z < 0) {
+            glm::vec2 sign(p.x >= 0 ? 1.0f : -1.0f, p.y >= 0 ? 1.0f : -1.0f);
+            p = (1.0f - glm::vec2(std::abs(p.y), std::abs(p.x))) * sign;
+        }
+        return p;
+    }
+
+    static vec3 octDecode(const glm::vec2 & p) {
+        vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+        if (n.z < 0) {
+            n.x = (1.0f - std::abs(p.y)) * (p.x >= 0 ? 1.0f : -1.0f);
+            n.y = (1.0f - std::abs(p.x)) * (p.y >= 0 ? 1.0f : -1.0f);
+        }
+        return glm::normalize(n);
+    }
+
+    VertexPacker::VertexPacker(const AABB & bounds)
+        : offset(bounds.empty() ? vec3(0) : bounds.min),
+          scale(bounds.empty() ? vec3(1) : bounds.max - bounds.min) {
+        for (int i = 0; i < 3; i++)
+            invScale[i] = scale[i] > 0 ? 65535.0f / scale[i] : 0.0f;
+    }
+
+    const vec3 & VertexPacker::getOffset() const {
+        return offset;
+    }
+
+    const vec3 & VertexPacker::getScale() const {
+        return scale;
+    }
+
+    PackedVertex VertexPacker::pack(const Vertex & vertex) const {
+        PackedVertex packed;
+        vec3         q = glm::round((vertex.pos - offset) * invScale);
+        glm::vec2    oct = octEncode(vertex.norm);
+        for (int c = 0; c < 3; c++)
+            packed.pos[c] = uint16_t(std::clamp(q[c], 0.0f, 65535.0f));
+        packed.pos[3] = 0;
+        packed.normal[0] = toSnorm16(oct.x);
+        packed.normal[1] = toSnorm16(oct.y);
+        packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+        packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+        return packed;
+    }
+
+    Vertex VertexPacker::unpack(const PackedVertex & packed) const {
+        vec3 pos(packed.pos[0], packed.pos[1], packed.pos[2]);
+        return Vertex(offset + pos / 65535.0f * scale,
+                      octDecode({fromSnorm16(packed.normal[0]),
+                                 fromSnorm16(packed.normal[1])}),
+                      {glm::unpackHalf1x16(packed.uv[0]),
+                       glm::unpackHalf1x16(packed.uv[1])});
+    }
+}
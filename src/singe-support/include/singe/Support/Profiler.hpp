@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef SINGE_PROFILE
+#define SINGE_PROFILE_CONCAT_(a, b) a##b
+#define SINGE_PROFILE_CONCAT(a, b)  SINGE_PROFILE_CONCAT_(a, b)
+/**
+ * Time the rest of the enclosing scope as a zone named name. The name must
+ * be a string literal or otherwise outlive the capture.
+ *
+ * Expands to nothing when singe is built with SINGE_PROFILE off.
+ */
+#define SINGE_PROFILE_SCOPE(name) \
+    ::singe::Profiler::Zone SINGE_PROFILE_CONCAT(singeProfileZone, \
+                                                 __LINE__)(name)
+#else
+#define SINGE_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+/**
+ * CPU profiler that records named zones and writes them as a Chrome
+ * trace_event JSON file, viewable in chrome://tracing or Perfetto.
+ *
+ * Zones are only recorded during a capture. Each thread writes to its own
+ * fixed size ring buffer without locking, the thread that calls
+ * Profiler::frame() drains the rings once per frame. Zones that do not fit
+ * in a full ring are dropped and counted.
+ *
+ * Zones are placed with SINGE_PROFILE_SCOPE so they compile to nothing
+ * when the SINGE_PROFILE CMake option is off.
+ *
+ * ```cpp
+ * void Level::update() {
+ *     SINGE_PROFILE_SCOPE("Level::update");
+ *     ...
+ * }
+ * ```
+ */
+namespace singe::Profiler {
+    /// Zones a thread can hold before the ring is drained
+    constexpr size_t RingSize = 1 << 14;
+
+    /// True while a capture is running, zones check this before timing
+    extern std::atomic<bool> capturing;
+
+    /**
+     * Get the time since the profiler started.
+     *
+     * @return the time in nanoseconds
+     */
+    uint64_t now();
+
+    /**
+     * Record a finished zone on the calling thread, prefer
+     * SINGE_PROFILE_SCOPE.
+     *
+     * @param name the zone name, must outlive the capture
+     * @param start the start time from Profiler::now()
+     * @param end the end time from Profiler::now()
+     */
+    void record(const char * name, uint64_t start, uint64_t end);
+
+    /**
+     * Times its lifetime as a zone if a capture is running when it is
+     * created.
+     */
+    class Zone {
+        const char * name;
+        uint64_t     start;
+
+    public:
+        explicit Zone(const char * name)
+            : name(capturing.load(std::memory_order_relaxed) ? name
+                                                             : nullptr),
+              start(this->name ? now() : 0) {}
+
+        Zone(const Zone &) = delete;
+        Zone & operator=(const Zone &) = delete;
+
+        ~Zone() {
+            if (name)
+                record(name, start, now());
+        }
+    };
+
+    /**
+     * Name the calling thread in written traces.
+     *
+     * @param name the thread name
+     */
+    void setThreadName(const std::string & name);
+
+    /**
+     * Start a capture of the next frames, written to path when they are
+     * done. A capture that is already running is written first.
+     *
+     * @param frames the number of calls to Profiler::frame() to capture
+     * @param path the trace file to write
+     */
+    void capture(size_t frames, const std::string & path);
+
+    /**
+     * End the running capture early and write it.
+     */
+    void stop();
+
+    /**
+     * Mark the end of a frame. Drains the thread rings and writes the
+     * capture once its frames are done. GameBase calls this every frame.
+     */
+    void frame();
+}
@@ -113,14 +113,28 @@ namespace singe::scene {
     struct Model {
         struct Mesh {
             string path;
+            /// Vertex buffer layout, "float" or "packed"
+            string format;
 
-            Mesh(const string & path) : path(path) {}
+            Mesh(const string & path, const string & format = "float")
+                : path(path), format(format) {}
         };
 
-        string    name;
-        Transform transform;
-        Mesh      mesh;
-        Shader    shader;
+        struct Lod {
+            /// Fraction of triangles to keep
+            float ratio;
+            /// Fraction of the screen height below which this lod is used
+            float size;
+
+            Lod(float ratio, float size) : ratio(ratio), size(size) {}
+        };
+
+        string            name;
+        Transform         transform;
+        Mesh              mesh;
+        Shader            shader;
+        vector<Transform> instances;
+        vector<Lod>       lods;
 
         Model(const string &    name,
               const Mesh &      mesh,
@@ -137,6 +151,33 @@ namespace singe::scene {
             : size(size), color(color) {}
     };
 
+    struct Light {
+        enum Type {
+            POINT,
+            DIRECTIONAL,
+        };
+
+        string name;
+        Type   type;
+        /// Position of point lights in the scene's space
+        vec3   position;
+        /// Direction the light travels, used by directional lights
+        vec3   direction;
+        vec3   color;
+        float  intensity;
+        /// Distance at which a point light fades to nothing
+        float  radius;
+
+        Light(const string & name, Type type = POINT)
+            : name(name),
+              type(type),
+              position(0),
+              direction(0, -1, 0),
+              color(1),
+              intensity(1),
+              radius(10) {}
+    };
+
     struct Scene {
         shared_ptr<Scene>         parent;
         string                    name;
@@ -145,6 +186,7 @@ namespace singe::scene {
         vector<Camera>            cameras;
         vector<Shader>            shaders;
         vector<Model>             models;
+        vector<Light>             lights;
         vector<shared_ptr<Scene>> children;
 
         /// Find a shader by ref name
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+
+    /**
+     * Fixed set of worker threads for splitting loops into chunks.
+     *
+     * The calling thread also runs chunks, so a pool with no workers runs
+     * everything inline.
+     */
+    class ThreadPool {
+    public:
+        /// Range of indices [begin, end) given to a job
+        using Job = std::function<void(size_t begin, size_t end)>;
+
+    private:
+        vector<std::thread>     workers;
+        std::mutex              callMutex;
+        std::mutex              mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        const Job *             job;
+        size_t                  count;
+        size_t                  grain;
+        size_t                  chunks;
+        std::atomic<size_t>     next;
+        size_t                  finished;
+        size_t                  active;
+        uint64_t                generation;
+        bool                    stop;
+
+        void work();
+
+        void runChunks();
+
+    public:
+        /**
+         * Start the worker threads.
+         *
+         * @param threads number of workers, 0 to use one less than the number
+         *                of hardware threads
+         */
+        ThreadPool(size_t threads = 0);
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        /// @brief Stop and join the worker threads.
+        ~ThreadPool();
+
+        /**
+         * Get the number of threads that run chunks, including the caller.
+         *
+         * @return worker count + 1
+         */
+        size_t size() const;
+
+        /**
+         * Run job over [0, count) in chunks of grain indices and wait for all
+         * of them to finish. Chunks run in any order on any thread. Calls
+         * from several threads at once are run one after another, so job
+         * must not call parallelFor() on the same pool.
+         *
+         * @param count the number of indices
+         * @param grain the number of indices in each chunk
+         * @param job the function called with each chunk
+         */
+        void parallelFor(size_t count, size_t grain, const Job & job);
+
+        /**
+         * Get a pool shared by the engine, created on first use.
+         *
+         * @return the shared ThreadPool
+         */
+        static ThreadPool & shared();
+    };
+}
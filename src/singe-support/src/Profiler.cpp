@@ -0,0 +1,252 @@
+#include "singe/Support/Profiler.hpp"
+
+#include <chrono>
+#include <fmt/format.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "singe/Support/log.hpp"
+
+namespace singe::Profiler {
+    using std::shared_ptr;
+    using std::string;
+    using std::vector;
+
+    std::atomic<bool> capturing(false);
+
+    namespace {
+        struct Event {
+            const char * name;
+            uint64_t     start;
+            uint64_t     end;
+        };
+
+        /**
+         * Single producer, single consumer ring of one thread's zones.
+         */
+        struct Ring {
+            Event               events[RingSize];
+            std::atomic<size_t> head {0};
+            std::atomic<size_t> tail {0};
+            std::atomic<bool>   exited {false};
+            std::atomic<size_t> dropped {0};
+            size_t              id;
+        };
+
+        /// A drained zone and the thread it ran on
+        struct Sample {
+            Event  event;
+            size_t thread;
+        };
+
+        struct Thread {
+            size_t id;
+            string name;
+        };
+
+        /// Rings of every thread and the running capture
+        struct State {
+            std::mutex               mutex;
+            vector<shared_ptr<Ring>> rings;
+            vector<Thread>           threads;
+            vector<Sample>           samples;
+            size_t                   nextId = 0;
+            size_t                   frames = 0;
+            size_t                   dropped = 0;
+            string                   path;
+        };
+
+        State & state() {
+            static State state;
+            return state;
+        }
+
+        const auto epoch = std::chrono::steady_clock::now();
+
+        /// Name given before the ring exists
+        thread_local string threadName;
+
+        /// Marks the ring so it is removed once drained
+        struct RingOwner {
+            shared_ptr<Ring> ring;
+
+            ~RingOwner() {
+                if (ring)
+                    ring->exited = true;
+            }
+        };
+
+        thread_local RingOwner owner;
+
+        Ring & localRing() {
+            if (!owner.ring) {
+                auto & s = state();
+                std::lock_guard lock(s.mutex);
+                owner.ring = std::make_shared<Ring>();
+                owner.ring->id = s.nextId++;
+                s.rings.push_back(owner.ring);
+                s.threads.push_back(
+                    {owner.ring->id,
+                     threadName.empty()
+                         ? fmt::format("Thread {}", owner.ring->id)
+                         : threadName});
+            }
+            return *owner.ring;
+        }
+
+        /**
+         * Move finished zones out of every ring. Must hold the state mutex.
+         */
+        void drain(State & s, bool keep) {
+            for (auto it = s.rings.begin(); it != s.rings.end();) {
+                Ring & ring = **it;
+                bool   exited = ring.exited;
+                size_t tail = ring.tail.load(std::memory_order_relaxed);
+                size_t head = ring.head.load(std::memory_order_acquire);
+                if (keep) {
+                    for (size_t i = tail; i != head; i++)
+                        s.samples.push_back(
+                            {ring.events[i % RingSize], ring.id});
+                }
+                ring.tail.store(head, std::memory_order_release);
+                s.dropped += ring.dropped.exchange(0);
+
+                // Nothing can be pushed after the owner exited
+                if (exited)
+                    it = s.rings.erase(it);
+                else
+                    ++it;
+            }
+        }
+
+        void escape(string & out, const string & text) {
+            for (char c : text) {
+                if (c == '"' || c == '\\')
+                    out += '\\';
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out += fmt::format("\\u{:04x}", static_cast<int>(c));
+                else
+                    out += c;
+            }
+        }
+
+        /**
+         * Write and clear the captured samples. Must hold the state mutex.
+         */
+        void write(State & s) {
+            capturing = false;
+            drain(s, true);
+
+            std::ofstream file(s.path);
+            if (!file) {
+                Logging::Core->error("Failed to write trace {}", s.path);
+                s.samples.clear();
+                return;
+            }
+
+            string json = "{\"traceEvents\":[";
+            bool   first = true;
+            auto   separate = [&]() {
+                json += first ? "\n" : ",\n";
+                first = false;
+            };
+            for (auto & thread : s.threads) {
+                separate();
+                json += fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\","
+                                    "\"pid\":1,\"tid\":{},"
+                                    "\"args\":{{\"name\":\"",
+                                    thread.id);
+                escape(json, thread.name);
+                json += "\"}}";
+            }
+            for (auto & sample : s.samples) {
+                separate();
+                json += "{\"name\":\"";
+                escape(json, sample.event.name);
+                // Microseconds, the unit of the trace format
+                json += fmt::format("\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                                    "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                    sample.thread, sample.event.start / 1e3,
+                                    (sample.event.end - sample.event.start)
+                                        / 1e3);
+            }
+            json += "\n]}\n";
+            file << json;
+
+            Logging::Core->info("Wrote {} zones to {}, {} dropped",
+                                s.samples.size(), s.path, s.dropped);
+            s.samples.clear();
+            s.samples.shrink_to_fit();
+        }
+    }
+
+    uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - epoch)
+            .count();
+    }
+
+    void record(const char * name, uint64_t start, uint64_t end) {
+        Ring & ring = localRing();
+        size_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) == RingSize) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        ring.events[head % RingSize] = {name, start, end};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    void setThreadName(const string & name) {
+        threadName = name;
+        if (!owner.ring)
+            return;
+
+        auto & s = state();
+        std::lock_guard lock(s.mutex);
+        for (auto & thread : s.threads) {
+            if (thread.id == owner.ring->id)
+                thread.name = name;
+        }
+    }
+
+    void capture(size_t frames, const string & path) {
+#ifndef SINGE_PROFILE
+        Logging::Core->warning("Profiler zones are compiled out, "
+                               "build with SINGE_PROFILE to capture");
+#endif
+        auto & s = state();
+        std::lock_guard lock(s.mutex);
+        if (capturing)
+            write(s);
+
+        // Zones recorded after the last capture ended
+        drain(s, false);
+        s.frames = frames;
+        s.dropped = 0;
+        s.path = path;
+        Logging::Core->info("Capturing {} frames to {}", frames, path);
+        capturing = frames > 0;
+    }
+
+    void stop() {
+        auto & s = state();
+        std::lock_guard lock(s.mutex);
+        if (capturing)
+            write(s);
+    }
+
+    void frame() {
+        if (!capturing)
+            return;
+
+        auto & s = state();
+        std::lock_guard lock(s.mutex);
+        if (--s.frames == 0)
+            write(s);
+        else
+            drain(s, true);
+    }
+}
@@ -4,6 +4,7 @@
 #include <rapidxml.hpp>
 #include <stdexcept>
 
+#include "singe/Support/Profiler.hpp"
 #include "singe/Support/Util.hpp"
 #include "singe/Support/log.hpp"
 
@@ -285,9 +286,33 @@ namespace singe::scene {
         string      path(path_attr->value(), path_attr->value_size());
         Model::Mesh mesh(path);
 
+        auto * format_attr = node->first_attribute("format");
+        if (format_attr) {
+            mesh.format = string(format_attr->value(), format_attr->value_size());
+            if (mesh.format != "float" && mesh.format != "packed")
+                ERROR(node, "unknown format " + mesh.format);
+        }
+
         return mesh;
     }
 
+    static Model::Lod parseLod(const xml_node<char> * node) {
+        PTR_CHECK(node);
+
+        auto * ratio_attr = node->first_attribute("ratio");
+        if (!ratio_attr)
+            ERROR(node, "missing ratio attribute");
+
+        auto * size_attr = node->first_attribute("size");
+        if (!size_attr)
+            ERROR(node, "missing size attribute");
+
+        string ratio(ratio_attr->value(), ratio_attr->value_size());
+        string size(size_attr->value(), size_attr->value_size());
+
+        return Model::Lod(stof(ratio), stof(size));
+    }
+
     static Model parseModel(const xml_node<char> * node, Scene & parent) {
         PTR_CHECK(node);
 
@@ -314,6 +339,18 @@ namespace singe::scene {
         if (transform_node)
             model.transform = parseTransform(transform_node);
 
+        auto * instance_node = node->first_node("instance");
+        while (instance_node) {
+            model.instances.emplace_back(parseTransform(instance_node));
+            instance_node = instance_node->next_sibling("instance");
+        }
+
+        auto * lod_node = node->first_node("lod");
+        while (lod_node) {
+            model.lods.emplace_back(parseLod(lod_node));
+            lod_node = lod_node->next_sibling("lod");
+        }
+
         return model;
     }
 
@@ -335,6 +372,61 @@ namespace singe::scene {
         return grid;
     }
 
+    static Light::Type parseLightType(const xml_node<char> *      node,
+                                      const xml_attribute<char> * attr) {
+        string value(attr->value(), attr->value_size());
+        if (value == "point")
+            return Light::POINT;
+
+        else if (value == "directional")
+            return Light::DIRECTIONAL;
+
+        else
+            ERROR(node, "invalid light type " + value);
+    }
+
+    static Light parseLight(const xml_node<char> * node) {
+        PTR_CHECK(node);
+
+        auto * name_attr = node->first_attribute("name");
+        if (!name_attr)
+            ERROR(node, "missing name attribute");
+
+        string name(name_attr->value(), name_attr->value_size());
+        Light  light(name);
+
+        auto * type_attr = node->first_attribute("type");
+        if (type_attr)
+            light.type = parseLightType(node, type_attr);
+
+        auto * position_node = node->first_node("position");
+        if (position_node)
+            light.position = parseVec3(position_node);
+
+        auto * direction_node = node->first_node("direction");
+        if (direction_node)
+            light.direction = parseVec3(direction_node);
+
+        auto * color_node = node->first_node("color");
+        if (color_node)
+            light.color = parseVec3(color_node);
+
+        auto * intensity_node = node->first_node("intensity");
+        if (intensity_node) {
+            string intensity_str(intensity_node->value(),
+                                 intensity_node->value_size());
+            light.intensity = stof(intensity_str);
+        }
+
+        auto * radius_node = node->first_node("radius");
+        if (radius_node) {
+            string radius_str(radius_node->value(), radius_node->value_size());
+            light.radius = stof(radius_str);
+        }
+
+        return light;
+    }
+
     static shared_ptr<Scene> parseScene(const xml_node<char> * node,
                                         shared_ptr<Scene>      parent) {
         PTR_CHECK(node);
@@ -374,6 +466,12 @@ namespace singe::scene {
             model_node = model_node->next_sibling("model");
         }
 
+        auto * light_node = node->first_node("light");
+        while (light_node) {
+            scene->lights.emplace_back(parseLight(light_node));
+            light_node = light_node->next_sibling("light");
+        }
+
         auto * scene_node = node->first_node("scene");
         while (scene_node) {
             scene->children.emplace_back(parseScene(scene_node, scene));
@@ -406,6 +504,7 @@ namespace singe::scene {
     }
 
     shared_ptr<Scene> SceneParser::parse(istream & stream) {
+        SINGE_PROFILE_SCOPE("SceneParser::parse");
         string body((istreambuf_iterator<char>(stream)),
                     istreambuf_iterator<char>());
 
@@ -0,0 +1,120 @@
+#include "singe/Support/ThreadPool.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+#include "singe/Support/Profiler.hpp"
+
+namespace singe {
+    ThreadPool::ThreadPool(size_t threads)
+        : job(nullptr),
+          count(0),
+          grain(1),
+          chunks(0),
+          next(0),
+          finished(0),
+          active(0),
+          generation(0),
+          stop(false) {
+        if (threads == 0) {
+            unsigned hardware = std::thread::hardware_concurrency();
+            threads = hardware > 1 ? hardware - 1 : 0;
+        }
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back([this, i] {
+                Profiler::setThreadName(fmt::format("Worker {}", i));
+                work();
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto & worker : workers) worker.join();
+    }
+
+    size_t ThreadPool::size() const {
+        return workers.size() + 1;
+    }
+
+    void ThreadPool::runChunks() {
+        size_t ran = 0;
+        for (size_t chunk; (chunk = next.fetch_add(1)) < chunks; ran++) {
+            SINGE_PROFILE_SCOPE("ThreadPool::chunk");
+            size_t begin = chunk * grain;
+            (*job)(begin, std::min(begin + grain, count));
+        }
+        if (ran == 0)
+            return;
+
+        std::lock_guard lock(mutex);
+        finished += ran;
+        if (finished == chunks)
+            done.notify_all();
+    }
+
+    void ThreadPool::work() {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [&] {
+                    return stop || (job && generation != seen);
+                });
+                if (stop)
+                    return;
+                seen = generation;
+                active++;
+            }
+
+            runChunks();
+
+            // The caller waits for every worker that joined this job so a
+            // late worker never takes chunks from the next one
+            std::lock_guard lock(mutex);
+            if (--active == 0)
+                done.notify_all();
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t count, size_t grain, const Job & job) {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        if (workers.empty() || count <= grain) {
+            job(0, count);
+            return;
+        }
+
+        // One job at a time, the state below is shared with the workers
+        std::lock_guard call(callMutex);
+
+        {
+            std::lock_guard lock(mutex);
+            this->job = &job;
+            this->count = count;
+            this->grain = grain;
+            chunks = (count + grain - 1) / grain;
+            next = 0;
+            finished = 0;
+            generation++;
+        }
+        wake.notify_all();
+
+        runChunks();
+
+        std::unique_lock lock(mutex);
+        done.wait(lock, [&] { return finished == chunks && active == 0; });
+        this->job = nullptr;
+    }
+
+    ThreadPool & ThreadPool::shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+}
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <singe/Graphics/VertexPacker.hpp>
+#include <vector>
+
+using namespace singe;
+
+// Bounds from the format: half a unorm16 step of the box, the octahedral
+// snorm16 worst case (about 0.0037 degrees) and half a half float step
+// below 1
+static constexpr float kMaxPositionError = 1e-5f;
+static constexpr float kMaxNormalDegrees = 0.01f;
+static constexpr float kMaxUvError = 3e-4f;
+
+static int failures = 0;
+
+static void check(bool passed, const char * what, float value, float limit) {
+    std::printf("%s %s: %g (limit %g)\n", passed ? "PASS" : "FAIL", what,
+                value, limit);
+    if (!passed)
+        failures++;
+}
+
+/**
+ * Pack and unpack random vertices in box and check the worst errors.
+ */
+static void roundTrip(const char * name, const AABB & box, std::mt19937 & rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::normal_distribution<float>       gauss;
+
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < 100000; i++) {
+        vec3 t(unit(rng), unit(rng), unit(rng));
+        vec3 n(gauss(rng), gauss(rng), gauss(rng));
+        vertices.emplace_back(box.min + t * (box.max - box.min),
+                              glm::normalize(n),
+                              glm::vec2(unit(rng), unit(rng)));
+    }
+    // Corners and axis normals are the edge cases of each encoding
+    vertices.emplace_back(box.min, vec3(0, 0, -1), glm::vec2(0, 0));
+    vertices.emplace_back(box.max, vec3(0, 0, 1), glm::vec2(1, 1));
+    vertices.emplace_back(box.center(), vec3(-1, 0, 0), glm::vec2(0.5, 1));
+    vertices.emplace_back(box.center(), vec3(0, -1, 0), glm::vec2(1, 0.5));
+
+    VertexPacker packer(box);
+    float        diagonal = glm::length(box.max - box.min);
+    float        position = 0;
+    float        normal = 0;
+    float        uv = 0;
+    for (auto & vertex : vertices) {
+        Vertex decoded = packer.unpack(packer.pack(vertex));
+        position = std::max(position, glm::length(decoded.pos - vertex.pos));
+        float cosine = std::clamp(glm::dot(decoded.norm, vertex.norm), -1.0f,
+                                  1.0f);
+        normal = std::max(normal, glm::degrees(std::acos(cosine)));
+        uv = std::max(uv, std::abs(decoded.uv.x - vertex.uv.x));
+        uv = std::max(uv, std::abs(decoded.uv.y - vertex.uv.y));
+    }
+
+    std::printf("%s\n", name);
+    check(position <= kMaxPositionError * diagonal,
+          "position error / diagonal", position / diagonal,
+          kMaxPositionError);
+    check(normal <= kMaxNormalDegrees, "normal error degrees", normal,
+          kMaxNormalDegrees);
+    check(uv <= kMaxUvError, "uv error", uv, kMaxUvError);
+}
+
+int main() {
+    std::mt19937 rng(1);
+    roundTrip("unit box", AABB(vec3(0), vec3(1)), rng);
+    roundTrip("offset box", AABB(vec3(-120, 4, 30), vec3(-80, 5, 250)), rng);
+    roundTrip("flat box", AABB(vec3(-1, 0, -1), vec3(1, 0, 1)), rng);
+    return failures ? 1 : 0;
+}
@@ -39,28 +39,30 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = StateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setEnabled(GL_CULL_FACE, false);
+    // gl.setEnabled(GL_CULL_FACE, true);
+    // gl.cullFace(GL_BACK);
+    gl.frontFace(GL_CCW);
+    gl.setEnabled(GL_DEPTH_TEST, true);
+    gl.depthFunc(GL_LEQUAL);
+    gl.setEnabled(GL_BLEND, true);
+    gl.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glLineWidth(1.0);
 }
 
 void Game::onDraw() const {
+    auto & gl = StateCache::current();
     setupGl();
 
     RenderState state(camera);
     state.setGridEnable(drawGrid);
     scene.draw(state);
 
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    gl.setEnabled(GL_CULL_FACE, false);
+    gl.setEnabled(GL_DEPTH_TEST, false);
+    gl.setEnabled(GL_BLEND, false);
     glLineWidth(4.0);
 
     glpp::BufferArray::unbind();
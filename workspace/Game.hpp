@@ -7,6 +7,7 @@
 #include <singe/Graphics/Model.hpp>
 #include <singe/Graphics/Scene.hpp>
 #include <singe/Graphics/Shader.hpp>
+#include <singe/Graphics/StateCache.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
 